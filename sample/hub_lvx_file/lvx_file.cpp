@@ -28,10 +28,6 @@
 
 #define WRITE_BUFFER_LEN 1024 * 1024
 #define MAGIC_CODE       (0xac0ea767)
-#define RAW_POINT_NUM     100
-#define SINGLE_POINT_NUM  96
-#define DUAL_POINT_NUM    48
-#define IMU_POINT_NUM     1
 #define M_PI             3.14159265358979323846
 
 LvxFileHandle::LvxFileHandle() : cur_frame_index_(0), cur_offset_(0), frame_duration_(kDefaultFrameDurationTime) {
@@ -133,27 +129,7 @@ void LvxFileHandle::BasePointsHandle(LivoxEthPacket *data, LvxBasePackDetail &pa
   packet.timestamp_type = data->timestamp_type;
   packet.data_type = data->data_type;
   memcpy(packet.timestamp, data->timestamp, 8 * sizeof(uint8_t));
-  if (packet.data_type == 0) {
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point) - \
-        sizeof(packet.pack_size) + RAW_POINT_NUM*sizeof(LivoxRawPoint);
-    memcpy(packet.raw_point,(void *)data->data,RAW_POINT_NUM*sizeof(LivoxRawPoint));
-  } else if(packet.data_type == 1){
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point)- sizeof(packet.pack_size) +RAW_POINT_NUM*sizeof(LivoxSpherPoint);
-    memcpy(packet.raw_point,(void *)data->data,RAW_POINT_NUM*sizeof(LivoxSpherPoint));
-  } else if(packet.data_type == 2){
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point)- sizeof(packet.pack_size) +SINGLE_POINT_NUM*sizeof(LivoxExtendRawPoint);
-    memcpy(packet.raw_point,(void *)data->data,SINGLE_POINT_NUM*sizeof(LivoxExtendRawPoint));
-  } else if(packet.data_type == 3){
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point)- sizeof(packet.pack_size) +SINGLE_POINT_NUM*sizeof(LivoxExtendSpherPoint);
-    memcpy(packet.raw_point,(void *)data->data,SINGLE_POINT_NUM*sizeof(LivoxExtendSpherPoint));
-  } else if(packet.data_type == 4){
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point)- sizeof(packet.pack_size) +DUAL_POINT_NUM*sizeof(LivoxDualExtendRawPoint);
-    memcpy(packet.raw_point,(void *)data->data,DUAL_POINT_NUM*sizeof(LivoxDualExtendRawPoint));
-  } else if(packet.data_type == 5){
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point)- sizeof(packet.pack_size) +DUAL_POINT_NUM*sizeof(LivoxDualExtendSpherPoint);
-    memcpy(packet.raw_point,(void *)data->data,DUAL_POINT_NUM*sizeof(LivoxDualExtendSpherPoint));
-  } else if(packet.data_type == 6){
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point)- sizeof(packet.pack_size) +IMU_POINT_NUM*sizeof(LivoxImuPoint);
-    memcpy(packet.raw_point,(void *)data->data,IMU_POINT_NUM*sizeof(LivoxImuPoint));
-  }
+  uint32_t points_size = livox::PointsPerPacket(packet.data_type) * livox::PointSizeOf(packet.data_type);
+  packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point) - sizeof(packet.pack_size) + points_size;
+  memcpy(packet.raw_point, (void *)data->data, points_size);
 }
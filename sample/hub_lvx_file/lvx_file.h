@@ -32,6 +32,7 @@
 #include <vector>
 #include <mutex>
 #include "livox_sdk.h"
+#include "livox_packet_view.h"
 
 
 #define kMaxPointSize 1500
@@ -30,10 +30,6 @@
 
 #define WRITE_BUFFER_LEN 1024 * 1024
 #define MAGIC_CODE       (0xac0ea767)
-#define RAW_POINT_NUM     100
-#define SINGLE_POINT_NUM  96
-#define DUAL_POINT_NUM    48
-#define IMU_POINT_NUM     1
 #define M_PI             3.14159265358979323846
 
 LvxFileHandle::LvxFileHandle() : cur_frame_index_(0), cur_offset_(0), frame_duration_(kDefaultFrameDurationTime) {
@@ -85,7 +81,7 @@ void LvxFileHandle::InitLvxFileHeader() {
   lvx_file_.write((char *)write_buffer.get(), cur_offset_);
 }
 
-void LvxFileHandle::SaveFrameToLvxFile(std::list<LvxBasePackDetail> &point_packet_list_temp) {
+void LvxFileHandle::SaveFrameToLvxFile(std::list<LvxBasePackLease> &point_packet_list_temp) {
   uint64_t cur_pos = 0;
   FrameHeader frame_header = { 0 };
   std::unique_ptr<char[]> write_buffer(new char[WRITE_BUFFER_LEN]);
@@ -94,7 +90,7 @@ void LvxFileHandle::SaveFrameToLvxFile(std::list<LvxBasePackDetail> &point_packe
   frame_header.next_offset = cur_offset_ + sizeof(FrameHeader);
   auto iterator = point_packet_list_temp.begin();
   for (; iterator != point_packet_list_temp.end(); iterator++) {
-    frame_header.next_offset += iterator->pack_size;
+    frame_header.next_offset += BasePackSize(GetPacketLeaseData(iterator->lease, nullptr));
   }
 
   frame_header.frame_index = cur_frame_index_;
@@ -104,18 +100,20 @@ void LvxFileHandle::SaveFrameToLvxFile(std::list<LvxBasePackDetail> &point_packe
 
   auto iter = point_packet_list_temp.begin();
   for (; iter != point_packet_list_temp.end(); iter++) {
-    if (cur_pos + iter->pack_size >= WRITE_BUFFER_LEN) {
+    LivoxEthPacket *data = GetPacketLeaseData(iter->lease, nullptr);
+    uint32_t pack_size = BasePackSize(data);
+    if (cur_pos + pack_size >= WRITE_BUFFER_LEN) {
       lvx_file_.write((char*)write_buffer.get(), cur_pos);
       cur_pos = 0;
-      memcpy(write_buffer.get() + cur_pos, (void*)&(*iter), iter->pack_size);
-      cur_pos += iter->pack_size;
-    }
-    else {
-      memcpy(write_buffer.get() + cur_pos, (void*)&(*iter), iter->pack_size);
-      cur_pos += iter->pack_size;
     }
+    /** The packet is written straight from the SDK buffer behind the device index. */
+    write_buffer[cur_pos] = iter->device_index;
+    memcpy(write_buffer.get() + cur_pos + 1, (void*)data, pack_size - 1);
+    cur_pos += pack_size;
+    ReleasePacketLease(iter->lease);
   }
   lvx_file_.write((char*)write_buffer.get(), cur_pos);
+  point_packet_list_temp.clear();
 
   cur_offset_ = frame_header.next_offset;
   cur_frame_index_++;
@@ -135,28 +133,14 @@ void LvxFileHandle::BasePointsHandle(LivoxEthPacket *data, LvxBasePackDetail &pa
   packet.timestamp_type = data->timestamp_type;
   packet.data_type = data->data_type;
   memcpy(packet.timestamp, data->timestamp, 8 * sizeof(uint8_t));
-  if (packet.data_type == 0) {
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point)- sizeof(packet.pack_size) + RAW_POINT_NUM*sizeof(LivoxRawPoint);
-    memcpy(packet.raw_point,(void *)data->data,RAW_POINT_NUM*sizeof(LivoxRawPoint));
-  } else if(packet.data_type == 1){
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point)- sizeof(packet.pack_size) +RAW_POINT_NUM*sizeof(LivoxSpherPoint);
-    memcpy(packet.raw_point,(void *)data->data,RAW_POINT_NUM*sizeof(LivoxSpherPoint));
-  } else if(packet.data_type == 2){
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point)- sizeof(packet.pack_size) +SINGLE_POINT_NUM*sizeof(LivoxExtendRawPoint);
-    memcpy(packet.raw_point,(void *)data->data,SINGLE_POINT_NUM*sizeof(LivoxExtendRawPoint));
-  } else if(packet.data_type == 3){
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point)- sizeof(packet.pack_size) +SINGLE_POINT_NUM*sizeof(LivoxExtendSpherPoint);
-    memcpy(packet.raw_point,(void *)data->data,SINGLE_POINT_NUM*sizeof(LivoxExtendSpherPoint));
-  } else if(packet.data_type == 4){
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point)- sizeof(packet.pack_size) +DUAL_POINT_NUM*sizeof(LivoxDualExtendRawPoint);
-    memcpy(packet.raw_point,(void *)data->data,DUAL_POINT_NUM*sizeof(LivoxDualExtendRawPoint));
-  } else if(packet.data_type == 5){
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point)- sizeof(packet.pack_size) +DUAL_POINT_NUM*sizeof(LivoxDualExtendSpherPoint);
-    memcpy(packet.raw_point,(void *)data->data,DUAL_POINT_NUM*sizeof(LivoxDualExtendSpherPoint));
-  } else if(packet.data_type == 6){
-    packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point)- sizeof(packet.pack_size) +IMU_POINT_NUM*sizeof(LivoxImuPoint);
-    memcpy(packet.raw_point,(void *)data->data,IMU_POINT_NUM*sizeof(LivoxImuPoint));
-  }
+  uint32_t points_size = livox::PointsPerPacket(packet.data_type) * livox::PointSizeOf(packet.data_type);
+  packet.pack_size = sizeof(LvxBasePackDetail) - sizeof(packet.raw_point) - sizeof(packet.pack_size) + points_size;
+  memcpy(packet.raw_point, (void *)data->data, points_size);
+}
+
+uint32_t LvxFileHandle::BasePackSize(LivoxEthPacket *data) {
+  uint32_t header_size = sizeof(LvxBasePackDetail) - sizeof(((LvxBasePackDetail *)0)->raw_point) - sizeof(uint32_t);
+  return header_size + livox::PointsPerPacket(data->data_type) * livox::PointSizeOf(data->data_type);
 }
 
 void ParseExtrinsicXml(DeviceItem &item, LvxDeviceInfo &info) {
@@ -32,6 +32,7 @@
 #include <vector>
 #include <mutex>
 #include "livox_sdk.h"
+#include "livox_packet_view.h"
 
 #define kMaxPointSize 1500
 #define kDefaultFrameDurationTime 50
@@ -89,6 +90,12 @@ typedef struct {
   uint32_t pack_size;
 } LvxBasePackDetail;
 
+/** A received packet kept for the next frame, written as the device index followed by the packet itself. */
+typedef struct {
+  uint8_t device_index;
+  LivoxPacketLease *lease;
+} LvxBasePackLease;
+
 typedef struct {
   uint64_t current_offset;
   uint64_t next_offset;
@@ -103,13 +110,14 @@ public:
 
   bool InitLvxFile();
   void InitLvxFileHeader();
-  void SaveFrameToLvxFile(std::list<LvxBasePackDetail> &point_packet_list_temp);
+  void SaveFrameToLvxFile(std::list<LvxBasePackLease> &point_packet_list_temp);
   void CloseLvxFile();
 
   void AddDeviceInfo(LvxDeviceInfo &info) { device_info_list_.push_back(info); };
   int GetDeviceInfoListSize() { return device_info_list_.size(); }
 
   void BasePointsHandle(LivoxEthPacket *data, LvxBasePackDetail &packet);
+  uint32_t BasePackSize(LivoxEthPacket *data);
 
 private:
   std::ofstream lvx_file_;
@@ -30,7 +30,7 @@
 
 DeviceItem devices[kMaxLidarCount];
 LvxFileHandle lvx_file_handler;
-std::list<LvxBasePackDetail> point_packet_list;
+std::list<LvxBasePackLease> point_packet_list;
 std::vector<std::string> broadcast_code_rev;
 std::condition_variable lidar_arrive_condition;
 std::condition_variable extrinsic_condition;
@@ -76,15 +76,13 @@ void OnLidarErrorStatusCallback(livox_status status, uint8_t handle, ErrorMessag
   }
 }
 
-/** Receiving point cloud data from Livox LiDAR. */
-void GetLidarData(uint8_t handle, LivoxEthPacket *data, uint32_t data_num, void *client_data) {
+/** Receiving point cloud data from Livox LiDAR, the packet is kept by its lease until it is written to the file. */
+void GetLidarData(uint8_t handle, LivoxPacketLease *lease, LivoxEthPacket *data, uint32_t data_num, void *client_data) {
   if (data) {
     if (handle < connected_lidar_count && is_finish_extrinsic_parameter) {
       std::unique_lock<std::mutex> lock(mtx);
-      LvxBasePackDetail packet;
-      packet.device_index = handle;
-      lvx_file_handler.BasePointsHandle(data, packet);
-      point_packet_list.push_back(packet);
+      RetainPacketLease(lease);
+      point_packet_list.push_back(LvxBasePackLease{handle, lease});
     }
   }
 }
@@ -272,7 +270,7 @@ void AddDevicesToConnect() {
     bool result = AddLidarToConnect(broadcast_code_rev[i].c_str(), &handle);
     if (result == kStatusSuccess) {
       /** Set the point cloud data for a specific Livox LiDAR. */
-      SetDataCallback(handle, GetLidarData, nullptr);
+      SetDataLeaseCallback(handle, GetLidarData, nullptr);
       devices[handle].handle = handle;
       devices[handle].device_state = kDeviceStateDisconnect;
       connected_lidar_count++;
@@ -430,7 +428,7 @@ int main(int argc, const char *argv[]) {
   int i = 0;
   steady_clock::time_point last_time = steady_clock::now();
   for (i = 0; i < lvx_file_save_time * FRAME_RATE; ++i) {
-    std::list<LvxBasePackDetail> point_packet_list_temp;
+    std::list<LvxBasePackLease> point_packet_list_temp;
     {
       std::unique_lock<std::mutex> lock(mtx);
       point_pack_condition.wait_for(lock, milliseconds(kDefaultFrameDurationTime) - (steady_clock::now() - last_time));
@@ -457,4 +455,9 @@ int main(int argc, const char *argv[]) {
 
 /** Uninitialize Livox-SDK. */
   Uninit();
+
+  for (auto &packet : point_packet_list) {
+    ReleasePacketLease(packet.lease);
+  }
+  point_packet_list.clear();
 }
\ No newline at end of file
@@ -170,6 +170,20 @@ int LdsLidar::DeInitLdsLidar()
 }
 //=======================================================================================
 
+/** Keeps the first point of every sampled Cartesian packet for the preview, other formats are skipped. */
+struct PreviewPointVisitor
+{
+    QList<LivoxRawPoint>& pnts;
+
+    template <typename Range>
+    void operator()( const Range& ) {}
+
+    void operator()( const livox::PointRange<LivoxRawPoint>& points )
+    {
+        if ( !points.empty() )
+            pnts.push_back( points[0] );
+    }
+};
 
 //=======================================================================================
 /** Static function in LdsLidar for callback or event process ------------------------------------*/
@@ -199,31 +213,8 @@ void LdsLidar::GetLidarDataCb( const uint8_t handle,
             /** Parsing the timestamp and the point cloud data. */
             uint64_t cur_timestamp = *( (uint64_t *)( data->timestamp ) );
 
-            if( data ->data_type == kCartesian )
-            {
-                LivoxRawPoint *p_point_data = (LivoxRawPoint *)data->data;
-                auto bufer = data->data;
-                cout << bufer << endl;
-                _pnts.push_back( *p_point_data );
-            }
-
-            else if ( data ->data_type == kSpherical )
-                LivoxSpherPoint *p_point_data = (LivoxSpherPoint *)data->data;
-
-            else if ( data ->data_type == kExtendCartesian )
-                LivoxExtendRawPoint *p_point_data = (LivoxExtendRawPoint *)data->data;
-
-            else if ( data ->data_type == kExtendSpherical )
-                LivoxExtendSpherPoint *p_point_data = (LivoxExtendSpherPoint *)data->data;
-
-            else if ( data ->data_type == kDualExtendCartesian )
-                LivoxDualExtendRawPoint *p_point_data = (LivoxDualExtendRawPoint *)data->data;
-
-            else if ( data ->data_type == kDualExtendSpherical )
-                LivoxDualExtendSpherPoint *p_point_data = (LivoxDualExtendSpherPoint *)data->data;
-
-            else if ( data ->data_type == kImu )
-                LivoxImuPoint *p_point_data = (LivoxImuPoint *)data->data;
+            PreviewPointVisitor visitor = { _pnts };
+            livox::VisitPacket( data, data_num, visitor );
         }
     }
 
@@ -33,6 +33,7 @@
 
 #include "livox_def.h"
 #include "livox_sdk.h"
+#include "livox_packet_view.h"
 
 #include <Q3DScatter>
 #include "customscatter.h"
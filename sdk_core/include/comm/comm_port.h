@@ -29,14 +29,19 @@
 #include "protocol.h"
 
 namespace livox {
+/** Size of the receive ring, a power of two. */
 const uint32_t kCacheSize = 8192;
-const uint32_t kMoveCacheLimit = 1536;
+/** Bytes past the end of the ring mirroring its head, the largest packet handed out in one piece. */
+const uint32_t kCacheMirrorSize = 1536;
 
+/**
+ * Receive ring. rd_idx and wr_idx count bytes since the start and wrap
+ * around at 2^32, the byte at position i is buf[i & (kCacheSize - 1)].
+ */
 typedef struct {
-  uint8_t buf[kCacheSize];
+  uint8_t buf[kCacheSize + kCacheMirrorSize];
   uint32_t rd_idx;
   uint32_t wr_idx;
-  uint32_t size;
 } PortCache;
 
 class CommPort {
@@ -47,8 +52,13 @@ class CommPort {
 
   int32_t Pack(uint8_t *o_buf, uint32_t o_buf_size, uint32_t *o_len, const CommPacket &i_packet);
 
+  /**
+   * Parse the next packet out of the received bytes. The data of o_pack points into the cache and stays valid
+   * until the next call to any of the cache functions.
+   */
   int32_t ParseCommStream(CommPacket *o_pack);
 
+  /** Contiguous free space to receive into, which may run past the end of the ring into the mirror. */
   uint8_t *FetchCacheFreeSpace(uint32_t *o_len);
 
   int32_t UpdateCacheWrIdx(uint32_t used_size);
@@ -56,11 +66,13 @@ class CommPort {
   uint16_t GetAndUpdateSeqNum();
 
  private:
-  uint32_t GetCacheTailSize();
-
   uint32_t GetValidDataSize();
 
-  void UpdateCache(void);
+  /** Move rd_idx to the next start of frame byte, false if there is none. */
+  bool FindSof();
+
+  /** Make the len bytes at rd_idx contiguous by copying the wrapped part into the mirror. */
+  uint8_t *Contiguous(uint32_t len);
 
   PortCache cache_;
   Protocol *protocol_;
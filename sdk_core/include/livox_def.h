@@ -30,6 +30,8 @@
 //=======================================================================================
 
 static constexpr auto kMaxLidarCount = 32;
+static constexpr auto kMaxRoiShapes = 32;
+static constexpr auto kMaxRoiVertices = 16;
 
 //=======================================================================================
 
@@ -165,6 +167,233 @@ typedef enum
 
 //=======================================================================================
 
+/** What to do when the data queue of a device is full. */
+typedef enum
+{
+  kDataQueueDropOldest = 0, /**< Discard the oldest queued packet to make room for the new one. */
+  kDataQueueDropNewest = 1, /**< Discard the newly received packet. */
+  kDataQueueBlock = 2       /**< Stall the receive thread until the data callback catches up. */
+} DataQueuePolicy;
+
+//=======================================================================================
+
+/** Event loop backend of the SDK threads, see \ref SetIoLoopBackend. */
+typedef enum
+{
+  kIoLoopBackendApr = 0,   /**< APR pollset, available everywhere. */
+  kIoLoopBackendEpoll = 1  /**< Edge-triggered epoll, Linux only, the default on Linux. */
+} IoLoopBackend;
+
+//=======================================================================================
+
+/** Number of buckets of \ref LivoxLatencyHistogram. */
+static constexpr auto kLatencyBucketCount = 20;
+
+/**
+ * Histogram of durations in power of two buckets: bucket 0 counts the durations below 1 us, bucket i the durations
+ * from 2^(i-1) us to below 2^i us, the last bucket also counts all the longer ones.
+ */
+typedef struct
+{
+  uint64_t count;                          /**< Number of recorded durations. */
+  uint64_t total;                          /**< Sum of the recorded durations, Unit:us */
+  uint64_t max;                            /**< Longest recorded duration, Unit:us */
+  uint64_t buckets[kLatencyBucketCount];   /**< Number of durations in every bucket. */
+} LivoxLatencyHistogram;
+
+/** Instrumentation of the SDK threads and data path, see \ref EnableInstrumentation. */
+typedef struct
+{
+  LivoxLatencyHistogram loop_iteration;    /**< Time an event loop spends per wakeup, excluding the wait. */
+  LivoxLatencyHistogram dispatch_delay;    /**< Time from the poll reporting a socket ready to its handler running. */
+  LivoxLatencyHistogram data_delegate;     /**< Duration of the point data socket handlers, per wakeup. */
+  LivoxLatencyHistogram imu_delegate;      /**< Duration of the IMU socket handlers, per wakeup. */
+  LivoxLatencyHistogram command_delegate;  /**< Duration of the command and discovery socket handlers, per wakeup. */
+  LivoxLatencyHistogram tasks;             /**< Time an event loop spends on its posted tasks, per wakeup. */
+  LivoxLatencyHistogram data_dispatch;     /**< Duration of the data path of a packet, including all callbacks. */
+  LivoxLatencyHistogram data_callback;     /**< Duration of the \ref DataCallback. */
+  LivoxLatencyHistogram imu_callback;      /**< Duration of the \ref ImuDataCallback. */
+  LivoxLatencyHistogram command_callback;  /**< Duration of the command responses and messages handling. */
+  uint32_t task_queue_depth;               /**< Tasks run by the last event loop wakeup. */
+  uint32_t task_queue_high_water_mark;     /**< Most tasks ever run by one event loop wakeup. */
+} LivoxInstrumentation;
+
+//=======================================================================================
+
+/** Counters of the data queue of a device. */
+typedef struct
+{
+  uint64_t received;        /**< Number of packets put into the queue. */
+  uint64_t dropped;         /**< Number of packets discarded because the queue was full. */
+  uint32_t size;            /**< Number of packets waiting in the queue. */
+  uint32_t high_water_mark; /**< Maximum number of packets ever waiting in the queue. */
+  uint32_t capacity;        /**< Capacity of the queue in packets. */
+} DataQueueStatus;
+
+//=======================================================================================
+
+/**
+ * Structure-of-arrays point buffer filled by the point conversion functions, see \ref ConvertPacketToPointBuffer.
+ * The arrays are allocated by the caller and each holds at least capacity points.
+ */
+typedef struct
+{
+  float* x;                 /**< X axis, Unit:m */
+  float* y;                 /**< Y axis, Unit:m */
+  float* z;                 /**< Z axis, Unit:m */
+  uint8_t* reflectivity;    /**< Reflectivity, may be NULL. */
+  uint8_t* tag;             /**< Tag, 0 for formats without tag, may be NULL. */
+  uint64_t* timestamp;      /**< Sampling time of every point in ns, see \ref LivoxPacketTimeBase, may be NULL. */
+  uint32_t capacity;        /**< Number of points each array can hold. */
+  uint32_t size;            /**< Number of points in the buffer, conversions append after it. */
+} LivoxPointBuffer;
+
+//=======================================================================================
+
+/**
+ * Sampling time of the points of a packet in compact form: point i of the packet, counting both returns of a dual
+ * return point as two points, was sampled at timestamp + (i / points_per_interval) * interval. The timestamp of
+ * every \ref TimestampType is normalized to ns; for \ref kTimestampTypePpsGps it is the UTC time since 1970-01-01,
+ * for the other types the time keeps the epoch of the sync source.
+ */
+typedef struct
+{
+  uint64_t timestamp;           /**< Time of the first point, Unit:ns */
+  uint32_t interval;            /**< Time between two samples, Unit:ns */
+  uint32_t points_per_interval; /**< Points sampled at the same time, 2 for dual return data, 1 otherwise. */
+} LivoxPacketTimeBase;
+
+//=======================================================================================
+
+/** Configuration of the frame builder, see \ref SetFrameBuilder. */
+typedef struct
+{
+  uint32_t duration;        /**< Frame duration in LiDAR time, 0 to close frames by point count only, Unit:us */
+  uint32_t max_points;      /**< Point capacity of a frame, a frame is closed when the next packet does not fit. */
+  uint32_t subframe_points; /**< Also deliver the points in sub-frames of at least this many points, 0 to disable. */
+} LivoxFrameConfig;
+
+//=======================================================================================
+
+/** Points of a frame, or of a sub-frame, built from consecutive packets of a device. */
+typedef struct
+{
+  LivoxPointBuffer points;  /**< Points in metres, points.size points with timestamps. */
+  uint64_t start_time;      /**< Time of the first point, Unit:ns */
+  uint64_t end_time;        /**< Time of the last point, Unit:ns */
+  uint32_t frame_index;     /**< Index of the frame, a sub-frame has the index of the frame it belongs to. */
+  uint8_t is_subframe;      /**< 1 for a sub-frame, 0 for a complete frame. */
+} LivoxFrame;
+
+//=======================================================================================
+
+/** Configuration of the multi-LiDAR merge, see \ref StartFrameMerge. */
+typedef struct
+{
+  uint32_t period;          /**< Merged frame period on the common time grid, Unit:us */
+  uint32_t max_latency;     /**< Longest a frame waits for the devices lagging behind, in LiDAR time, Unit:us */
+  uint32_t max_points;      /**< Point capacity of a merged frame, points beyond it are dropped. */
+} LivoxMergeConfig;
+
+//=======================================================================================
+
+/** Points of all the merged devices in one period of the common time grid. */
+typedef struct
+{
+  LivoxPointBuffer points;  /**< Points in metres with timestamps, in the frame of the host extrinsic parameters. */
+  uint8_t* handles;         /**< Device handle of every point. */
+  uint64_t start_time;      /**< Start of the period, Unit:ns */
+  uint64_t end_time;        /**< End of the period, Unit:ns */
+  uint32_t device_mask;     /**< Bit i is set if the device of handle i contributed points. */
+  uint32_t dropped_points;  /**< Points of the period dropped because the frame was full. */
+} LivoxMergedFrame;
+
+//=======================================================================================
+
+/** Pose of a device in a fixed world frame, see \ref PushDevicePose. */
+typedef struct
+{
+  uint64_t timestamp;       /**< Time of the pose, on the clock of the point timestamps, Unit:ns */
+  float qw;                 /**< Orientation quaternion, real part. */
+  float qx;                 /**< Orientation quaternion, X. */
+  float qy;                 /**< Orientation quaternion, Y. */
+  float qz;                 /**< Orientation quaternion, Z. */
+  float x;                  /**< X position, Unit:m */
+  float y;                  /**< Y position, Unit:m */
+  float z;                  /**< Z position, Unit:m */
+} LivoxPose;
+
+//=======================================================================================
+
+/** How the points falling in one voxel are reduced, see \ref LivoxVoxelConfig. */
+typedef enum
+{
+  kVoxelCentroid = 0,   /**< Mean of the points, the reflectivity and the timestamp are averaged too. */
+  kVoxelFirstPoint = 1  /**< First point of the voxel in the frame. */
+} VoxelMode;
+
+//=======================================================================================
+
+/** Configuration of the voxel grid downsampling of frames, see \ref SetVoxelFilter. */
+typedef struct
+{
+  float leaf_size;          /**< Edge of the voxels near the origin, Unit:m */
+  float size_per_metre;     /**< Growth of the voxel edge per metre of range, 0 for a uniform grid. */
+  uint8_t mode;             /**< Point reduction, see \ref VoxelMode. */
+} LivoxVoxelConfig;
+
+//=======================================================================================
+
+/**
+ * Points dropped before the point buffers of a device are delivered, see \ref SetPointFilter. The tag of the
+ * extended formats flags noise in bits 0-1 (spatial position) and bits 2-3 (intensity), 01 for high, 10 for
+ * moderate and 11 for low confidence; a tag_mask of 0x0F drops every point flagged as noise.
+ */
+typedef struct
+{
+  uint8_t tag_mask;         /**< Drop the points whose tag has any of these bits set, 0 to keep every tag. */
+  uint8_t drop_zero;        /**< Drop the points without a return, at zero distance or with invalid angles. */
+} LivoxPointFilter;
+
+//=======================================================================================
+
+/** Shape of a region of interest, see \ref LivoxRoiShape. */
+typedef enum
+{
+  kRoiShapePrism = 0,  /**< Polygon in the x/y plane extruded along z. */
+  kRoiShapeBox = 1     /**< Axis aligned box. */
+} RoiShapeType;
+
+//=======================================================================================
+
+/** One shape of a region of interest, in the frame of the host extrinsic parameters. */
+typedef struct
+{
+  uint8_t type;                         /**< Shape type, see \ref RoiShapeType. */
+  uint8_t vertex_count;                 /**< Vertices of the prism polygon, 3 to kMaxRoiVertices. */
+  float vertices[kMaxRoiVertices][2];   /**< Prism polygon x and y in order, Unit:m */
+  float min[3];                         /**< Box lower corner, min[2] is also the prism bottom, Unit:m */
+  float max[3];                         /**< Box upper corner, max[2] is also the prism top, Unit:m */
+} LivoxRoiShape;
+
+//=======================================================================================
+
+/**
+ * Region of interest of a device, see \ref SetRoiFilter. A point is kept if it is inside one of the shapes, or
+ * there are no shapes, and inside the range and azimuth limits, which are measured from the sensor.
+ */
+typedef struct
+{
+  const LivoxRoiShape* shapes;  /**< Shapes of the region, copied by \ref SetRoiFilter. */
+  uint32_t shape_count;         /**< Number of shapes, up to kMaxRoiShapes, 0 for none. */
+  float min_range;              /**< Minimum distance to the sensor, Unit:m */
+  float max_range;              /**< Maximum distance to the sensor, 0 for no limit, Unit:m */
+  float azimuth_begin;          /**< Start of the azimuth sector, counterclockwise from the sensor x axis, Unit:degree */
+  float azimuth_end;            /**< End of the azimuth sector, equal to azimuth_begin for no limit, Unit:degree */
+} LivoxRoiConfig;
+
+//=======================================================================================
+
 #pragma pack(1)
 
 //=======================================================================================
@@ -202,8 +431,8 @@ typedef struct
 typedef struct
 {
   uint32_t depth;       /**< Radial distance, Unit:mm */
-  uint16_t theta;       /**< Polar angle, Unit:0.01rad */
-  uint16_t phi;         /**< Azimuthal angle, Unit:0.01rad */
+  uint16_t theta;       /**< Zenith angle[0, 18000], Unit:0.01 degree */
+  uint16_t phi;         /**< Azimuth angle[0, 36000], Unit:0.01 degree */
   uint8_t reflectivity; /**< Reflectivity */
 } LivoxSpherPoint;
 
@@ -236,8 +465,8 @@ typedef struct
 typedef struct
 {
   uint32_t depth;       /**< Radial distance, Unit:mm */
-  uint16_t theta;       /**< Polar angle, Unit:0.01rad */
-  uint16_t phi;         /**< Azimuthal angle, Unit:0.01rad */
+  uint16_t theta;       /**< Zenith angle[0, 18000], Unit:0.01 degree */
+  uint16_t phi;         /**< Azimuth angle[0, 36000], Unit:0.01 degree */
   uint8_t reflectivity; /**< Reflectivity */
   uint8_t tag;          /**< Tag */
 } LivoxExtendSpherPoint;
@@ -264,8 +493,8 @@ typedef struct
 /** Dual extend spherical coordinate format. */
 typedef struct
 {
-  uint16_t theta;        /**< Polar angle, Unit:0.01rad */
-  uint16_t phi;          /**< Azimuthal angle, Unit:0.01rad */
+  uint16_t theta;        /**< Zenith angle[0, 18000], Unit:0.01 degree */
+  uint16_t phi;          /**< Azimuth angle[0, 36000], Unit:0.01 degree */
   uint32_t depth1;       /**< Radial distance, Unit:mm */
   uint8_t reflectivity1; /**< Reflectivity */
   uint8_t tag1;          /**< Tag */
@@ -289,6 +518,15 @@ typedef struct
 
 //=======================================================================================
 
+/** IMU sample of a device with its time, see \ref GetImuAt. */
+typedef struct
+{
+  uint64_t timestamp;   /**< Sampling time in the LiDAR time base, Unit:ns */
+  LivoxImuPoint imu;    /**< Angular rate and acceleration. */
+} LivoxImuSample;
+
+//=======================================================================================
+
 /** LiDAR error code. */
 typedef struct
 {
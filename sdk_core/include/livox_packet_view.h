@@ -0,0 +1,263 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_PACKET_VIEW_H_
+#define LIVOX_PACKET_VIEW_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "livox_def.h"
+
+/**
+ * Typed access to the points of a LivoxEthPacket, C++ only. The point format is
+ * resolved once per packet (or once per run of same-format packets) by
+ * \ref livox::VisitPacket, the visitor then loops over a range of concrete point
+ * structs, so its inner loop is compiled separately for every format.
+ */
+namespace livox {
+
+//=======================================================================================
+
+/** Size of the LivoxEthPacket header in front of the point data. */
+static const uint32_t kEthPacketHeaderSize = offsetof(LivoxEthPacket, data);
+
+//=======================================================================================
+
+/**
+ * Point struct, standard point count of a packet and nominal sampling interval in ns between two consecutive points
+ * of the given \ref PointDataType. Both returns of a dual return point are sampled at the same time, and dual return
+ * records follow each other at the single return rate.
+ */
+template <int data_type>
+struct PointTraits;
+
+template <>
+struct PointTraits<kCartesian> {
+  typedef LivoxRawPoint PointType;
+  static const uint32_t kPointsPerPacket = 100;
+  static const uint32_t kPointInterval = 10000;
+};
+
+template <>
+struct PointTraits<kSpherical> {
+  typedef LivoxSpherPoint PointType;
+  static const uint32_t kPointsPerPacket = 100;
+  static const uint32_t kPointInterval = 10000;
+};
+
+template <>
+struct PointTraits<kExtendCartesian> {
+  typedef LivoxExtendRawPoint PointType;
+  static const uint32_t kPointsPerPacket = 96;
+  static const uint32_t kPointInterval = 4167;
+};
+
+template <>
+struct PointTraits<kExtendSpherical> {
+  typedef LivoxExtendSpherPoint PointType;
+  static const uint32_t kPointsPerPacket = 96;
+  static const uint32_t kPointInterval = 4167;
+};
+
+template <>
+struct PointTraits<kDualExtendCartesian> {
+  typedef LivoxDualExtendRawPoint PointType;
+  static const uint32_t kPointsPerPacket = 48;
+  static const uint32_t kPointInterval = 4167;
+};
+
+template <>
+struct PointTraits<kDualExtendSpherical> {
+  typedef LivoxDualExtendSpherPoint PointType;
+  static const uint32_t kPointsPerPacket = 48;
+  static const uint32_t kPointInterval = 4167;
+};
+
+template <>
+struct PointTraits<kImu> {
+  typedef LivoxImuPoint PointType;
+  static const uint32_t kPointsPerPacket = 1;
+  static const uint32_t kPointInterval = 0;
+};
+
+//=======================================================================================
+
+/** Size of one point of the given \ref PointDataType, 0 for an unknown type. */
+inline uint32_t PointSizeOf(uint8_t data_type) {
+  static const uint32_t kPointSizes[kMaxPointDataType] = {
+      sizeof(PointTraits<kCartesian>::PointType),           sizeof(PointTraits<kSpherical>::PointType),
+      sizeof(PointTraits<kExtendCartesian>::PointType),     sizeof(PointTraits<kExtendSpherical>::PointType),
+      sizeof(PointTraits<kDualExtendCartesian>::PointType), sizeof(PointTraits<kDualExtendSpherical>::PointType),
+      sizeof(PointTraits<kImu>::PointType)};
+  return data_type < kMaxPointDataType ? kPointSizes[data_type] : 0;
+}
+
+/** Standard number of points in a packet of the given \ref PointDataType, 0 for an unknown type. */
+inline uint32_t PointsPerPacket(uint8_t data_type) {
+  static const uint32_t kPointCounts[kMaxPointDataType] = {
+      PointTraits<kCartesian>::kPointsPerPacket,           PointTraits<kSpherical>::kPointsPerPacket,
+      PointTraits<kExtendCartesian>::kPointsPerPacket,     PointTraits<kExtendSpherical>::kPointsPerPacket,
+      PointTraits<kDualExtendCartesian>::kPointsPerPacket, PointTraits<kDualExtendSpherical>::kPointsPerPacket,
+      PointTraits<kImu>::kPointsPerPacket};
+  return data_type < kMaxPointDataType ? kPointCounts[data_type] : 0;
+}
+
+/** Nominal sampling interval in ns between two points of the given \ref PointDataType, 0 for an unknown type. */
+inline uint32_t PointIntervalOf(uint8_t data_type) {
+  static const uint32_t kPointIntervals[kMaxPointDataType] = {
+      PointTraits<kCartesian>::kPointInterval,           PointTraits<kSpherical>::kPointInterval,
+      PointTraits<kExtendCartesian>::kPointInterval,     PointTraits<kExtendSpherical>::kPointInterval,
+      PointTraits<kDualExtendCartesian>::kPointInterval, PointTraits<kDualExtendSpherical>::kPointInterval,
+      PointTraits<kImu>::kPointInterval};
+  return data_type < kMaxPointDataType ? kPointIntervals[data_type] : 0;
+}
+
+/** Number of points carried by a packet of packet_size bytes, 0 if the packet is malformed. */
+inline uint32_t PacketPointCount(const LivoxEthPacket *packet, uint32_t packet_size) {
+  uint32_t point_size = PointSizeOf(packet->data_type);
+  if (point_size == 0 || packet_size < kEthPacketHeaderSize) {
+    return 0;
+  }
+  return (packet_size - kEthPacketHeaderSize) / point_size;
+}
+
+//=======================================================================================
+
+/** Contiguous range of the points of one packet, usable in range-based for loops. */
+template <typename Point>
+class PointRange {
+ public:
+  typedef Point PointType;
+
+  /**
+   * @param packet     the packet, its data_type must match Point.
+   * @param point_num  number of points in the packet, as passed to the data callbacks.
+   */
+  PointRange(LivoxEthPacket *packet, uint32_t point_num)
+      : packet_(packet), begin_(reinterpret_cast<Point *>(packet->data)), end_(begin_ + point_num) {}
+
+  LivoxEthPacket *packet() const { return packet_; }
+  Point *begin() const { return begin_; }
+  Point *end() const { return end_; }
+  uint32_t size() const { return static_cast<uint32_t>(end_ - begin_); }
+  bool empty() const { return begin_ == end_; }
+  Point &operator[](uint32_t index) const { return begin_[index]; }
+
+ private:
+  LivoxEthPacket *packet_;
+  Point *begin_;
+  Point *end_;
+};
+
+//=======================================================================================
+
+namespace detail {
+
+template <int data_type, typename Visitor>
+inline void VisitRun(LivoxEthPacket **packets, const uint32_t *data_nums, uint32_t count, Visitor &visitor) {
+  typedef typename PointTraits<data_type>::PointType Point;
+  for (uint32_t i = 0; i < count; i++) {
+    visitor(PointRange<Point>(packets[i], data_nums[i]));
+  }
+}
+
+template <typename Visitor>
+inline bool VisitRun(uint8_t data_type,
+                     LivoxEthPacket **packets,
+                     const uint32_t *data_nums,
+                     uint32_t count,
+                     Visitor &visitor) {
+  switch (data_type) {
+    case kCartesian:
+      VisitRun<kCartesian>(packets, data_nums, count, visitor);
+      return true;
+    case kSpherical:
+      VisitRun<kSpherical>(packets, data_nums, count, visitor);
+      return true;
+    case kExtendCartesian:
+      VisitRun<kExtendCartesian>(packets, data_nums, count, visitor);
+      return true;
+    case kExtendSpherical:
+      VisitRun<kExtendSpherical>(packets, data_nums, count, visitor);
+      return true;
+    case kDualExtendCartesian:
+      VisitRun<kDualExtendCartesian>(packets, data_nums, count, visitor);
+      return true;
+    case kDualExtendSpherical:
+      VisitRun<kDualExtendSpherical>(packets, data_nums, count, visitor);
+      return true;
+    case kImu:
+      VisitRun<kImu>(packets, data_nums, count, visitor);
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace detail
+
+//=======================================================================================
+
+/**
+ * Call visitor(PointRange<Point>) with the concrete point struct of the packet. The visitor is typically a functor
+ * with a templated operator(), or a generic lambda.
+ * @param packet     the packet.
+ * @param point_num  number of points in the packet, as passed to the data callbacks.
+ * @param visitor    the visitor.
+ * @return false if the packet has an unknown data type.
+ */
+template <typename Visitor>
+inline bool VisitPacket(LivoxEthPacket *packet, uint32_t point_num, Visitor &visitor) {
+  return detail::VisitRun(packet->data_type, &packet, &point_num, 1, visitor);
+}
+
+/**
+ * Visit a batch of packets, dispatching once per run of packets sharing the same data type.
+ * @param packets    the packets.
+ * @param data_nums  number of points in each packet.
+ * @param count      number of packets.
+ * @param visitor    the visitor, see \ref VisitPacket.
+ * @return number of packets visited, packets of unknown data type are skipped.
+ */
+template <typename Visitor>
+inline uint32_t VisitPackets(LivoxEthPacket **packets, const uint32_t *data_nums, uint32_t count, Visitor &visitor) {
+  uint32_t visited = 0;
+  uint32_t start = 0;
+  while (start < count) {
+    uint8_t data_type = packets[start]->data_type;
+    uint32_t end = start + 1;
+    while (end < count && packets[end]->data_type == data_type) {
+      ++end;
+    }
+    if (detail::VisitRun(data_type, packets + start, data_nums + start, end - start, visitor)) {
+      visited += end - start;
+    }
+    start = end;
+  }
+  return visited;
+}
+
+}  // namespace livox
+
+#endif  // LIVOX_PACKET_VIEW_H_
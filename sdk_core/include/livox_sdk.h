@@ -73,6 +73,37 @@ void SaveLoggerFile();
 
 //=======================================================================================
 
+/**
+ * Select the event loop backend of the SDK threads. Call it before \ref Init. The epoll backend waits for the
+ * sockets edge-triggered and wakes up through an eventfd, it falls back to the APR pollset if it cannot be set up.
+ * @param backend  the backend, \ref kIoLoopBackendEpoll by default on Linux, \ref kIoLoopBackendApr elsewhere.
+ * @return kStatusSuccess on successful return, kStatusNotSupported if the backend is not available on this
+ * platform, see \ref LivoxStatus for other error code.
+ */
+livox_status SetIoLoopBackend( const IoLoopBackend backend );
+
+//=======================================================================================
+
+/**
+ * Start or stop recording the latency histograms of the SDK threads, see \ref LivoxInstrumentation. Starting resets
+ * the histograms. Recording is off by default and costs one flag check per probe then.
+ * @param enable         true to start recording, false to stop.
+ * @param dump_interval  log the histograms every dump_interval ms while recording, 0 to never log them. The log
+ * is written by the first SDK thread to wake up after the interval.
+ */
+void EnableInstrumentation( const bool enable, const uint32_t dump_interval );
+
+//=======================================================================================
+
+/**
+ * Get the latency histograms recorded since \ref EnableInstrumentation started recording.
+ * @param snapshot  the histograms.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status GetInstrumentationSnapshot( LivoxInstrumentation* snapshot );
+
+//=======================================================================================
+
 /**
  * @c SetBroadcastCallback response callback function.
  * @param info information of the broadcast device, becomes invalid after the function returns.
@@ -203,6 +234,579 @@ void SetDataCallback( const uint8_t handle,
 
 //=======================================================================================
 
+/** Reference to a received point cloud packet, keeps the packet buffer alive until released. */
+typedef struct LivoxPacketLease LivoxPacketLease;
+
+//=======================================================================================
+
+/**
+ * Callback function for receiving point cloud data without copying it. The packet stays valid after the callback
+ * returns if the lease is retained with \ref RetainPacketLease.
+ * @param handle      device handle.
+ * @param lease       lease of the packet buffer, valid during the callback.
+ * @param data        device's data.
+ * @param data_num    number of points in data.
+ * @param client_data user data associated with the command.
+ */
+typedef void (*DataLeaseCallback)( const uint8_t handle,
+                                   LivoxPacketLease* lease,
+                                   LivoxEthPacket* data,
+                                   const uint32_t data_num,
+                                   void* client_data );
+
+//=======================================================================================
+
+/**
+ * Set the callback to receive point cloud data together with the lease of its packet buffer. Packets are received
+ * into a shared pool of buffers, holding a lease keeps the buffer out of the pool instead of copying the packet.
+ * Set the callback before beginning sampling.
+ * @param handle      device handle.
+ * @param cb          callback to receive point cloud data, NULL to remove it.
+ * @param client_data user data associated with the command.
+ */
+void SetDataLeaseCallback( const uint8_t handle,
+                           const DataLeaseCallback cb,
+                           void* client_data );
+
+//=======================================================================================
+
+/**
+ * Keep a packet past the \ref DataLeaseCallback, each call must be paired with \ref ReleasePacketLease.
+ * @param lease  lease passed to the callback.
+ */
+void RetainPacketLease( LivoxPacketLease* lease );
+
+//=======================================================================================
+
+/**
+ * Give a retained packet back to the buffer pool. The lease and its data must not be used afterwards.
+ * @param lease  lease retained with \ref RetainPacketLease.
+ */
+void ReleasePacketLease( LivoxPacketLease* lease );
+
+//=======================================================================================
+
+/**
+ * Get the packet held by a lease.
+ * @param lease  a valid lease.
+ * @param size   size of the packet in bytes, may be NULL.
+ * @return the packet, NULL if the lease is NULL.
+ */
+LivoxEthPacket* GetPacketLeaseData( LivoxPacketLease* lease, uint32_t* size );
+
+//=======================================================================================
+
+/**
+ * Set the maximum number of packet buffers shared by all the devices. Packets received while every buffer is
+ * leased or queued are discarded, so retained leases should be released promptly.
+ * @param buffer_count  number of 1500 byte buffers, 64 at least, 8192 by default.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetDataBufferPoolSize( const uint32_t buffer_count );
+
+//=======================================================================================
+
+/**
+ * Callback function for receiving point cloud data in batches.
+ * @param handle      device handle.
+ * @param packets     packets of the batch, valid during the callback.
+ * @param data_nums   number of points in each packet.
+ * @param packet_num  number of packets in the batch.
+ * @param client_data user data associated with the command.
+ */
+typedef void (*BatchDataCallback)( const uint8_t handle,
+                                   LivoxEthPacket** packets,
+                                   uint32_t* data_nums,
+                                   const uint32_t packet_num,
+                                   void* client_data );
+
+//=======================================================================================
+
+/**
+ * Set the callback to receive point cloud data of a device several packets at a time. A batch is delivered once
+ * max_batch packets are pending, or when a packet arrives later than max_delay_us after the first packet of the
+ * batch. When the data stream pauses, a timer flushes the partial batch at its deadline, within the millisecond
+ * resolution of the SDK timers. That timer runs on the receive thread of the device, the thread filling the batches
+ * unless the device has a data queue, see \ref SetDataQueue. The batch still pending when the device disconnects is
+ * delivered during the disconnection. It can be used together with \ref SetDataCallback. Set the callback before
+ * beginning sampling.
+ * @param handle        device handle.
+ * @param cb            callback to receive the batches, NULL to remove it.
+ * @param max_batch     maximum number of packets in a batch, 1 to 1024.
+ * @param max_delay_us  maximum time in microseconds a packet waits for its batch to fill.
+ * @param client_data   user data associated with the command.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetBatchDataCallback( const uint8_t handle,
+                                   const BatchDataCallback cb,
+                                   const uint32_t max_batch,
+                                   const uint32_t max_delay_us,
+                                   void* client_data );
+
+//=======================================================================================
+
+/**
+ * Callback function receiving the frames of a device.
+ * @param handle      device handle.
+ * @param frame       the frame, or the sub-frame if frame->is_subframe is set. A complete frame stays valid until
+ *                    the next frame of the device completes, a sub-frame only during the callback.
+ * @param client_data user data associated with the command.
+ */
+typedef void (*FrameCallback)( const uint8_t handle, const LivoxFrame* frame, void* client_data );
+
+//=======================================================================================
+
+/**
+ * Group the point cloud data of a device into frames. Points are converted to Cartesian metres with their
+ * timestamps, transformed by the host extrinsic parameters if set, and appended to one of two frame buffers
+ * allocated here, so nothing is allocated per frame. A frame is closed when a packet starts config->duration us of
+ * LiDAR time after the frame, when the LiDAR time goes backwards, or when the next packet does not fit in
+ * config->max_points. With config->subframe_points set, the points are also delivered in sub-frames as they arrive,
+ * before the complete frame. Frames are delivered to cb on the thread dispatching the data, and can be pulled with
+ * \ref AcquireFrame. Set it before beginning sampling.
+ * @param handle      device handle.
+ * @param config      frame configuration, NULL to stop building frames.
+ * @param cb          callback receiving the frames, NULL to only pull them with \ref AcquireFrame.
+ * @param client_data user data associated with the command.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetFrameBuilder( const uint8_t handle,
+                              const LivoxFrameConfig* config,
+                              const FrameCallback cb,
+                              void* client_data );
+
+//=======================================================================================
+
+/**
+ * Take the last complete frame of a device if it was not taken yet. The frame is not overwritten until
+ * \ref ReleaseFrame, frames completed in the meantime are dropped.
+ * @param handle  device handle.
+ * @param frame   receives the frame.
+ * @return kStatusSuccess on successful return, kStatusFailure if no new frame is ready, see \ref LivoxStatus for
+ * other error code.
+ */
+livox_status AcquireFrame( const uint8_t handle, LivoxFrame* frame );
+
+//=======================================================================================
+
+/**
+ * Give back the frame taken with \ref AcquireFrame.
+ * @param handle  device handle.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status ReleaseFrame( const uint8_t handle );
+
+//=======================================================================================
+
+/**
+ * Downsample the frames of a device with a voxel grid, see \ref SetFrameBuilder. The points are folded into the
+ * voxels as the packets arrive, so a frame holds one point per voxel and config->max_points bounds the voxels rather
+ * than the raw points. With config->size_per_metre set, the voxel edge grows with the range of the points. Sub-frames
+ * hold the voxels new since the previous sub-frame, with the first point of each voxel. Takes effect from the next
+ * frame, and is removed when the frame builder is replaced.
+ * @param handle  device handle.
+ * @param config  voxel grid configuration, NULL to stop downsampling.
+ * @return kStatusSuccess on successful return, kStatusFailure if the device has no frame builder or the
+ * configuration is invalid, see \ref LivoxStatus for other error code.
+ */
+livox_status SetVoxelFilter( const uint8_t handle, const LivoxVoxelConfig* config );
+
+//=======================================================================================
+
+/**
+ * Callback function receiving the merged frames.
+ * @param frame       the merged frame, valid during the callback.
+ * @param client_data user data associated with the command.
+ */
+typedef void (*MergedFrameCallback)( const LivoxMergedFrame* frame, void* client_data );
+
+//=======================================================================================
+
+/**
+ * Merge the point cloud data of several devices, connected directly or through a hub, into frames of a common time
+ * grid of config->period us. The devices must share a time base, for instance through PTP or GPS sync. Each packet
+ * goes to the period of its first point, converted to Cartesian metres with timestamps and transformed by the host
+ * extrinsic parameters of its device, see \ref SetHostExtrinsicParameter. Packets are decoded in parallel on the
+ * threads dispatching the data of each device, enable \ref SetDataQueue to get one thread per device behind a hub.
+ * A frame is delivered once every device has sent data past its end, or at the latest config->max_latency us of
+ * LiDAR time after its end; packets arriving later are dropped. Memory is allocated here and bounded by
+ * config->max_points points for each of the max_latency / period + 2 frames in flight, at most 64. Starting a new
+ * merge replaces the previous one.
+ * @param handles       handles of the devices to merge.
+ * @param handle_count  number of handles.
+ * @param config        merge configuration.
+ * @param cb            callback receiving the merged frames, on the thread of the device completing the frame.
+ * @param client_data   user data associated with the command.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status StartFrameMerge( const uint8_t* handles,
+                              const uint8_t handle_count,
+                              const LivoxMergeConfig* config,
+                              const MergedFrameCallback cb,
+                              void* client_data );
+
+//=======================================================================================
+
+/**
+ * Deliver the frames pending in the merge and stop merging.
+ */
+void StopFrameMerge();
+
+//=======================================================================================
+
+/**
+ * Remove the motion distortion of the frames of a device: every point of a frame is moved to where it would have
+ * been measured at the time of the last point. The motion is integrated from the gyroscope of the device IMU
+ * packets, assumed aligned with the LiDAR axes, which corrects the rotation only. Once a pose is pushed with
+ * \ref PushDevicePose, the pushed poses replace the IMU and correct the translation as well. Merged frames are
+ * not corrected.
+ * @param handle  device handle.
+ * @param enable  true to correct the frames, false to stop and drop the tracked motion.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetMotionDeskew( const uint8_t handle, const bool enable );
+
+//=======================================================================================
+
+/**
+ * Push a pose of a device from an external source, such as an odometry, in the order of time.
+ * @param handle  device handle.
+ * @param pose    the pose of the device at pose->timestamp, in the LiDAR time base.
+ * @return kStatusSuccess on successful return, kStatusFailure if the motion de-skew is not enabled, see \ref
+ * LivoxStatus for other error code.
+ */
+livox_status PushDevicePose( const uint8_t handle, const LivoxPose* pose );
+
+//=======================================================================================
+
+/**
+ * Remove the motion distortion of a point buffer with the motion tracked for a device, see \ref SetMotionDeskew.
+ * The points are expected in the frame set with \ref SetHostExtrinsicParameter, with their timestamps.
+ * @param handle       device handle.
+ * @param buffer       the points to correct in place.
+ * @param target_time  the time the points are moved to, Unit:ns.
+ * @return kStatusSuccess on successful return, kStatusFailure if no motion is tracked or the buffer has no
+ * timestamps, see \ref LivoxStatus for other error code.
+ */
+livox_status DeskewPointBuffer( const uint8_t handle, LivoxPointBuffer* buffer, const uint64_t target_time );
+
+//=======================================================================================
+
+/**
+ * Callback function for receiving IMU samples.
+ * @param handle      device handle.
+ * @param sample      the IMU sample with its time in the LiDAR time base, valid during the callback.
+ * @param client_data user data associated with the callback.
+ */
+typedef void (*ImuDataCallback)( const uint8_t handle, const LivoxImuSample* sample, void* client_data );
+
+//=======================================================================================
+
+/**
+ * Set the callback to receive the IMU samples of a device as soon as they arrive. A LiDAR unit connected directly
+ * sends its IMU data to its own sensor port, received on a dedicated thread, see \ref SetImuRecvThreadPriority;
+ * IMU data sent through a hub arrives with the point cloud data. The IMU packets are still passed to the point
+ * cloud data callback.
+ * @param handle      device handle.
+ * @param cb          callback to receive the IMU samples, NULL to remove it.
+ * @param client_data user data associated with the callback.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetImuDataCallback( const uint8_t handle, const ImuDataCallback cb, void* client_data );
+
+//=======================================================================================
+
+/**
+ * Get the IMU sample of a device at a time, interpolated between the recent samples received around it. The
+ * newest sample is returned for a time after it. It is safe to call from any thread and does not block.
+ * @param handle     device handle.
+ * @param timestamp  the time of the sample in the LiDAR time base, Unit:ns.
+ * @param sample     the IMU sample.
+ * @return kStatusSuccess on successful return, kStatusFailure if no sample is received yet or the time is older than
+ * the kept samples, see \ref LivoxStatus for other error code.
+ */
+livox_status GetImuAt( const uint8_t handle, const uint64_t timestamp, LivoxImuSample* sample );
+
+//=======================================================================================
+
+/**
+ * Get the sampling time of the points of a packet in compact form, the first point time and the interval between
+ * points. The packet timestamp is normalized to ns for every \ref TimestampType, see \ref LivoxPacketTimeBase.
+ * @param packet     the packet passed to the data callback.
+ * @param time_base  the time base of the packet.
+ * @return kStatusSuccess on successful return, kStatusFailure if the UTC timestamp is malformed, see \ref
+ * LivoxStatus for other error code.
+ */
+livox_status GetPacketTimeBase( const LivoxEthPacket* packet, LivoxPacketTimeBase* time_base );
+
+//=======================================================================================
+
+/**
+ * Get the sampling time in ns of every point of a packet, computed with AVX2 when the cpu supports it. A dual
+ * return packet gets 2 * data_num entries, both returns of a point have the same time, in the order of
+ * \ref ConvertPacketToPointBuffer.
+ * @param packet      the packet passed to the data callback.
+ * @param data_num    number of points in the packet, as passed to the data callback.
+ * @param timestamps  array receiving the time of every point.
+ * @param capacity    number of entries of timestamps.
+ * @return kStatusSuccess on successful return, kStatusNotEnoughMemory if the points do not fit, see \ref
+ * LivoxStatus for other error code.
+ */
+livox_status GetPointTimestamps( const LivoxEthPacket* packet,
+                                 const uint32_t data_num,
+                                 uint64_t* timestamps,
+                                 const uint32_t capacity );
+
+//=======================================================================================
+
+/**
+ * Convert the points of a point cloud packet into Cartesian float metres and append them to a structure-of-arrays
+ * buffer. Cartesian formats are converted with AVX2 or SSE4.1 when the cpu supports it. Spherical formats use
+ * a precomputed sine table of the 0.01 degree angle steps, with AVX2 gathers when available; a point whose angles are
+ * out of range is converted as a point at zero distance. Both returns of a dual return packet are appended, so it adds 2 * data_num points. If the buffer has a timestamp array, the sampling
+ * time of every point is written to it as well, see \ref GetPointTimestamps.
+ * @param packet    the packet passed to the data callback.
+ * @param data_num  number of points in the packet, as passed to the data callback.
+ * @param buffer    the buffer to append to, its size is advanced by the number of converted points.
+ * @return kStatusSuccess on successful return, kStatusNotSupported for IMU packets, kStatusNotEnoughMemory if the
+ * points do not fit in the buffer, see \ref LivoxStatus for other error code.
+ */
+livox_status ConvertPacketToPointBuffer( const LivoxEthPacket* packet,
+                                         const uint32_t data_num,
+                                         LivoxPointBuffer* buffer );
+
+//=======================================================================================
+
+/**
+ * Split the two returns of a dual return packet (\ref kDualExtendCartesian or \ref kDualExtendSpherical) into two
+ * structure-of-arrays buffers in one pass, data_num points are appended to each buffer.
+ * @param packet    the packet passed to the data callback.
+ * @param data_num  number of points in the packet, as passed to the data callback.
+ * @param first     buffer of the first returns, NULL to skip them.
+ * @param second    buffer of the second returns, NULL to skip them.
+ * @return kStatusSuccess on successful return, kStatusNotSupported if the packet is not a dual return packet,
+ * kStatusNotEnoughMemory if the points do not fit, see \ref LivoxStatus for other error code.
+ */
+livox_status ConvertDualPacketToPointBuffers( const LivoxEthPacket* packet,
+                                              const uint32_t data_num,
+                                              LivoxPointBuffer* first,
+                                              LivoxPointBuffer* second );
+
+//=======================================================================================
+
+/**
+ * Callback function receiving one return of the points of a dual return packet.
+ * @param handle      device handle.
+ * @param data        the dual return packet.
+ * @param points      the points of the return in metres, valid during the callback.
+ * @param client_data user data associated with the command.
+ */
+typedef void (*ReturnDataCallback)( const uint8_t handle,
+                                    LivoxEthPacket* data,
+                                    const LivoxPointBuffer* points,
+                                    void* client_data );
+
+//=======================================================================================
+
+/**
+ * Set the callbacks receiving the first and the second returns of the dual return point cloud data of a device,
+ * each as a contiguous structure-of-arrays buffer, transformed by the host extrinsic parameters of the device if
+ * set. The callbacks are called after the data callback, on the same thread. Set them before beginning sampling.
+ * @param handle           device handle.
+ * @param first_return_cb  callback of the first returns, NULL if not needed.
+ * @param second_return_cb callback of the second returns, NULL if not needed.
+ * @param client_data      user data associated with the command.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetDualReturnCallback( const uint8_t handle,
+                                    const ReturnDataCallback first_return_cb,
+                                    const ReturnDataCallback second_return_cb,
+                                    void* client_data );
+
+//=======================================================================================
+
+/**
+ * Convert a batch of packets, as passed to the \ref BatchDataCallback, and append their points to a
+ * structure-of-arrays buffer. Packets in formats that cannot be converted are skipped.
+ * @param packets     the packets.
+ * @param data_nums   number of points in each packet.
+ * @param packet_num  number of packets.
+ * @param buffer      the buffer to append to.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status ConvertPacketsToPointBuffer( LivoxEthPacket** packets,
+                                          const uint32_t* data_nums,
+                                          const uint32_t packet_num,
+                                          LivoxPointBuffer* buffer );
+
+//=======================================================================================
+
+/**
+ * Set the extrinsic parameters applied on the host to the points of a device, to bring several LiDAR units into
+ * one vehicle frame. The transform is fused into the point conversion of \ref ConvertDevicePacketToPointBuffer,
+ * \ref ConvertDevicePacketsToPointBuffer and the \ref ReturnDataCallback, so each point is still loaded and stored
+ * once. It can be changed at any time, the swap is atomic and a packet is never converted with a mix of two sets of
+ * parameters. The device itself is not configured, see \ref LidarSetExtrinsicParameter for that.
+ * @param  handle     device handle.
+ * @param  extrinsic  roll, pitch and yaw in degrees, applied as Rz(yaw) * Ry(pitch) * Rx(roll), then the x, y and z
+ *                    translation in mm. NULL to remove the transform.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetHostExtrinsicParameter( const uint8_t handle,
+                                        const LidarSetExtrinsicParameterRequest* extrinsic );
+
+//=======================================================================================
+
+/**
+ * Like \ref ConvertPacketToPointBuffer, with the points transformed by the host extrinsic parameters of the device
+ * and the points rejected by its \ref SetPointFilter filter removed.
+ * @param handle    device handle, as passed to the data callback.
+ * @param packet    the packet passed to the data callback.
+ * @param data_num  number of points in the packet, as passed to the data callback.
+ * @param buffer    the buffer to append to, its size is advanced by the number of converted points.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status ConvertDevicePacketToPointBuffer( const uint8_t handle,
+                                               const LivoxEthPacket* packet,
+                                               const uint32_t data_num,
+                                               LivoxPointBuffer* buffer );
+
+//=======================================================================================
+
+/**
+ * Like \ref ConvertPacketsToPointBuffer, with the points transformed by the host extrinsic parameters of the device
+ * and the points rejected by its \ref SetPointFilter filter removed.
+ * @param handle      device handle, as passed to the batch callback.
+ * @param packets     the packets.
+ * @param data_nums   number of points in each packet.
+ * @param packet_num  number of packets.
+ * @param buffer      the buffer to append to.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status ConvertDevicePacketsToPointBuffer( const uint8_t handle,
+                                                LivoxEthPacket** packets,
+                                                const uint32_t* data_nums,
+                                                const uint32_t packet_num,
+                                                LivoxPointBuffer* buffer );
+
+//=======================================================================================
+
+/**
+ * Drop the points of a device without a return, or flagged as noise by their tag, before they reach the point
+ * buffers: the \ref ReturnDataCallback, the frames, the merged frames and \ref ConvertDevicePacketToPointBuffer.
+ * The points are flagged from the raw packet and the buffers compacted with vector instructions, so the dropped
+ * points are not stored or processed further. The packets of the data callback are not changed.
+ * @param handle  device handle.
+ * @param filter  the points to drop, see \ref LivoxPointFilter. NULL to keep every point.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetPointFilter( const uint8_t handle, const LivoxPointFilter* filter );
+
+//=======================================================================================
+
+/**
+ * Crop the points of a device to a region of interest before they reach the point buffers, like \ref
+ * SetPointFilter. The range and azimuth limits are tested on the raw packet in the sensor frame, before the points
+ * are converted. The shapes are in the frame of the host extrinsic parameters, see \ref SetHostExtrinsicParameter,
+ * and are tested on each packet right after it is converted, through a grid over the shapes precomputed here, before
+ * the points are stored in frames or merged. Set the same region on every merged device to crop the merged frames.
+ * @param handle  device handle.
+ * @param config  the region, see \ref LivoxRoiConfig. NULL to keep every point.
+ * @return kStatusSuccess on successful return, kStatusFailure if the region is invalid, see \ref LivoxStatus for
+ * other error code.
+ */
+livox_status SetRoiFilter( const uint8_t handle, const LivoxRoiConfig* config );
+
+//=======================================================================================
+
+/**
+ * Get the number of points of a device dropped by its \ref SetPointFilter filter so far, counting both returns of
+ * a dual return point.
+ * @param handle  device handle.
+ * @param count   the number of dropped points.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status GetFilteredPointCount( const uint8_t handle, uint64_t* count );
+
+//=======================================================================================
+
+/**
+ * Set the maximum number of point cloud packets drained from a data socket in one receive call. On Linux the
+ * packets are received with a single recvmmsg system call. Call it before the devices are connected, it takes
+ * effect for devices connected afterwards.
+ * @param batch_size  number of packets, 1 to 1024, 32 by default.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetDataRecvBatchSize( const uint32_t batch_size );
+
+//=======================================================================================
+
+/**
+ * Receive the point cloud data of all the LiDAR units on a fixed number of shared threads instead of one thread per
+ * LiDAR unit. Devices are assigned to the threads round-robin by handle unless mapped with
+ * \ref SetDataRecvThreadOfDevice. Call it before the first device is connected.
+ * @param thread_count  number of shared receive threads, 0 for one thread per LiDAR unit (default), 16 at most.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetDataRecvThreadCount( const uint8_t thread_count );
+
+//=======================================================================================
+
+/**
+ * Assign the point cloud data of a LiDAR unit to a specific shared receive thread.
+ * @param handle        device handle.
+ * @param thread_index  index of the shared receive thread, wrapped by the thread count.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetDataRecvThreadOfDevice( const uint8_t handle, const uint8_t thread_index );
+
+//=======================================================================================
+
+/**
+ * Bind a shared receive thread to a cpu core, only supported on Linux. Call it before the first device is
+ * connected.
+ * @param thread_index  index of the shared receive thread.
+ * @param cpu           cpu core index, -1 to leave the thread unbound.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetDataRecvThreadAffinity( const uint8_t thread_index, const int32_t cpu );
+
+//=======================================================================================
+
+/**
+ * Run the thread receiving the IMU data of the LiDAR units with the SCHED_FIFO real-time policy, only supported on
+ * Linux and usually requiring the CAP_SYS_NICE capability. Call it before the first device is connected.
+ * @param priority  real-time priority, 1 to 99, 0 for the default scheduling (default).
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetImuRecvThreadPriority( const int32_t priority );
+
+//=======================================================================================
+
+/**
+ * Deliver the point cloud data of a device through a lock-free queue drained on a dedicated thread, so a slow data
+ * callback does not hold up the receive thread. The data callback is then called on the queue thread. Set it before
+ * beginning sampling. Changing the queue stops the previous queue thread, so it fails from within the data callback
+ * of a queued device.
+ * @param handle    device handle.
+ * @param capacity  queue capacity in packets, 0 to call the data callback on the receive thread again (default).
+ * @param policy    what to do with a new packet when the queue is full, see \ref DataQueuePolicy.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status SetDataQueue( const uint8_t handle, const uint32_t capacity, const DataQueuePolicy policy );
+
+//=======================================================================================
+
+/**
+ * Get the counters of the data queue of a device, including the number of dropped packets and the high-water mark.
+ * @param handle  device handle.
+ * @param status  the counters of the data queue.
+ * @return kStatusSuccess on successful return, see \ref LivoxStatus for other error code.
+ */
+livox_status GetDataQueueStatus( const uint8_t handle, DataQueueStatus* status );
+
+//=======================================================================================
+
 /**
  * Function type of callback with 1 byte of response.
  * @param status      kStatusSuccess on successful return, kStatusTimeout on timeout, see \ref LivoxStatus for other
@@ -287,6 +891,22 @@ livox_status SetSphericalCoordinate( const uint8_t handle,
 
 //=======================================================================================
 
+/**
+ * Bandwidth-saving mode: the device sends spherical coordinate point cloud data, which is smaller on the wire, and
+ * the SDK converts every packet back to the matching cartesian data type before the data callbacks see it. The
+ * device is switched to spherical coordinate now if it is connected, otherwise as soon as it connects. Disabling it
+ * switches a connected device back to cartesian coordinate. Only LiDARs connected directly are supported: the hub
+ * command set cannot change the coordinate system of the LiDARs behind a hub. A refusal of the device is logged.
+ * @param  handle        device handle.
+ * @param  enable        true to enable host side conversion.
+ * @return kStatusSuccess on successful return, kStatusNotSupported in hub mode, or the error of sending the
+ * coordinate system command to a connected device, in which case the setting is unchanged; see \ref LivoxStatus for
+ * other error code.
+ */
+livox_status SetHostCartesianConversion( const uint8_t handle, const bool enable );
+
+//=======================================================================================
+
 /**
  * Callback of the error status message.
  * kStatusSuccess on successful return, see \ref LivoxStatus for other
@@ -0,0 +1,171 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "batch_receiver.h"
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include "apr_portable.h"
+
+namespace livox {
+
+BatchReceiver::~BatchReceiver() {
+  for (size_t i = 0; i < packets_.size(); i++) {
+    if (packets_[i]) {
+      packets_[i]->Release();
+    }
+  }
+}
+
+bool BatchReceiver::Init(uint32_t batch_size, PacketPool *pool) {
+  if (batch_size == 0 || pool == NULL) {
+    return false;
+  }
+  batch_size_ = batch_size;
+  pool_ = pool;
+  packets_.resize(batch_size_, NULL);
+  scratch_.resize(pool_->buffer_size());
+
+#ifdef __linux__
+  msgs_.resize(batch_size_);
+  iovecs_.resize(batch_size_);
+  for (uint32_t i = 0; i < batch_size_; i++) {
+    iovecs_[i].iov_base = NULL;
+    iovecs_[i].iov_len = pool_->buffer_size();
+    memset(&msgs_[i], 0, sizeof(msgs_[i]));
+    msgs_[i].msg_hdr.msg_iov = &iovecs_[i];
+    msgs_[i].msg_hdr.msg_iovlen = 1;
+  }
+#endif
+  return true;
+}
+
+uint32_t BatchReceiver::Refill() {
+  for (uint32_t i = 0; i < batch_size_; i++) {
+    PacketBuffer *&packet = packets_[i];
+    if (packet && packet->ref_count() > 1) {
+      // Still held downstream, leave it to the last owner.
+      packet->Release();
+      packet = NULL;
+    }
+    if (packet == NULL) {
+      packet = pool_->Acquire();
+      if (packet == NULL) {
+        return i;
+      }
+    }
+#ifdef __linux__
+    iovecs_[i].iov_base = packet->data();
+#endif
+  }
+  return batch_size_;
+}
+
+#ifdef __linux__
+uint32_t BatchReceiver::Receive(apr_socket_t *sock) {
+  drained_ = true;
+  apr_os_sock_t fd;
+  if (sock == NULL || batch_size_ == 0 || apr_os_sock_get(&fd, sock) != APR_SUCCESS) {
+    return 0;
+  }
+
+  uint32_t slots = Refill();
+  if (slots == 0) {
+    drained_ = Discard(sock) < batch_size_;
+    return 0;
+  }
+
+  int num = recvmmsg(fd, &msgs_[0], slots, MSG_DONTWAIT, NULL);
+  if (num <= 0) {
+    // A pending socket error is reported once, datagrams may still be queued behind it.
+    drained_ = !(num < 0 && (errno == EINTR || errno == ECONNREFUSED));
+    return 0;
+  }
+  drained_ = static_cast<uint32_t>(num) < slots;
+
+  uint32_t count = 0;
+  for (int i = 0; i < num; i++) {
+    // Truncated datagrams are dropped, swap the rest to the front.
+    if (msgs_[i].msg_hdr.msg_flags & MSG_TRUNC) {
+      continue;
+    }
+    if (count != static_cast<uint32_t>(i)) {
+      std::swap(packets_[count], packets_[i]);
+    }
+    packets_[count++]->set_size(msgs_[i].msg_len);
+  }
+  return count;
+}
+
+uint32_t BatchReceiver::Discard(apr_socket_t *sock) {
+  apr_os_sock_t fd;
+  if (apr_os_sock_get(&fd, sock) != APR_SUCCESS) {
+    return 0;
+  }
+  for (uint32_t i = 0; i < batch_size_; i++) {
+    iovecs_[i].iov_base = &scratch_[0];
+  }
+  int num = recvmmsg(fd, &msgs_[0], batch_size_, MSG_DONTWAIT, NULL);
+  return num > 0 ? static_cast<uint32_t>(num) : 0;
+}
+#else
+uint32_t BatchReceiver::Receive(apr_socket_t *sock) {
+  drained_ = true;
+  if (sock == NULL) {
+    return 0;
+  }
+
+  uint32_t slots = Refill();
+  if (slots == 0) {
+    drained_ = Discard(sock) < batch_size_;
+    return 0;
+  }
+
+  uint32_t count = 0;
+  while (count < slots) {
+    apr_sockaddr_t addr;
+    apr_size_t size = packets_[count]->capacity();
+    if (apr_socket_recvfrom(&addr, sock, 0, packets_[count]->data(), &size) != APR_SUCCESS || size == 0) {
+      break;
+    }
+    packets_[count++]->set_size(static_cast<uint32_t>(size));
+  }
+  drained_ = count < slots;
+  return count;
+}
+
+uint32_t BatchReceiver::Discard(apr_socket_t *sock) {
+  uint32_t count = 0;
+  for (; count < batch_size_; count++) {
+    apr_sockaddr_t addr;
+    apr_size_t size = scratch_.size();
+    if (apr_socket_recvfrom(&addr, sock, 0, &scratch_[0], &size) != APR_SUCCESS || size == 0) {
+      break;
+    }
+  }
+  return count;
+}
+#endif
+
+}  // namespace livox
@@ -0,0 +1,92 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_BATCH_RECEIVER_H_
+#define LIVOX_BATCH_RECEIVER_H_
+
+#include <vector>
+#include "apr_network_io.h"
+#include "noncopyable.h"
+#include "packet_pool.h"
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+namespace livox {
+
+/**
+ * BatchReceiver drains datagrams from a non-blocking UDP socket straight into
+ * buffers taken from a PacketPool. On Linux the buffers are filled by a single
+ * recvmmsg call, elsewhere it falls back to apr_socket_recvfrom. A buffer still
+ * referenced after the batch is handed off is replaced by a fresh one on the
+ * next receive, otherwise it is reused in place.
+ */
+class BatchReceiver : public noncopyable {
+ public:
+  BatchReceiver() : batch_size_(0), pool_(NULL), drained_(true) {}
+  ~BatchReceiver();
+
+  /**
+   * Prepare the packet slots.
+   * @param batch_size maximum number of datagrams received per call.
+   * @param pool pool providing the receive buffers, must outlive the receiver.
+   * @return true on successfully.
+   */
+  bool Init(uint32_t batch_size, PacketPool *pool);
+
+  /**
+   * Receive the pending datagrams without blocking. Datagrams are discarded
+   * while the pool is exhausted.
+   * @param sock the socket to read.
+   * @return number of datagrams received, 0 if nothing is pending.
+   */
+  uint32_t Receive(apr_socket_t *sock);
+
+  /** The buffer of a received datagram, the receiver keeps its own reference. */
+  PacketBuffer *packet(uint32_t index) { return packets_[index]; }
+  uint32_t batch_size() const { return batch_size_; }
+  /** Whether the last receive found the socket empty, an edge-triggered loop reads until it is. */
+  bool drained() const { return drained_; }
+
+ private:
+  /** Make sure the leading slots own an unshared buffer, returns the number of usable slots. */
+  uint32_t Refill();
+  /** Read and discard up to a batch of datagrams, returns the number discarded. */
+  uint32_t Discard(apr_socket_t *sock);
+
+  uint32_t batch_size_;
+  PacketPool *pool_;
+  bool drained_;
+  std::vector<PacketBuffer *> packets_;
+  std::vector<char> scratch_;
+#ifdef __linux__
+  std::vector<struct mmsghdr> msgs_;
+  std::vector<struct iovec> iovecs_;
+#endif
+};
+
+}  // namespace livox
+
+#endif  // LIVOX_BATCH_RECEIVER_H_
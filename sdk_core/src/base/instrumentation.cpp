@@ -0,0 +1,175 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "instrumentation.h"
+#include "logging.h"
+
+namespace livox {
+
+namespace {
+
+/** Upper bound of the bucket holding the given fraction of the durations, Unit:us */
+uint64_t Percentile(const LivoxLatencyHistogram &histogram, double fraction) {
+  uint64_t target = static_cast<uint64_t>(histogram.count * fraction);
+  uint64_t count = 0;
+  for (uint32_t i = 0; i < kLatencyBucketCount; i++) {
+    count += histogram.buckets[i];
+    if (count > target) {
+      return i + 1 < kLatencyBucketCount ? (1ULL << i) : histogram.max;
+    }
+  }
+  return histogram.max;
+}
+
+void LogHistogram(const char *name, const LivoxLatencyHistogram &histogram) {
+  if (histogram.count == 0) {
+    return;
+  }
+  LOG_INFO("{}: count {} avg {} us p50 < {} us p99 < {} us max {} us",
+           name,
+           histogram.count,
+           histogram.total / histogram.count,
+           Percentile(histogram, 0.5),
+           Percentile(histogram, 0.99),
+           histogram.max);
+}
+
+}  // namespace
+
+void LatencyHistogram::Record(apr_interval_time_t duration) {
+  uint64_t us = duration > 0 ? static_cast<uint64_t>(duration) : 0;
+  uint32_t bucket = 0;
+  while (bucket + 1 < kLatencyBucketCount && (us >> bucket) != 0) {
+    bucket++;
+  }
+  count_.fetch_add(1, boost::memory_order_relaxed);
+  total_.fetch_add(us, boost::memory_order_relaxed);
+  buckets_[bucket].fetch_add(1, boost::memory_order_relaxed);
+  uint64_t max = max_.load(boost::memory_order_relaxed);
+  while (us > max && !max_.compare_exchange_weak(max, us, boost::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::Reset() {
+  count_.store(0, boost::memory_order_relaxed);
+  total_.store(0, boost::memory_order_relaxed);
+  max_.store(0, boost::memory_order_relaxed);
+  for (uint32_t i = 0; i < kLatencyBucketCount; i++) {
+    buckets_[i].store(0, boost::memory_order_relaxed);
+  }
+}
+
+void LatencyHistogram::Snapshot(LivoxLatencyHistogram *histogram) const {
+  histogram->count = count_.load(boost::memory_order_relaxed);
+  histogram->total = total_.load(boost::memory_order_relaxed);
+  histogram->max = max_.load(boost::memory_order_relaxed);
+  for (uint32_t i = 0; i < kLatencyBucketCount; i++) {
+    histogram->buckets[i] = buckets_[i].load(boost::memory_order_relaxed);
+  }
+}
+
+boost::atomic<bool> Instrumentation::enabled_(false);
+
+Instrumentation::Instrumentation()
+    : dump_interval_(0), next_dump_(0), task_queue_depth_(0), task_queue_high_water_mark_(0) {}
+
+void Instrumentation::Enable(bool enable, uint32_t dump_interval) {
+  if (!enable) {
+    enabled_.store(false);
+    return;
+  }
+  loop_iteration_.Reset();
+  dispatch_delay_.Reset();
+  data_delegate_.Reset();
+  imu_delegate_.Reset();
+  command_delegate_.Reset();
+  tasks_.Reset();
+  data_dispatch_.Reset();
+  data_callback_.Reset();
+  imu_callback_.Reset();
+  command_callback_.Reset();
+  task_queue_depth_.store(0);
+  task_queue_high_water_mark_.store(0);
+  dump_interval_.store(apr_time_from_msec(dump_interval));
+  next_dump_.store(apr_time_now() + apr_time_from_msec(dump_interval));
+  enabled_.store(true);
+}
+
+void Instrumentation::Snapshot(LivoxInstrumentation *snapshot) const {
+  loop_iteration_.Snapshot(&snapshot->loop_iteration);
+  dispatch_delay_.Snapshot(&snapshot->dispatch_delay);
+  data_delegate_.Snapshot(&snapshot->data_delegate);
+  imu_delegate_.Snapshot(&snapshot->imu_delegate);
+  command_delegate_.Snapshot(&snapshot->command_delegate);
+  tasks_.Snapshot(&snapshot->tasks);
+  data_dispatch_.Snapshot(&snapshot->data_dispatch);
+  data_callback_.Snapshot(&snapshot->data_callback);
+  imu_callback_.Snapshot(&snapshot->imu_callback);
+  command_callback_.Snapshot(&snapshot->command_callback);
+  snapshot->task_queue_depth = task_queue_depth_.load(boost::memory_order_relaxed);
+  snapshot->task_queue_high_water_mark = task_queue_high_water_mark_.load(boost::memory_order_relaxed);
+}
+
+void Instrumentation::DumpIfDue(apr_time_t now) {
+  apr_time_t interval = dump_interval_.load(boost::memory_order_relaxed);
+  if (interval == 0) {
+    return;
+  }
+  apr_time_t next = next_dump_.load(boost::memory_order_relaxed);
+  // Only the loop winning the exchange logs, the others see the new deadline.
+  if (now < next || !next_dump_.compare_exchange_strong(next, now + interval)) {
+    return;
+  }
+  Dump();
+}
+
+void Instrumentation::RecordTaskQueueDepth(uint32_t depth) {
+  task_queue_depth_.store(depth, boost::memory_order_relaxed);
+  uint32_t high = task_queue_high_water_mark_.load(boost::memory_order_relaxed);
+  while (depth > high && !task_queue_high_water_mark_.compare_exchange_weak(high, depth)) {
+  }
+}
+
+void Instrumentation::Dump() const {
+  LivoxInstrumentation snapshot;
+  Snapshot(&snapshot);
+  LogHistogram("Loop iteration", snapshot.loop_iteration);
+  LogHistogram("Dispatch delay", snapshot.dispatch_delay);
+  LogHistogram("Data delegate", snapshot.data_delegate);
+  LogHistogram("IMU delegate", snapshot.imu_delegate);
+  LogHistogram("Command delegate", snapshot.command_delegate);
+  LogHistogram("Loop tasks", snapshot.tasks);
+  LogHistogram("Data dispatch", snapshot.data_dispatch);
+  LogHistogram("Data callback", snapshot.data_callback);
+  LogHistogram("IMU callback", snapshot.imu_callback);
+  LogHistogram("Command callback", snapshot.command_callback);
+  LOG_INFO("Task queue depth {} high-water mark {}", snapshot.task_queue_depth, snapshot.task_queue_high_water_mark);
+}
+
+Instrumentation &instrumentation() {
+  static Instrumentation instrumentation;
+  return instrumentation;
+}
+
+}  // namespace livox
@@ -0,0 +1,125 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_INSTRUMENTATION_H_
+#define LIVOX_INSTRUMENTATION_H_
+
+#include <stdint.h>
+#include <apr_time.h>
+#include <boost/atomic.hpp>
+#include "livox_def.h"
+#include "noncopyable.h"
+
+namespace livox {
+
+/** Lock-free histogram of durations, see LivoxLatencyHistogram for the buckets. */
+class LatencyHistogram : public noncopyable {
+ public:
+  LatencyHistogram() { Reset(); }
+
+  void Record(apr_interval_time_t duration);
+  void Reset();
+  void Snapshot(LivoxLatencyHistogram *histogram) const;
+
+ private:
+  boost::atomic<uint64_t> count_;
+  boost::atomic<uint64_t> total_;
+  boost::atomic<uint64_t> max_;
+  boost::atomic<uint64_t> buckets_[kLatencyBucketCount];
+};
+
+/**
+ * Latency counters of the event loops, the data path and the command
+ * channels. Recording is off by default; the probes only check one relaxed
+ * flag then, without reading the clock.
+ */
+class Instrumentation : public noncopyable {
+ public:
+  Instrumentation();
+
+  static bool enabled() { return enabled_.load(boost::memory_order_relaxed); }
+
+  /**
+   * Reset the counters and start recording, or stop recording.
+   * @param dump_interval log the counters every dump_interval ms, 0 to never log them.
+   */
+  void Enable(bool enable, uint32_t dump_interval);
+  void Snapshot(LivoxInstrumentation *snapshot) const;
+  /** Log the counters if the dump interval has passed, called by the event loops when they wake up. */
+  void DumpIfDue(apr_time_t now);
+
+  void RecordTaskQueueDepth(uint32_t depth);
+
+  LatencyHistogram &loop_iteration() { return loop_iteration_; }
+  LatencyHistogram &dispatch_delay() { return dispatch_delay_; }
+  LatencyHistogram &data_delegate() { return data_delegate_; }
+  LatencyHistogram &imu_delegate() { return imu_delegate_; }
+  LatencyHistogram &command_delegate() { return command_delegate_; }
+  LatencyHistogram &tasks() { return tasks_; }
+  LatencyHistogram &data_dispatch() { return data_dispatch_; }
+  LatencyHistogram &data_callback() { return data_callback_; }
+  LatencyHistogram &imu_callback() { return imu_callback_; }
+  LatencyHistogram &command_callback() { return command_callback_; }
+
+ private:
+  void Dump() const;
+
+  static boost::atomic<bool> enabled_;
+  boost::atomic<apr_time_t> dump_interval_;
+  boost::atomic<apr_time_t> next_dump_;
+  LatencyHistogram loop_iteration_;
+  LatencyHistogram dispatch_delay_;
+  LatencyHistogram data_delegate_;
+  LatencyHistogram imu_delegate_;
+  LatencyHistogram command_delegate_;
+  LatencyHistogram tasks_;
+  LatencyHistogram data_dispatch_;
+  LatencyHistogram data_callback_;
+  LatencyHistogram imu_callback_;
+  LatencyHistogram command_callback_;
+  boost::atomic<uint32_t> task_queue_depth_;
+  boost::atomic<uint32_t> task_queue_high_water_mark_;
+};
+
+Instrumentation &instrumentation();
+
+/** Record the lifetime of the scope into a histogram, while the instrumentation is enabled. */
+class ScopedLatency : public noncopyable {
+ public:
+  explicit ScopedLatency(LatencyHistogram &histogram)
+      : histogram_(Instrumentation::enabled() ? &histogram : NULL), start_(histogram_ ? apr_time_now() : 0) {}
+  ~ScopedLatency() {
+    if (histogram_) {
+      histogram_->Record(apr_time_now() - start_);
+    }
+  }
+
+ private:
+  LatencyHistogram *histogram_;
+  apr_time_t start_;
+};
+
+}  // namespace livox
+
+#endif  // LIVOX_INSTRUMENTATION_H_
@@ -24,22 +24,54 @@
 
 #include "io_loop.h"
 #include <boost/bind.hpp>
-#include <boost/thread/lock_guard.hpp>
-#include <boost/thread/locks.hpp>
+#include <algorithm>
 #include <iostream>
+#include "instrumentation.h"
 #include "logging.h"
+#ifdef __linux__
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
 
-using boost::lock_guard;
-using boost::mutex;
 using std::vector;
 
 namespace livox {
 
+#ifdef __linux__
+IoLoopBackend IOLoop::default_backend_ = kIoLoopBackendEpoll;
+#else
+IoLoopBackend IOLoop::default_backend_ = kIoLoopBackendApr;
+#endif
+
+bool IOLoop::SetDefaultBackend(IoLoopBackend backend) {
+#ifndef __linux__
+  if (backend == kIoLoopBackendEpoll) {
+    return false;
+  }
+#endif
+  if (backend != kIoLoopBackendApr && backend != kIoLoopBackendEpoll) {
+    return false;
+  }
+  default_backend_ = backend;
+  return true;
+}
+
 bool IOLoop::Init() {
   if (mem_pool_ == NULL) {
     return false;
   }
 
+  if (backend_ == kIoLoopBackendEpoll) {
+    if (InitEpoll()) {
+      return true;
+    }
+    LOG_WARN("Failed to set up epoll, falling back to the APR pollset");
+    UninitEpoll();
+    backend_ = kIoLoopBackendApr;
+  }
+
 #ifdef WIN32
   apr_status_t rv =
       apr_pollset_create(&pollset_, kMaxPollCount, mem_pool_, APR_POLLSET_WAKEABLE);
@@ -61,6 +93,7 @@ void IOLoop::Uninit() {
     apr_pollset_destroy(pollset_);
     pollset_ = NULL;
   }
+  UninitEpoll();
 
   for (DelegatesType::const_iterator ite = delegates_.begin(); ite != delegates_.end(); ++ite) {
     ClientData *data = ite->second;
@@ -68,8 +101,12 @@ void IOLoop::Uninit() {
       delete data;
     }
   }
-
   delegates_.clear();
+
+  for (vector<ClientData *>::iterator ite = retired_.begin(); ite != retired_.end(); ++ite) {
+    delete *ite;
+  }
+  retired_.clear();
   mem_pool_ = NULL;
 }
 
@@ -88,70 +125,147 @@ void IOLoop::RemoveDelegateSync(apr_socket_t *sock) {
 }
 
 void IOLoop::Loop() {
+  apr_interval_time_t timeout = -1;
+  apr_time_t deadline = wheel_.NextDeadline();
+  if (deadline != TimerWheel::kNever) {
+    // Both backends wait in whole ms, round up so the loop does not spin until the next timer is due.
+    timeout = std::max<apr_interval_time_t>(deadline - apr_time_now(), 0);
+    timeout = apr_time_from_msec(apr_time_msec(timeout + apr_time_from_msec(1) - 1));
+  }
+  apr_time_t ready = backend_ == kIoLoopBackendEpoll ? PollEpoll(timeout) : PollApr(timeout);
+
+  // Clear the flag before draining, a post racing with the drain then wakes the next poll.
+  wake_pending_.store(false);
+  if (ready != 0) {
+    Instrumentation &stats = instrumentation();
+    apr_time_t start = apr_time_now();
+    stats.RecordTaskQueueDepth(tasks_.RunAll());
+    stats.tasks().Record(apr_time_now() - start);
+  } else {
+    tasks_.RunAll();
+  }
+
+  wheel_.Advance(apr_time_now());
+
+  if (ready != 0) {
+    apr_time_t now = apr_time_now();
+    instrumentation().loop_iteration().Record(now - ready);
+    instrumentation().DumpIfDue(now);
+  }
+
+  for (vector<ClientData *>::iterator ite = retired_.begin(); ite != retired_.end(); ++ite) {
+    delete *ite;
+  }
+  retired_.clear();
+}
+
+apr_time_t IOLoop::PollApr(apr_interval_time_t timeout) {
   apr_int32_t num = 0;
   const apr_pollfd_t *ret_pfd = NULL;
-  apr_status_t rv = apr_pollset_poll(pollset_, apr_time_from_msec(50), &num, &ret_pfd);
+  apr_status_t rv = apr_pollset_poll(pollset_, timeout, &num, &ret_pfd);
+  apr_time_t ready = Instrumentation::enabled() ? apr_time_now() : 0;
 
   if (rv == APR_SUCCESS) {
     for (int i = 0; i < num; i++) {
       ClientData *data = static_cast<ClientData *>(ret_pfd[i].client_data);
-      if (data) {
-        IOLoopDelegate *delegate = data->first;
-        if (delegate) {
-          delegate->OnData(ret_pfd->desc.s, data->second);
-        }
+      if (data && data->delegate) {
+        Dispatch(data, ret_pfd[i].desc.s, ready);
       }
     }
   }
 
-  if (enable_wake_ && APR_STATUS_IS_EINTR(rv)) {
-    DelegatesType delegates = delegates_;
-    for (DelegatesType::const_iterator ite = delegates.begin(); ite != delegates.end(); ++ite) {
-      ClientData *data = ite->second;
-      if (data) {
-        IOLoopDelegate *delegate = data->first;
-        if (delegate) {
-          delegate->OnWake();
-        }
-      }
-    }
+  if (rv != APR_SUCCESS && !APR_STATUS_IS_TIMEUP(rv) && !APR_STATUS_IS_EINTR(rv)) {
+    LOG_ERROR(PrintAPRStatus(rv));
   }
+  return ready;
+}
 
-  if (enable_timer_) {
-    apr_time_t t = apr_time_now();
-    if (last_timeout_ == 0 || t - last_timeout_ > apr_time_from_msec(50)) {
-      last_timeout_ = t;
-      // copy delegates_ in case delegate is removed in callback.
-      DelegatesType delegates = delegates_;
-      for (DelegatesType::const_iterator ite = delegates.begin(); ite != delegates.end(); ++ite) {
-        ClientData *data = ite->second;
-        if (data) {
-          IOLoopDelegate *delegate = data->first;
-          if (delegate) {
-            delegate->OnTimer(t);
-          }
-        }
-      }
-    }
+void IOLoop::Dispatch(ClientData *data, apr_socket_t *sock, apr_time_t ready) {
+  if (ready != 0) {
+    // Sockets handled earlier in the same wakeup delay the later ones.
+    instrumentation().dispatch_delay().Record(apr_time_now() - ready);
   }
+  data->delegate->OnData(sock, data->data);
+}
 
-  vector<IOLoopTask> tasks;
-  {
-    lock_guard<mutex> lock(mutex_);
-    tasks.swap(pending_tasks_);
+#ifdef __linux__
+bool IOLoop::InitEpoll() {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    return false;
   }
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_fd_ < 0) {
+    return false;
+  }
+  // The wake event is level-triggered with no client data, it is cleared by reading it.
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = NULL;
+  return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) == 0;
+}
 
-  for (vector<IOLoopTask>::iterator ite = tasks.begin(); ite != tasks.end(); ++ite) {
-    IOLoopTask &task = *ite;
-    task();
+void IOLoop::UninitEpoll() {
+  if (wake_fd_ >= 0) {
+    close(wake_fd_);
+    wake_fd_ = -1;
   }
+  if (epoll_fd_ >= 0) {
+    close(epoll_fd_);
+    epoll_fd_ = -1;
+  }
+}
 
-  if (rv != APR_SUCCESS && !APR_STATUS_IS_TIMEUP(rv) && !APR_STATUS_IS_EINTR(rv)) {
-    LOG_ERROR(PrintAPRStatus(rv));
+apr_time_t IOLoop::PollEpoll(apr_interval_time_t timeout) {
+  struct epoll_event events[kMaxPollCount];
+  int timeout_ms = timeout < 0 ? -1 : static_cast<int>(apr_time_msec(timeout));
+  int num = epoll_wait(epoll_fd_, events, kMaxPollCount, timeout_ms);
+  apr_time_t ready = Instrumentation::enabled() ? apr_time_now() : 0;
+  if (num < 0) {
+    if (errno != EINTR) {
+      LOG_ERROR("epoll_wait failed: {}", errno);
+    }
+    return ready;
   }
+
+  for (int i = 0; i < num; i++) {
+    ClientData *data = static_cast<ClientData *>(events[i].data.ptr);
+    if (data == NULL) {
+      uint64_t value = 0;
+      if (read(wake_fd_, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        LOG_ERROR("Failed to read the wake event: {}", errno);
+      }
+    } else if (data->delegate) {
+      // Edge-triggered, the delegate reads until the socket would block.
+      Dispatch(data, data->sock, ready);
+    }
+  }
+  return ready;
 }
+#else
+bool IOLoop::InitEpoll() {
+  return false;
+}
+
+void IOLoop::UninitEpoll() {}
+
+apr_time_t IOLoop::PollEpoll(apr_interval_time_t) {
+  return 0;
+}
+#endif
 
 bool IOLoop::Wakeup() {
+#ifdef __linux__
+  if (backend_ == kIoLoopBackendEpoll) {
+    uint64_t value = 1;
+    // A full counter already wakes the loop up.
+    if (write(wake_fd_, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+      LOG_ERROR("Failed to wake up the loop: {}", errno);
+      return false;
+    }
+    return true;
+  }
+#endif
   apr_status_t rv = apr_pollset_wakeup(pollset_);
   if (rv != APR_SUCCESS) {
     LOG_ERROR(PrintAPRStatus(rv));
@@ -160,16 +274,47 @@ bool IOLoop::Wakeup() {
   return true;
 }
 
-void IOLoop::PostTask(const IOLoopTask &task) {
-  {
-    lock_guard<mutex> lock(mutex_);
-    pending_tasks_.push_back(task);
+IOLoop::TimerId IOLoop::AddTimer(apr_time_t deadline, const TimerTask &task) {
+  TimerId id = ++next_timer_id_;
+  if (IsLoopThread()) {
+    wheel_.Schedule(id, deadline, task);
+  } else {
+    PostTask(boost::bind(&TimerWheel::Schedule, &wheel_, id, deadline, task));
   }
-  Wakeup();
+  return id;
+}
+
+void IOLoop::CancelTimer(TimerId id) {
+  if (IsLoopThread()) {
+    wheel_.Cancel(id);
+  } else {
+    PostTask(boost::bind(&TimerWheel::Cancel, &wheel_, id));
+  }
+}
+
+bool IOLoop::IsLoopThread() const {
+  return has_thread_id_ && apr_os_thread_equal(thread_id_, apr_os_thread_current());
 }
 
 void IOLoop::AddDelegateAsync(apr_socket_t *sock, IOLoop::IOLoopDelegate *delegate, void *data) {
-  ClientData *p = new ClientData(delegate, data);
+  ClientData *p = new ClientData;
+  p->sock = sock;
+  p->fd = -1;
+  p->delegate = delegate;
+  p->data = data;
+  apr_os_sock_get(&p->fd, sock);
+#ifdef __linux__
+  if (backend_ == kIoLoopBackendEpoll) {
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = p;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, p->fd, &event) != 0) {
+      LOG_ERROR("Failed to add socket {} to epoll: {}", p->fd, errno);
+    }
+    delegates_[sock] = p;
+    return;
+  }
+#endif
   apr_pollfd_t pfd = {mem_pool_, APR_POLL_SOCKET, APR_POLLIN, 0, {NULL}, p};
   pfd.desc.s = sock;
   apr_pollset_add(pollset_, &pfd);
@@ -177,17 +322,27 @@ void IOLoop::AddDelegateAsync(apr_socket_t *sock, IOLoop::IOLoopDelegate *delega
 }
 
 void IOLoop::RemoveDelegateAsync(apr_socket_t *sock) {
-  apr_pollfd_t pfd = {mem_pool_, APR_POLL_SOCKET, 0, 0, {NULL}, NULL};
-  pfd.desc.s = sock;
-  apr_pollset_remove(pollset_, &pfd);
-
   DelegatesType::iterator ite = delegates_.find(sock);
-  if (ite != delegates_.end()) {
-    ClientData *p = ite->second;
-    if (p) {
-      delete p;
-    }
-    delegates_.erase(ite);
+  if (ite == delegates_.end()) {
+    return;
+  }
+  ClientData *p = ite->second;
+  delegates_.erase(ite);
+#ifdef __linux__
+  if (backend_ == kIoLoopBackendEpoll) {
+    // The socket may be closed already, which removed it from the set.
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, p->fd, NULL);
+  } else
+#endif
+  {
+    apr_pollfd_t pfd = {mem_pool_, APR_POLL_SOCKET, 0, 0, {NULL}, NULL};
+    pfd.desc.s = sock;
+    apr_pollset_remove(pollset_, &pfd);
+  }
+  if (p) {
+    // Events of the current poll may still point to it.
+    p->delegate = NULL;
+    retired_.push_back(p);
   }
 }
 
@@ -25,18 +25,21 @@
 #ifndef LIVOX_IO_LOOP_H_
 #define LIVOX_IO_LOOP_H_
 
+#include <boost/atomic.hpp>
 #include <boost/function.hpp>
-#include <boost/thread/mutex.hpp>
 #include <boost/unordered_map.hpp>
-#include <utility>
 #include <vector>
 #include "apr_general.h"
 #include "apr_network_io.h"
 #include "apr_poll.h"
+#include "apr_portable.h"
 #include "apr_thread_proc.h"
 #include "command_callback.h"
+#include "livox_def.h"
 #include "noncopyable.h"
+#include "task_queue.h"
 #include "thread_base.h"
+#include "timer_wheel.h"
 #include "util.h"
 
 namespace livox {
@@ -46,15 +49,33 @@ class IOLoop : public noncopyable {
   class IOLoopDelegate {
    public:
     virtual void OnData(apr_socket_t *, void *) {}
-    virtual void OnTimer(apr_time_t) {}
-    virtual void OnWake() {}
   };
 
   typedef boost::function<void(void)> IOLoopTask;
+  typedef TimerWheel::TimerId TimerId;
+  typedef TimerWheel::Task TimerTask;
 
  public:
-  explicit IOLoop(apr_pool_t *mem_pool, bool enable_timer = true, bool enable_wake = true)
-      : pollset_(NULL), mem_pool_(mem_pool), last_timeout_(0), enable_timer_(enable_timer), enable_wake_(enable_wake){};
+  explicit IOLoop(apr_pool_t *mem_pool)
+      : pollset_(NULL),
+        epoll_fd_(-1),
+        wake_fd_(-1),
+        backend_(default_backend_),
+        mem_pool_(mem_pool),
+        wake_pending_(false),
+        wheel_(apr_time_now()),
+        next_timer_id_(0),
+        has_thread_id_(false){};
+
+  /**
+   * Select the backend of the loops initialized afterwards. The epoll backend is edge-triggered, so the delegates
+   * must read their socket until it would block.
+   * @return false if the backend is not available on this platform.
+   */
+  static bool SetDefaultBackend(IoLoopBackend backend);
+  static IoLoopBackend default_backend() { return default_backend_; }
+  /** The backend in use, falls back to APR if epoll could not be set up. */
+  IoLoopBackend backend() const { return backend_; }
 
   bool Init();
   void Uninit();
@@ -63,27 +84,71 @@ class IOLoop : public noncopyable {
   void RemoveDelegateSync(apr_socket_t *sock);
   void Loop();
   bool Wakeup();
-  void PostTask(const IOLoopTask &task);
-  void SetThreadId (apr_os_thread_t thread_id) { thread_id_ = thread_id; }
+  /**
+   * Run task on the loop thread, task is anything callable as task(). May be called from any thread; the
+   * posts made before the loop gets to them share a single wakeup.
+   */
+  template <typename Task>
+  void PostTask(const Task &task) {
+    tasks_.Push(task);
+    if (!wake_pending_.exchange(true)) {
+      Wakeup();
+    }
+  }
+  /**
+   * Run task on the loop once the time reaches deadline, with a resolution of one millisecond. The loop sleeps until
+   * the next deadline when its sockets are quiet. May be called from any thread.
+   * @return id of the timer, never 0.
+   */
+  TimerId AddTimer(apr_time_t deadline, const TimerTask &task);
+  /** Cancel a timer, nothing happens if it has run already. May be called from any thread. */
+  void CancelTimer(TimerId id);
+  void SetThreadId (apr_os_thread_t thread_id) {
+    thread_id_ = thread_id;
+    has_thread_id_ = true;
+  }
   apr_os_thread_t GetThreadId () { return thread_id_; }
 
  private:
+  struct ClientData {
+    apr_socket_t *sock;
+    apr_os_sock_t fd;
+    IOLoopDelegate *delegate;
+    void *data;
+  };
+
   void AddDelegateAsync(apr_socket_t *sock, IOLoopDelegate *delegate, void *data);
   void RemoveDelegateAsync(apr_socket_t *sock);
+  /**
+   * Wait up to timeout for the sockets and dispatch them, a negative timeout waits until woken up.
+   * @return the time the wait ended while the instrumentation is enabled, 0 otherwise.
+   */
+  apr_time_t PollApr(apr_interval_time_t timeout);
+  bool InitEpoll();
+  void UninitEpoll();
+  apr_time_t PollEpoll(apr_interval_time_t timeout);
+  void Dispatch(ClientData *data, apr_socket_t *sock, apr_time_t ready);
+  bool IsLoopThread() const;
 
  private:
   static const apr_uint32_t kMaxPollCount = 48;
-  typedef std::pair<IOLoopDelegate *, void *> ClientData;
+  static IoLoopBackend default_backend_;
   typedef boost::unordered_map<apr_socket_t *, ClientData *> DelegatesType;
   DelegatesType delegates_;
+  /** Removed delegates, freed after the events of the current poll are dispatched. */
+  std::vector<ClientData *> retired_;
   apr_pollset_t *pollset_;
+  int epoll_fd_;
+  int wake_fd_;
+  IoLoopBackend backend_;
   apr_pool_t *mem_pool_;
-  apr_time_t last_timeout_;
-  boost::mutex mutex_;
-  bool enable_timer_;
-  bool enable_wake_;
-  std::vector<IOLoopTask> pending_tasks_;
+  TaskQueue tasks_;
+  /** Set by the first post after the loop last drained tasks_, which does the wakeup. */
+  boost::atomic<bool> wake_pending_;
+  TimerWheel wheel_;
+  boost::atomic<TimerId> next_timer_id_;
   apr_os_thread_t thread_id_;
+  boost::atomic<bool> has_thread_id_;
 };
 
 }  // namespace livox
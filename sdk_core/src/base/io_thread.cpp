@@ -43,12 +43,19 @@ void IOThread::ThreadFunc() {
   }
 }
 
-bool IOThread::Init(bool enable_timer, bool enable_wake) {
+void IOThread::Quit() {
+  ThreadBase::Quit();
+  if (loop_) {
+    loop_->Wakeup();
+  }
+}
+
+bool IOThread::Init() {
   if (!ThreadBase::Init()) {
     return false;
   }
 
-  loop_.reset(new IOLoop(pool_, enable_timer, enable_wake));
+  loop_.reset(new IOLoop(pool_));
   return loop_->Init();
 }
 
@@ -33,8 +33,10 @@ namespace livox {
 class IOThread : public ThreadBase {
  public:
   IOThread() : loop_(NULL) {}
-  bool Init(bool enable_timer = true, bool enable_wake = true);
+  bool Init();
   void Join();
+  /** The loop sleeps until its next timer without traffic, wake it up to see the quit flag. */
+  virtual void Quit();
   void Uninit();
 
   IOLoop *loop() { return loop_.get(); }
@@ -0,0 +1,94 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "packet_pool.h"
+#include <algorithm>
+#include <new>
+#include <boost/thread/lock_guard.hpp>
+
+namespace livox {
+
+PacketPool::PacketPool(uint32_t buffer_size, uint32_t slab_count, uint32_t max_count)
+    : buffer_size_(buffer_size),
+      slab_count_(slab_count),
+      max_count_(max_count),
+      count_(0),
+      free_list_(slab_count) {}
+
+PacketPool::~PacketPool() {
+  for (size_t i = 0; i < headers_.size(); i++) {
+    delete[] headers_[i];
+  }
+  for (size_t i = 0; i < slabs_.size(); i++) {
+    delete[] slabs_[i];
+  }
+}
+
+PacketBuffer *PacketPool::Acquire() {
+  PacketBuffer *buffer = NULL;
+  while (!free_list_.pop(buffer)) {
+    if (!Grow()) {
+      return NULL;
+    }
+  }
+  buffer->ref_count_.store(1, boost::memory_order_relaxed);
+  buffer->size_ = 0;
+  return buffer;
+}
+
+bool PacketPool::Grow() {
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  if (!free_list_.empty()) {
+    // Another thread grew the pool meanwhile.
+    return true;
+  }
+  uint32_t count = count_;
+  if (count >= max_count_) {
+    return false;
+  }
+  uint32_t grow_count = std::min(slab_count_, max_count_ - count);
+
+  PacketBuffer *headers = new (std::nothrow) PacketBuffer[grow_count];
+  char *slab = new (std::nothrow) char[static_cast<size_t>(grow_count) * buffer_size_];
+  if (headers == NULL || slab == NULL) {
+    delete[] headers;
+    delete[] slab;
+    return false;
+  }
+  headers_.push_back(headers);
+  slabs_.push_back(slab);
+
+  // Reserve the free list nodes up front so recycling a buffer never allocates.
+  free_list_.reserve(grow_count);
+  for (uint32_t i = 0; i < grow_count; i++) {
+    headers[i].pool_ = this;
+    headers[i].data_ = slab + static_cast<size_t>(i) * buffer_size_;
+    headers[i].capacity_ = buffer_size_;
+    free_list_.push(&headers[i]);
+  }
+  count_ = count + grow_count;
+  return true;
+}
+
+}  // namespace livox
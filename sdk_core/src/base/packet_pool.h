@@ -0,0 +1,119 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_PACKET_POOL_H_
+#define LIVOX_PACKET_POOL_H_
+
+#include <stdint.h>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/intrusive_ptr.hpp>
+#include <boost/lockfree/stack.hpp>
+#include <boost/thread/mutex.hpp>
+#include "noncopyable.h"
+
+namespace livox {
+
+class PacketPool;
+
+/**
+ * Reference counted receive buffer. A buffer goes back to its pool when the
+ * last reference is released, so it can be held past the data callback.
+ */
+class PacketBuffer : public noncopyable {
+ public:
+  char *data() { return data_; }
+  uint32_t size() const { return size_; }
+  void set_size(uint32_t size) { size_ = size; }
+  uint32_t capacity() const { return capacity_; }
+  uint32_t ref_count() const { return ref_count_.load(boost::memory_order_acquire); }
+
+  void Retain() { ref_count_.fetch_add(1, boost::memory_order_relaxed); }
+  void Release();
+
+ private:
+  friend class PacketPool;
+  PacketBuffer() : ref_count_(0), pool_(NULL), data_(NULL), size_(0), capacity_(0) {}
+
+  boost::atomic<uint32_t> ref_count_;
+  PacketPool *pool_;
+  char *data_;
+  uint32_t size_;
+  uint32_t capacity_;
+};
+
+/**
+ * Fixed size receive buffers carved out of slabs. Buffers are recycled
+ * through a lock-free free list, a new slab is only allocated when the free
+ * list runs dry and the pool is below its limit.
+ */
+class PacketPool : public noncopyable {
+ public:
+  PacketPool(uint32_t buffer_size, uint32_t slab_count, uint32_t max_count);
+  ~PacketPool();
+
+  /** Take a buffer holding one reference, NULL if max_count buffers are in use. */
+  PacketBuffer *Acquire();
+
+  /** Limit the number of buffers, buffers already allocated are kept. */
+  void set_max_count(uint32_t max_count) { max_count_ = max_count; }
+  uint32_t max_count() const { return max_count_; }
+  uint32_t count() const { return count_; }
+  uint32_t buffer_size() const { return buffer_size_; }
+
+ private:
+  friend class PacketBuffer;
+  void Recycle(PacketBuffer *buffer) { free_list_.push(buffer); }
+  bool Grow();
+
+  uint32_t buffer_size_;
+  uint32_t slab_count_;
+  boost::atomic<uint32_t> max_count_;
+  boost::atomic<uint32_t> count_;
+  boost::lockfree::stack<PacketBuffer *> free_list_;
+  boost::mutex mutex_;
+  std::vector<PacketBuffer *> headers_;
+  std::vector<char *> slabs_;
+};
+
+inline void PacketBuffer::Release() {
+  if (ref_count_.fetch_sub(1, boost::memory_order_acq_rel) == 1) {
+    pool_->Recycle(this);
+  }
+}
+
+inline void intrusive_ptr_add_ref(PacketBuffer *buffer) {
+  buffer->Retain();
+}
+
+inline void intrusive_ptr_release(PacketBuffer *buffer) {
+  buffer->Release();
+}
+
+/** Reference to a buffer held by an object, such as a posted task that may be destroyed without running. */
+typedef boost::intrusive_ptr<PacketBuffer> PacketRef;
+
+}  // namespace livox
+
+#endif  // LIVOX_PACKET_POOL_H_
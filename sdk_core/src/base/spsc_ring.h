@@ -0,0 +1,126 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_SPSC_RING_H_
+#define LIVOX_SPSC_RING_H_
+
+#include <stdint.h>
+#include <boost/atomic.hpp>
+#include <boost/smart_ptr/scoped_array.hpp>
+#include "noncopyable.h"
+
+namespace livox {
+
+/**
+ * Bounded lock-free ring with one producer and one consumer. Every cell
+ * carries a sequence number, so a cell being read is never handed to the
+ * producer. Reads claim their cell with a CAS, which also lets the producer
+ * claim and discard the oldest entry to make room.
+ */
+template <typename T>
+class SpscRing : public noncopyable {
+ public:
+  /** @param capacity number of cells, rounded up to a power of two. */
+  explicit SpscRing(uint32_t capacity) : mask_(0), write_pos_(0), read_pos_(0) {
+    uint32_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    cells_.reset(new Cell[size]);
+    for (uint32_t i = 0; i < size; i++) {
+      cells_[i].sequence.store(i, boost::memory_order_relaxed);
+    }
+  }
+
+  /** Cell to fill with the next entry, NULL if the ring is full. Producer only. */
+  T *AcquireWrite() {
+    uint32_t pos = write_pos_.load(boost::memory_order_relaxed);
+    Cell &cell = cells_[pos & mask_];
+    if (cell.sequence.load(boost::memory_order_acquire) != pos) {
+      return NULL;
+    }
+    return &cell.value;
+  }
+
+  /** Publish the cell returned by AcquireWrite(). Producer only. */
+  void CommitWrite() {
+    uint32_t pos = write_pos_.load(boost::memory_order_relaxed);
+    cells_[pos & mask_].sequence.store(pos + 1, boost::memory_order_release);
+    write_pos_.store(pos + 1, boost::memory_order_release);
+  }
+
+  /**
+   * Claim the oldest entry.
+   * @param ticket receives the value to pass to ReleaseRead().
+   * @return the claimed entry, NULL if the ring is empty.
+   */
+  T *AcquireRead(uint32_t *ticket) {
+    uint32_t pos = read_pos_.load(boost::memory_order_relaxed);
+    for (;;) {
+      Cell &cell = cells_[pos & mask_];
+      int32_t diff = static_cast<int32_t>(cell.sequence.load(boost::memory_order_acquire) - (pos + 1));
+      if (diff == 0) {
+        if (read_pos_.compare_exchange_weak(pos, pos + 1, boost::memory_order_relaxed)) {
+          *ticket = pos;
+          return &cell.value;
+        }
+      } else if (diff < 0) {
+        return NULL;
+      } else {
+        pos = read_pos_.load(boost::memory_order_relaxed);
+      }
+    }
+  }
+
+  /** Hand the cell claimed by AcquireRead() back to the producer. */
+  void ReleaseRead(uint32_t ticket) {
+    cells_[ticket & mask_].sequence.store(ticket + mask_ + 1, boost::memory_order_release);
+  }
+
+  uint32_t size() const {
+    return write_pos_.load(boost::memory_order_acquire) - read_pos_.load(boost::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  uint32_t capacity() const { return mask_ + 1; }
+
+ private:
+  static const uint32_t kCacheLineSize = 64;
+  typedef struct {
+    boost::atomic<uint32_t> sequence;
+    T value;
+  } Cell;
+
+  boost::scoped_array<Cell> cells_;
+  uint32_t mask_;
+  char pad0_[kCacheLineSize];
+  boost::atomic<uint32_t> write_pos_;
+  char pad1_[kCacheLineSize];
+  boost::atomic<uint32_t> read_pos_;
+  char pad2_[kCacheLineSize];
+};
+
+}  // namespace livox
+
+#endif  // LIVOX_SPSC_RING_H_
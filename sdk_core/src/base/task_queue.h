@@ -0,0 +1,176 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_TASK_QUEUE_H_
+#define LIVOX_TASK_QUEUE_H_
+
+#include <stdint.h>
+#include <new>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/type_traits/aligned_storage.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+#include "noncopyable.h"
+
+namespace livox {
+
+/**
+ * Unbounded lock-free queue of tasks with many producers and one consumer.
+ * Every task lives in an intrusive node; a task of up to kInlineSize bytes
+ * is constructed in the node itself, a larger one is boxed in a
+ * boost::function first.
+ */
+class TaskQueue : public noncopyable {
+ public:
+  TaskQueue() : head_(&stub_), tail_(&stub_) { stub_.next.store(NULL, boost::memory_order_relaxed); }
+
+  /** Destroys the pending tasks without running them. */
+  ~TaskQueue() {
+    Node *node = NULL;
+    while ((node = Pop()) != NULL) {
+      node->destroy(&node->storage);
+      delete node;
+    }
+  }
+
+  /** Append a task callable as task(). Any thread. */
+  template <typename Task>
+  void Push(const Task &task) {
+    Store(task, boost::integral_constant<bool, (sizeof(Task) <= kInlineSize &&
+                                                boost::alignment_of<Task>::value <= kInlineAlign)>());
+  }
+
+  /**
+   * Run the tasks queued so far, tasks they post run on the next call. Consumer only.
+   * @return number of tasks run.
+   */
+  uint32_t RunAll() {
+    // Detach first, so a task posting itself again cannot keep the consumer here.
+    Node *first = NULL;
+    Node *last = NULL;
+    Node *node = NULL;
+    while ((node = Pop()) != NULL) {
+      node->next.store(NULL, boost::memory_order_relaxed);
+      if (last) {
+        last->next.store(node, boost::memory_order_relaxed);
+      } else {
+        first = node;
+      }
+      last = node;
+    }
+
+    uint32_t count = 0;
+    while (first) {
+      node = first;
+      first = node->next.load(boost::memory_order_relaxed);
+      node->invoke(&node->storage);
+      node->destroy(&node->storage);
+      delete node;
+      count++;
+    }
+    return count;
+  }
+
+ private:
+  static const uint32_t kInlineSize = 64;
+  static const uint32_t kInlineAlign = 16;
+  static const uint32_t kCacheLineSize = 64;
+
+  struct Node {
+    boost::atomic<Node *> next;
+    void (*invoke)(void *storage);
+    void (*destroy)(void *storage);
+    boost::aligned_storage<kInlineSize, kInlineAlign>::type storage;
+  };
+
+  template <typename Task>
+  static void Invoke(void *storage) {
+    (*static_cast<Task *>(storage))();
+  }
+
+  template <typename Task>
+  static void Destroy(void *storage) {
+    static_cast<Task *>(storage)->~Task();
+  }
+
+  template <typename Task>
+  void Store(const Task &task, boost::true_type) {
+    Node *node = new Node;
+    new (&node->storage) Task(task);
+    node->invoke = &Invoke<Task>;
+    node->destroy = &Destroy<Task>;
+    Enqueue(node);
+  }
+
+  template <typename Task>
+  void Store(const Task &task, boost::false_type) {
+    Store(boost::function<void(void)>(task), boost::true_type());
+  }
+
+  void Enqueue(Node *node) {
+    node->next.store(NULL, boost::memory_order_relaxed);
+    Node *prev = head_.exchange(node, boost::memory_order_acq_rel);
+    prev->next.store(node, boost::memory_order_release);
+  }
+
+  /** Oldest node, NULL if the queue is empty or its oldest push is not linked yet. */
+  Node *Pop() {
+    Node *tail = tail_;
+    Node *next = tail->next.load(boost::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == NULL) {
+        return NULL;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next.load(boost::memory_order_acquire);
+    }
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(boost::memory_order_acquire)) {
+      // A producer swapped the head but has not linked its node yet, a later call finds it.
+      return NULL;
+    }
+    // The last node can only leave once a successor exists, the stub stands in for it.
+    Enqueue(&stub_);
+    next = tail->next.load(boost::memory_order_acquire);
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    return NULL;
+  }
+
+  boost::atomic<Node *> head_;
+  char pad_[kCacheLineSize];
+  Node *tail_;
+  Node stub_;
+};
+
+}  // namespace livox
+
+#endif  // LIVOX_TASK_QUEUE_H_
@@ -23,6 +23,10 @@
 //
 
 #include "thread_base.h"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace livox {
 static void *APR_THREAD_FUNC ClassThreadHelperFunc(apr_thread_t *thd, void *data) {
@@ -30,12 +34,26 @@ static void *APR_THREAD_FUNC ClassThreadHelperFunc(apr_thread_t *thd, void *data
   if (caller == NULL) {
     return NULL;
   }
+#ifdef __linux__
+  if (caller->cpu_affinity() >= 0) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(caller->cpu_affinity(), &cpu_set);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  }
+  if (caller->priority() > 0) {
+    // Needs CAP_SYS_NICE, the thread keeps the normal scheduling otherwise.
+    struct sched_param param;
+    param.sched_priority = caller->priority();
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  }
+#endif
   caller->ThreadFunc();
   apr_thread_exit(thd, APR_SUCCESS);
   return NULL;
 }
 
-ThreadBase::ThreadBase() : thread_(NULL), quit_(false), pool_(NULL) {}
+ThreadBase::ThreadBase() : thread_(NULL), quit_(false), pool_(NULL), cpu_(-1), priority_(0) {}
 
 bool ThreadBase::Start() {
   quit_ = false;
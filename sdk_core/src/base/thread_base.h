@@ -41,13 +41,22 @@ class ThreadBase : public noncopyable {
   virtual void Uninit();
   virtual bool Start();
   virtual void Join();
-  void Quit() { quit_ = true; }
+  virtual void Quit() { quit_ = true; }
   bool IsQuit() { return quit_; }
 
+  /** Bind the thread to a cpu core when it starts, -1 to leave it unbound. */
+  void SetCpuAffinity(int32_t cpu) { cpu_ = cpu; }
+  int32_t cpu_affinity() const { return cpu_; }
+  /** Run the thread with a real-time FIFO priority when it starts, 0 for the normal scheduling. */
+  void SetPriority(int32_t priority) { priority_ = priority; }
+  int32_t priority() const { return priority_; }
+
  protected:
   apr_thread_t *thread_;
   boost::atomic_bool quit_;
   apr_pool_t *pool_;
+  int32_t cpu_;
+  int32_t priority_;
 };
 
 }  // namespace livox
@@ -0,0 +1,201 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "timer_wheel.h"
+#include <algorithm>
+
+namespace livox {
+
+static uint64_t RotateRight(uint64_t value, uint32_t shift) {
+  return shift == 0 ? value : (value >> shift) | (value << (64 - shift));
+}
+
+static uint32_t LowestBit(uint64_t value) {
+#if defined(__GNUC__)
+  return static_cast<uint32_t>(__builtin_ctzll(value));
+#else
+  uint32_t bit = 0;
+  while ((value & 1) == 0) {
+    value >>= 1;
+    bit++;
+  }
+  return bit;
+#endif
+}
+
+TimerWheel::TimerWheel(apr_time_t now) : current_(static_cast<uint64_t>(now) / kTick) {
+  for (uint32_t level = 0; level < kLevels; level++) {
+    occupied_[level] = 0;
+    for (uint32_t slot = 0; slot < kSlots; slot++) {
+      slots_[level][slot].prev = &slots_[level][slot];
+      slots_[level][slot].next = &slots_[level][slot];
+    }
+  }
+}
+
+TimerWheel::~TimerWheel() {
+  for (boost::unordered_map<TimerId, Timer *>::iterator ite = timers_.begin(); ite != timers_.end(); ++ite) {
+    delete ite->second;
+  }
+}
+
+void TimerWheel::Schedule(TimerId id, apr_time_t deadline, const Task &task) {
+  Timer *timer = new Timer;
+  timer->id = id;
+  // Round up, a timer never runs early.
+  timer->expiry = deadline > 0 ? (static_cast<uint64_t>(deadline) + kTick - 1) / kTick : 0;
+  timer->task = task;
+  Insert(timer);
+  timers_[id] = timer;
+}
+
+bool TimerWheel::Cancel(TimerId id) {
+  boost::unordered_map<TimerId, Timer *>::iterator ite = timers_.find(id);
+  if (ite == timers_.end()) {
+    return false;
+  }
+  Unlink(ite->second);
+  delete ite->second;
+  timers_.erase(ite);
+  return true;
+}
+
+void TimerWheel::Insert(Timer *timer) {
+  static const uint64_t kSpan = 1ULL << (kLevels * kSlotBits);
+  uint64_t expiry = std::max(timer->expiry, current_);
+  uint64_t delta = expiry - current_;
+  if (delta >= kSpan) {
+    // Parked in the last slot of the top level, placed again when it moves down.
+    expiry = current_ + kSpan - 1;
+    delta = kSpan - 1;
+  }
+  uint32_t level = 0;
+  while (level + 1 < kLevels && delta >= (1ULL << ((level + 1) * kSlotBits))) {
+    level++;
+  }
+  timer->level = level;
+  timer->slot = static_cast<uint32_t>(expiry >> (level * kSlotBits)) & kSlotMask;
+
+  Timer &head = slots_[level][timer->slot];
+  timer->next = &head;
+  timer->prev = head.prev;
+  head.prev->next = timer;
+  head.prev = timer;
+  occupied_[level] |= 1ULL << timer->slot;
+}
+
+void TimerWheel::Unlink(Timer *timer) {
+  timer->prev->next = timer->next;
+  timer->next->prev = timer->prev;
+  timer->prev = timer->next = timer;
+  Timer &head = slots_[timer->level][timer->slot];
+  if (head.next == &head) {
+    occupied_[timer->level] &= ~(1ULL << timer->slot);
+  }
+}
+
+uint32_t TimerWheel::Cascade(uint32_t level) {
+  uint32_t index = SlotIndex(level);
+  Timer &head = slots_[level][index];
+  Timer *timer = head.next;
+  head.prev = head.next = &head;
+  occupied_[level] &= ~(1ULL << index);
+  while (timer != &head) {
+    Timer *next = timer->next;
+    Insert(timer);
+    timer = next;
+  }
+  return index;
+}
+
+void TimerWheel::Advance(apr_time_t now) {
+  uint64_t target = static_cast<uint64_t>(now) / kTick;
+  while (current_ <= target) {
+    if (timers_.empty()) {
+      current_ = target + 1;
+      return;
+    }
+    uint32_t index = SlotIndex(0);
+    if (index == 0) {
+      for (uint32_t level = 1; level < kLevels && Cascade(level) == 0; level++) {
+      }
+    }
+
+    // Take the due timers out first, a task may cancel the ones after it.
+    Timer due;
+    Timer &head = slots_[0][index];
+    if (head.next != &head) {
+      due.next = head.next;
+      due.prev = head.prev;
+      due.next->prev = &due;
+      due.prev->next = &due;
+      head.prev = head.next = &head;
+      occupied_[0] &= ~(1ULL << index);
+    } else {
+      due.prev = due.next = &due;
+    }
+    current_++;
+
+    while (due.next != &due) {
+      Timer *timer = due.next;
+      timer->prev->next = timer->next;
+      timer->next->prev = timer->prev;
+      timers_.erase(timer->id);
+      Task task;
+      task.swap(timer->task);
+      delete timer;
+      task(now);
+    }
+
+    // Nothing in the lowest level, skip to where the next level moves down.
+    if (occupied_[0] == 0 && (current_ & kSlotMask) != 0) {
+      current_ = std::min((current_ | kSlotMask) + 1, target + 1);
+    }
+  }
+}
+
+apr_time_t TimerWheel::NextDeadline() const {
+  if (timers_.empty()) {
+    return kNever;
+  }
+  uint64_t next = UINT64_MAX;
+  if (occupied_[0]) {
+    // Every timer of the lowest level is due within its 64 ticks.
+    uint32_t index = SlotIndex(0);
+    next = current_ + LowestBit(RotateRight(occupied_[0], index));
+  }
+  for (uint32_t level = 1; level < kLevels; level++) {
+    if (occupied_[level] == 0) {
+      continue;
+    }
+    // A slot moves down when the lower levels wrap around to it.
+    uint64_t unit = 1ULL << (level * kSlotBits);
+    uint64_t start = (current_ + unit - 1) & ~(unit - 1);
+    uint32_t index = static_cast<uint32_t>(start >> (level * kSlotBits)) & kSlotMask;
+    next = std::min(next, start + LowestBit(RotateRight(occupied_[level], index)) * unit);
+  }
+  return static_cast<apr_time_t>(next * kTick);
+}
+
+}  // namespace livox
@@ -0,0 +1,102 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_TIMER_WHEEL_H_
+#define LIVOX_TIMER_WHEEL_H_
+
+#include <stdint.h>
+#include <boost/function.hpp>
+#include <boost/unordered_map.hpp>
+#include "apr_time.h"
+#include "noncopyable.h"
+
+namespace livox {
+
+/**
+ * Hierarchical timer wheel with a resolution of one millisecond. Timers are
+ * kept in four levels of 64 slots, each level covering 64 times the span of
+ * the level below, and move down a level as their time comes closer. Adding
+ * and cancelling a timer is O(1), a timer never runs before its deadline.
+ * Not thread safe, it belongs to the thread of its IOLoop.
+ */
+class TimerWheel : public noncopyable {
+ public:
+  typedef uint64_t TimerId;
+  typedef boost::function<void(apr_time_t now)> Task;
+
+  explicit TimerWheel(apr_time_t now);
+  ~TimerWheel();
+
+  /** Run task once the time reaches deadline, the id must be unique and not 0. */
+  void Schedule(TimerId id, apr_time_t deadline, const Task &task);
+  /** @return false if the timer has already run or was cancelled. */
+  bool Cancel(TimerId id);
+  /** Run the timers due at now, they may schedule and cancel timers. */
+  void Advance(apr_time_t now);
+  /**
+   * The time until which no timer is due, kNever when there is no timer. It may be earlier than the first
+   * deadline, when timers have to move down a level.
+   */
+  apr_time_t NextDeadline() const;
+  size_t size() const { return timers_.size(); }
+
+  static const apr_time_t kNever = INT64_MAX;
+
+ private:
+  static const uint32_t kLevels = 4;
+  static const uint32_t kSlotBits = 6;
+  static const uint32_t kSlots = 1 << kSlotBits;
+  static const uint32_t kSlotMask = kSlots - 1;
+  static const apr_time_t kTick = 1000;
+
+  struct Timer {
+    Timer *prev;
+    Timer *next;
+    TimerId id;
+    uint64_t expiry;
+    uint32_t level;
+    uint32_t slot;
+    Task task;
+  };
+
+  /** Put a timer in the slot of its expiry tick, relative to the current tick. */
+  void Insert(Timer *timer);
+  void Unlink(Timer *timer);
+  /** Move the timers of a slot of a level down, returns the slot index. */
+  uint32_t Cascade(uint32_t level);
+  uint32_t SlotIndex(uint32_t level) const {
+    return static_cast<uint32_t>(current_ >> (level * kSlotBits)) & kSlotMask;
+  }
+
+  /** Circular lists with a sentinel node per slot. */
+  Timer slots_[kLevels][kSlots];
+  uint64_t occupied_[kLevels];
+  /** The next tick to process. */
+  uint64_t current_;
+  boost::unordered_map<TimerId, Timer *> timers_;
+};
+
+}  // namespace livox
+
+#endif  // LIVOX_TIMER_WHEEL_H_
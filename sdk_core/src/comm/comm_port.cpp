@@ -32,12 +32,12 @@
 namespace livox {
 const uint32_t kSearchPacketPreamble = 0;
 const uint32_t kGetPacketData = 1;
+const uint32_t kCacheMask = kCacheSize - 1;
 
 CommPort::CommPort() {
   protocol_ = new SdkProtocol(0x4c49, 0x564f580a);
   cache_.wr_idx = 0;
   cache_.rd_idx = 0;
-  cache_.size = kCacheSize;
   parse_step_ = kSearchPacketPreamble;
   seq_num_ = 0;
 }
@@ -49,55 +49,52 @@ CommPort::~CommPort() {
 }
 
 uint8_t *CommPort::FetchCacheFreeSpace(uint32_t *o_len) {
-  UpdateCache();
-
-  if (cache_.wr_idx < cache_.size) {
-    *o_len = cache_.size - cache_.wr_idx;
-    return &cache_.buf[cache_.wr_idx];
-  } else {
-    *o_len = 0;
-    return NULL;
-  }
+  uint32_t free_size = kCacheSize - GetValidDataSize();
+  uint32_t wr = cache_.wr_idx & kCacheMask;
+  // Writing past the end of the ring into the mirror keeps a datagram in one piece, UpdateCacheWrIdx wraps it.
+  uint32_t contiguous = kCacheSize + kCacheMirrorSize - wr;
+  *o_len = free_size < contiguous ? free_size : contiguous;
+  return *o_len ? &cache_.buf[wr] : NULL;
 }
 
 int32_t CommPort::UpdateCacheWrIdx(uint32_t used_size) {
-  if ((cache_.wr_idx + used_size) < cache_.size) {
-    cache_.wr_idx += used_size;
-    return 0;
-  } else {
+  if (used_size > kCacheSize - GetValidDataSize()) {
     return -1;
   }
-}
-
-uint32_t CommPort::GetCacheTailSize() {
-  if (cache_.wr_idx < cache_.size) {
-    return cache_.size - cache_.wr_idx;
-  } else {
-    return 0;
+  uint32_t end = (cache_.wr_idx & kCacheMask) + used_size;
+  if (end > kCacheSize) {
+    memcpy(cache_.buf, &cache_.buf[kCacheSize], end - kCacheSize);
   }
+  cache_.wr_idx += used_size;
+  return 0;
 }
 
 uint32_t CommPort::GetValidDataSize() {
-  if (cache_.wr_idx > cache_.rd_idx) {
-    return cache_.wr_idx - cache_.rd_idx;
-  } else {
-    return 0;
-  }
+  return cache_.wr_idx - cache_.rd_idx;
 }
 
-void CommPort::UpdateCache(void) {
-  if (GetCacheTailSize() < kMoveCacheLimit) {  // move unused data to cache head
-    uint32_t valid_data_size = GetValidDataSize();
-
-    if (valid_data_size) {
-      memmove(cache_.buf, &cache_.buf[cache_.rd_idx], valid_data_size);
-      cache_.rd_idx = 0;
-      cache_.wr_idx = valid_data_size;
-    } else if (cache_.rd_idx) {
-      cache_.rd_idx = 0;
-      cache_.wr_idx = 0;
+bool CommPort::FindSof() {
+  uint32_t size = GetValidDataSize();
+  while (size > 0) {
+    uint32_t rd = cache_.rd_idx & kCacheMask;
+    uint32_t span = kCacheSize - rd < size ? kCacheSize - rd : size;
+    const uint8_t *sof = static_cast<const uint8_t *>(memchr(&cache_.buf[rd], kSdkProtocolSof, span));
+    if (sof) {
+      cache_.rd_idx += static_cast<uint32_t>(sof - &cache_.buf[rd]);
+      return true;
     }
+    cache_.rd_idx += span;
+    size -= span;
   }
+  return false;
+}
+
+uint8_t *CommPort::Contiguous(uint32_t len) {
+  uint32_t rd = cache_.rd_idx & kCacheMask;
+  if (rd + len > kCacheSize) {
+    memcpy(&cache_.buf[kCacheSize], cache_.buf, rd + len - kCacheSize);
+  }
+  return &cache_.buf[rd];
 }
 
 int32_t CommPort::Pack(uint8_t *o_buf, uint32_t o_buf_size, uint32_t *o_len, const CommPacket &i_packet) {
@@ -105,40 +102,39 @@ int32_t CommPort::Pack(uint8_t *o_buf, uint32_t o_buf_size, uint32_t *o_len, con
 }
 
 int32_t CommPort::ParseCommStream(CommPacket *o_pack) {
-#define CUR_PACK_LEN (protocol_->GetPacketLen(&cache_.buf[cache_.rd_idx]))
-#define CUR_CACHE_POS (&cache_.buf[cache_.rd_idx])
-
-  while (GetValidDataSize() > protocol_->GetPreambleLen()) {
-    // printf("unpack step : %d %d %d\r\n", parse_step_, cache_.wr_idx, cache_.rd_idx);
+  uint32_t preamble_len = protocol_->GetPreambleLen();
+  while (true) {
     if (kSearchPacketPreamble == parse_step_) {
-      if (!protocol_->CheckPreamble(CUR_CACHE_POS)) {
+      // Only a start of frame byte is worth the preamble CRC.
+      if (!FindSof() || GetValidDataSize() < preamble_len) {
+        break;
+      }
+      uint8_t *preamble = Contiguous(preamble_len);
+      uint32_t packet_len = protocol_->GetPacketLen(preamble);
+      if (packet_len >= protocol_->GetPacketWrapperLen() && packet_len <= kCacheMirrorSize &&
+          !protocol_->CheckPreamble(preamble)) {
         parse_step_ = kGetPacketData;
       } else {
         ++cache_.rd_idx;
       }
-    } else if (kGetPacketData == parse_step_) {
-      if (GetValidDataSize() >= CUR_PACK_LEN && CUR_PACK_LEN) {
-        parse_step_ = kSearchPacketPreamble;
-        if (!protocol_->CheckPacket(CUR_CACHE_POS)) {
-          int32_t ret = protocol_->ParsePacket(CUR_CACHE_POS, GetValidDataSize(), o_pack);
-          cache_.rd_idx += CUR_PACK_LEN;
-          if (kParseSuccess == ret) {
-            return ret;
-          }
-        } else {
-          cache_.rd_idx += protocol_->GetPreambleLen();
-        }
-      } else {
-        if (CUR_PACK_LEN > cache_.size) {  // always > cache_.size,
-          cache_.rd_idx = 0;
-          cache_.wr_idx = 0;
-          parse_step_ = kSearchPacketPreamble;
-        }
-
+    } else {
+      // The preamble was checked when it arrived, wait for the rest of the packet without checking it again.
+      uint32_t packet_len = protocol_->GetPacketLen(Contiguous(preamble_len));
+      if (GetValidDataSize() < packet_len) {
         break;
       }
-    } else {
       parse_step_ = kSearchPacketPreamble;
+      uint8_t *packet = Contiguous(packet_len);
+      if (protocol_->CheckPacket(packet)) {
+        // Resynchronize right after the start of frame, a packet may begin inside the corrupt one.
+        ++cache_.rd_idx;
+        continue;
+      }
+      int32_t ret = protocol_->ParsePacket(packet, packet_len, o_pack);
+      cache_.rd_idx += packet_len;
+      if (kParseSuccess == ret) {
+        return ret;
+      }
     }
   }
 
@@ -23,7 +23,10 @@
 //
 
 #include "command_channel.h"
+#include <string.h>
 #include <boost/bind.hpp>
+#include "apr_portable.h"
+#include "base/instrumentation.h"
 #include "base/logging.h"
 #include "base/network_util.h"
 #include "command_impl.h"
@@ -32,7 +35,6 @@
 
 using boost::atomic_uint16_t;
 using boost::bind;
-using std::list;
 using std::make_pair;
 using std::map;
 using std::pair;
@@ -52,25 +54,52 @@ CommandChannel::CommandChannel(apr_port_t port,
       loop_(NULL),
       callback_(cb),
       comm_port_(new CommPort),
-      heartbeat_time_(0),
+      heartbeat_timer_(0),
       remote_ip_(remote_ip),
-      last_heartbeat_(0) {}
+      send_buffer_(kMaxCommandBufferSize),
+      last_heartbeat_(0) {
+  memset(&remote_addr_, 0, sizeof(remote_addr_));
+}
 
 bool CommandChannel::Bind(IOLoop *loop) {
   if (loop == NULL) {
     return false;
   }
   loop_ = loop;
+
+  apr_pool_t *subpool = NULL;
+  apr_status_t rv = apr_pool_create(&subpool, mem_pool_);
+  if (rv == APR_SUCCESS) {
+    apr_sockaddr_t *sa = NULL;
+    rv = apr_sockaddr_info_get(&sa, remote_ip_.c_str(), APR_INET, kDeviceCommandPort, 0, subpool);
+    if (rv == APR_SUCCESS) {
+      memcpy(&remote_addr_, &sa->sa.sin, sizeof(remote_addr_));
+    }
+    apr_pool_destroy(subpool);
+  }
+  if (rv != APR_SUCCESS) {
+    LOG_ERROR(PrintAPRStatus(rv));
+    return false;
+  }
+
   sock_ = util::CreateBindSocket(port_, mem_pool_);
   if (sock_ == NULL) {
     return false;
   }
 
   loop_->AddDelegate(sock_, this);
+  heartbeat_timer_ = loop_->AddTimer(apr_time_now(), bind(&CommandChannel::OnHeartbeatTimer, this, _1));
   return true;
 }
 
 void CommandChannel::OnData(apr_socket_t *, void *) {
+  ScopedLatency latency(instrumentation().command_delegate());
+  // Read until the socket would block, the loop may be edge-triggered.
+  while (sock_ && ReceiveCommand()) {
+  }
+}
+
+bool CommandChannel::ReceiveCommand() {
   apr_sockaddr_t addr;
   uint32_t buf_size = 0;
   uint8_t *cache_buf = comm_port_->FetchCacheFreeSpace(&buf_size);
@@ -78,8 +107,10 @@ void CommandChannel::OnData(apr_socket_t *, void *) {
   apr_status_t rv = apr_socket_recvfrom(&addr, sock_, 0, reinterpret_cast<char *>(cache_buf), &size);
   comm_port_->UpdateCacheWrIdx(size);
   if (rv != APR_SUCCESS) {
-    LOG_ERROR(PrintAPRStatus(rv));
-    return;
+    if (!APR_STATUS_IS_EAGAIN(rv)) {
+      LOG_ERROR(PrintAPRStatus(rv));
+    }
+    return false;
   }
 
   CommPacket packet;
@@ -88,13 +119,16 @@ void CommandChannel::OnData(apr_socket_t *, void *) {
   while ((kParseSuccess == comm_port_->ParseCommStream(&packet))) {
     if (packet.packet_type == kCommandTypeAck) {
       uint16_t seq = packet.seq_num;
-      if (commands_.find(seq) != commands_.end()) {
-        Command command = commands_[seq].first;
+      map<uint16_t, pair<Command, IOLoop::TimerId> >::iterator ite = commands_.find(seq);
+      if (ite != commands_.end()) {
+        Command command = ite->second.first;
+        loop_->CancelTimer(ite->second.second);
+        commands_.erase(ite);
         command.packet = packet;
         if (callback_) {
+          ScopedLatency callback_latency(instrumentation().command_callback());
           callback_->OnCommand(handle_, command);
         }
-        commands_.erase(seq);
       } else if (packet.cmd_set == kCommandSetGeneral && packet.cmd_code == kCommandIDGeneralHeartbeat) {
         OnHeartbeatAck(packet);
         if (callback_) {
@@ -105,49 +139,61 @@ void CommandChannel::OnData(apr_socket_t *, void *) {
       if (callback_) {
         Command command;
         command.packet = packet;
+        ScopedLatency callback_latency(instrumentation().command_callback());
         callback_->OnCommand(handle_, command);
       }
     }
   }
+  return true;
 }
 
 void CommandChannel::SendAsync(const Command &command) {
   Command cmd = DeepCopy(command);
   if (loop_) {
     loop_->PostTask(bind(&CommandChannel::Send, this, cmd));
+  } else {
+    FreeCopy(&cmd);
   }
 }
 
-void CommandChannel::OnTimer(apr_time_t now) {
-  list<Command> timeout_commands;
-  map<uint16_t, pair<Command, apr_time_t> >::iterator ite = commands_.begin();
-  while (ite != commands_.end()) {
-    pair<Command, apr_time_t> &command_pair = ite->second;
-    if (now > command_pair.second) {
-      timeout_commands.push_back(command_pair.first);
-      commands_.erase(ite++);
-    } else {
-      ++ite;
-    }
+void CommandChannel::OnCommandTimeout(uint16_t seq) {
+  map<uint16_t, pair<Command, IOLoop::TimerId> >::iterator ite = commands_.find(seq);
+  if (ite == commands_.end()) {
+    return;
   }
+  Command command = ite->second.first;
+  commands_.erase(ite);
 
-  for (list<Command>::iterator ite = timeout_commands.begin(); ite != timeout_commands.end(); ++ite) {
-    LOG_WARN("Apr time now: {}, Command Timeout: Set {}, Id {}, Seq {}", PrintAPRTime(apr_time_now()), 
-        (uint16_t)ite->packet.cmd_set, ite->packet.cmd_code, ite->packet.seq_num);
-    if (callback_) {
-      ite->packet.packet_type = kCommandTypeAck;
-      callback_->OnCommand(handle_, *ite);
-    }
+  LOG_WARN("Apr time now: {}, Command Timeout: Set {}, Id {}, Seq {}", PrintAPRTime(apr_time_now()),
+      (uint16_t)command.packet.cmd_set, command.packet.cmd_code, command.packet.seq_num);
+  if (callback_) {
+    command.packet.packet_type = kCommandTypeAck;
+    callback_->OnCommand(handle_, command);
   }
+}
 
+void CommandChannel::OnHeartbeatTimer(apr_time_t now) {
+  heartbeat_timer_ = 0;
   if ((last_heartbeat_ != 0) && (now - last_heartbeat_ > apr_time_from_sec(3))) {
     DeviceDisconnect(handle_);
-  } else {
-    HeartBeat(now);
+    return;
   }
+  HeartBeat();
+  heartbeat_timer_ =
+      loop_->AddTimer(now + apr_time_from_msec(kHeartbeatTimer), bind(&CommandChannel::OnHeartbeatTimer, this, _1));
 }
 
 void CommandChannel::Uninit() {
+  if (loop_) {
+    if (heartbeat_timer_ != 0) {
+      loop_->CancelTimer(heartbeat_timer_);
+    }
+    for (map<uint16_t, pair<Command, IOLoop::TimerId> >::iterator ite = commands_.begin(); ite != commands_.end();
+         ++ite) {
+      loop_->CancelTimer(ite->second.second);
+    }
+  }
+  heartbeat_timer_ = 0;
   if (sock_) {
     apr_os_thread_t thread_id = apr_os_thread_current();
     if (apr_os_thread_equal(loop_->GetThreadId(), thread_id)) {
@@ -166,44 +212,38 @@ void CommandChannel::Uninit() {
 
   commands_.clear();
   last_heartbeat_ = 0;
-  heartbeat_time_ = 0;
   remote_ip_ = "";
 }
 
-void CommandChannel::HeartBeat(apr_time_t t) {
-  if (heartbeat_time_ == 0 || (t - heartbeat_time_) > apr_time_from_msec(kHeartbeatTimer)) {
-    heartbeat_time_ = t;
-
-    Command command(handle_,
-                    kCommandTypeCmd,
-                    kCommandSetGeneral,
-                    kCommandIDGeneralHeartbeat,
-                    GenerateSeq(),
-                    NULL,
-                    0,
-                    0,
-                    boost::shared_ptr<CommandCallback>());
-    SendInternal(command);
-  }
+void CommandChannel::HeartBeat() {
+  Command command(handle_,
+                  kCommandTypeCmd,
+                  kCommandSetGeneral,
+                  kCommandIDGeneralHeartbeat,
+                  GenerateSeq(),
+                  NULL,
+                  0,
+                  0,
+                  boost::shared_ptr<CommandCallback>());
+  SendInternal(command);
 }
 
 void CommandChannel::SendInternal(const Command &command) {
-  apr_pool_t *subpool = NULL;
-  apr_pool_create(&subpool, mem_pool_);
-  uint8_t *buf = (uint8_t *)apr_palloc(subpool, kMaxCommandBufferSize);
   uint32_t size = 0;
-  comm_port_->Pack(buf, kMaxCommandBufferSize, &size, command.packet);
-  apr_size_t apr_size = size;
-  apr_status_t rv = APR_SUCCESS;
-  apr_sockaddr_t *sa = NULL;
-  rv = apr_sockaddr_info_get(&sa, remote_ip_.c_str(), APR_INET, 65000, 0, subpool);
-  if (rv == APR_SUCCESS) {
-    rv = apr_socket_sendto(sock_, sa, 0, (const char *)buf, &apr_size);
+  comm_port_->Pack(&send_buffer_[0], kMaxCommandBufferSize, &size, command.packet);
+  bool sent = false;
+  apr_os_sock_t fd;
+  if (sock_ && apr_os_sock_get(&fd, sock_) == APR_SUCCESS) {
+    sent = sendto(fd,
+                  reinterpret_cast<const char *>(&send_buffer_[0]),
+                  size,
+                  0,
+                  reinterpret_cast<const struct sockaddr *>(&remote_addr_),
+                  sizeof(remote_addr_)) == static_cast<int>(size);
   }
-  if (rv != APR_SUCCESS) {
+  if (!sent && command.cb) {
     (*command.cb)(kStatusSendFailed, handle_, NULL);
   }
-  apr_pool_destroy(subpool);
 }
 
 uint16_t CommandChannel::GenerateSeq() {
@@ -222,13 +262,37 @@ uint16_t CommandChannel::GenerateSeq() {
 
 Command CommandChannel::DeepCopy(const Command &cmd) {
   Command result_cmd(cmd);
+  result_cmd.payload = NULL;
   if (result_cmd.packet.data != NULL) {
-    result_cmd.packet.data = new uint8_t[result_cmd.packet.data_len];
+    if (cmd.packet.data_len <= payload_pool().buffer_size()) {
+      result_cmd.payload = payload_pool().Acquire();
+    }
+    if (result_cmd.payload) {
+      result_cmd.packet.data = reinterpret_cast<uint8_t *>(result_cmd.payload->data());
+    } else {
+      result_cmd.packet.data = new uint8_t[result_cmd.packet.data_len];
+    }
     memcpy(result_cmd.packet.data, cmd.packet.data, result_cmd.packet.data_len);
   }
   return result_cmd;
 }
 
+void CommandChannel::FreeCopy(Command *cmd) {
+  if (cmd->payload) {
+    cmd->payload->Release();
+    cmd->payload = NULL;
+  } else if (cmd->packet.data != NULL) {
+    delete[] cmd->packet.data;
+  }
+  cmd->packet.data = NULL;
+  cmd->packet.data_len = 0;
+}
+
+PacketPool &CommandChannel::payload_pool() {
+  static PacketPool pool(kPayloadBufferSize, kPayloadSlabCount, kMaxPayloadBufferCount);
+  return pool;
+}
+
 void CommandChannel::OnHeartbeatAck(const CommPacket &) {
   last_heartbeat_ = apr_time_now();
 }
@@ -240,12 +304,15 @@ void CommandChannel::DeviceDisconnect(uint8_t handle) {
 void CommandChannel::Send(const Command &command) {
   LOG_INFO(" Send Command: Set {} Id {} Seq {}", (uint16_t)command.packet.cmd_set, command.packet.cmd_code, command.packet.seq_num);
   SendInternal(command);
-  commands_[command.packet.seq_num] = make_pair(command, apr_time_now() + apr_time_from_msec(command.time_out));
-  Command &cmd = commands_[command.packet.seq_num].first;
-  if (cmd.packet.data != NULL) {
-    delete[] cmd.packet.data;
-    cmd.packet.data = NULL;
-    cmd.packet.data_len = 0;
+  uint16_t seq = command.packet.seq_num;
+  map<uint16_t, pair<Command, IOLoop::TimerId> >::iterator ite = commands_.find(seq);
+  if (ite != commands_.end()) {
+    // The sequence wrapped around while the old command is still pending.
+    loop_->CancelTimer(ite->second.second);
   }
+  IOLoop::TimerId timer = loop_->AddTimer(apr_time_now() + apr_time_from_msec(command.time_out),
+                                          bind(&CommandChannel::OnCommandTimeout, this, seq));
+  commands_[seq] = make_pair(command, timer);
+  FreeCopy(&commands_[seq].first);
 }
 }  // namespace livox
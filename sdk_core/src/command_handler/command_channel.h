@@ -27,8 +27,10 @@
 #include <boost/smart_ptr.hpp>
 #include <list>
 #include <string>
+#include <vector>
 #include "apr_network_io.h"
 #include "base/io_loop.h"
+#include "base/packet_pool.h"
 #include "comm/comm_port.h"
 
 namespace livox {
@@ -38,7 +40,9 @@ typedef struct TagCommand {
   CommPacket packet;
   boost::shared_ptr<CommandCallback> cb;
   uint32_t time_out;
-  TagCommand() : packet(), time_out(0) {}
+  /** Pooled buffer holding packet.data while the command waits to be sent, NULL if the data is not pooled. */
+  PacketBuffer *payload;
+  TagCommand() : packet(), time_out(0), payload(NULL) {}
   TagCommand(uint8_t _handle,
              uint8_t _cmd_type,
              uint8_t _cmd_set,
@@ -48,7 +52,7 @@ typedef struct TagCommand {
              uint16_t length,
              uint32_t _time_out,
              const boost::shared_ptr<CommandCallback> &_cb)
-      : handle(_handle), packet(), cb(_cb) {
+      : handle(_handle), packet(), cb(_cb), payload(NULL) {
     packet.packet_type = _cmd_type;
     packet.cmd_set = _cmd_set;
     packet.cmd_code = _cmd_code;
@@ -94,30 +98,46 @@ class CommandChannel : public IOLoop::IOLoopDelegate {
   void SendAsync(const Command &command);
 
   void OnData(apr_socket_t *, void *);
-  void OnTimer(apr_time_t now);
 
   static uint16_t GenerateSeq();
 
  private:
   void Send(const Command &cmd);
-  void HeartBeat(apr_time_t t);
+  void HeartBeat();
+  /** Check the heartbeat ack and send the next heartbeat, or disconnect a silent device. */
+  void OnHeartbeatTimer(apr_time_t now);
+  void OnCommandTimeout(uint16_t seq);
   void SendInternal(const Command &command);
   Command DeepCopy(const Command &cmd);
+  /** Free the data copied by DeepCopy(). */
+  static void FreeCopy(Command *cmd);
+  /** Small buffers the command data is copied into on its way to the IOLoop. */
+  static PacketPool &payload_pool();
   void OnHeartbeatAck(const CommPacket &packet);
+  /** Receive and handle one datagram, false if none was pending. */
+  bool ReceiveCommand();
   void DeviceDisconnect(uint8_t handle);
 
  private:
   static const int kHeartbeatTimer = 800;
+  static const apr_port_t kDeviceCommandPort = 65000;
+  static const uint32_t kPayloadBufferSize = 128;
+  static const uint32_t kPayloadSlabCount = 32;
+  static const uint32_t kMaxPayloadBufferCount = 1024;
   uint8_t handle_;
   apr_port_t port_;
   apr_socket_t *sock_;
   apr_pool_t *mem_pool_;
   IOLoop *loop_;
   CommandChannelDelegate *callback_;
-  std::map<uint16_t, std::pair<Command, apr_time_t> > commands_;
+  std::map<uint16_t, std::pair<Command, IOLoop::TimerId> > commands_;
   boost::scoped_ptr<CommPort> comm_port_;
-  apr_time_t heartbeat_time_;
+  IOLoop::TimerId heartbeat_timer_;
   std::string remote_ip_;
+  /** Command port of the device, resolved once in Bind(). */
+  struct sockaddr_in remote_addr_;
+  /** Packing buffer of the sends, which all run on the loop. */
+  std::vector<uint8_t> send_buffer_;
   apr_time_t last_heartbeat_;
 };
 
@@ -23,10 +23,13 @@
 //
 
 #include <livox_sdk.h>
+#include <boost/bind.hpp>
 
+#include "base/logging.h"
 #include "command_handler.h"
 #include "command_impl.h"
 #include "data_handler/data_handler.h"
+#include "data_handler/point_convert.h"
 #include "device_manager.h"
 #include "livox_def.h"
 #include "livox_sdk.h"
@@ -84,6 +87,395 @@ void SetDataCallback(uint8_t handle, DataCallback cb, void *client_data) {
     data_handler().AddDataListener(handle, cb, client_data);
 }
 
+static void OnDataLease(DataLeaseCallback cb,
+                        uint8_t handle,
+                        PacketBuffer *packet,
+                        LivoxEthPacket *data,
+                        uint32_t data_num,
+                        void *client_data) {
+    cb(handle, reinterpret_cast<LivoxPacketLease *>(packet), data, data_num, client_data);
+}
+
+void SetDataLeaseCallback(uint8_t handle, DataLeaseCallback cb, void *client_data) {
+    if (cb == NULL) {
+        data_handler().AddLeaseListener(handle, DataHandler::LeaseCallback(), client_data);
+        return;
+    }
+    data_handler().AddLeaseListener(handle, boost::bind(OnDataLease, cb, _1, _2, _3, _4, _5), client_data);
+}
+
+void RetainPacketLease(LivoxPacketLease *lease) {
+    if (lease) {
+        reinterpret_cast<PacketBuffer *>(lease)->Retain();
+    }
+}
+
+void ReleasePacketLease(LivoxPacketLease *lease) {
+    if (lease) {
+        reinterpret_cast<PacketBuffer *>(lease)->Release();
+    }
+}
+
+LivoxEthPacket *GetPacketLeaseData(LivoxPacketLease *lease, uint32_t *size) {
+    if (lease == NULL) {
+        return NULL;
+    }
+    PacketBuffer *packet = reinterpret_cast<PacketBuffer *>(lease);
+    if (size) {
+        *size = packet->size();
+    }
+    return reinterpret_cast<LivoxEthPacket *>(packet->data());
+}
+
+livox_status SetDataBufferPoolSize(uint32_t buffer_count) {
+    if (!data_handler().SetPacketPoolSize(buffer_count)) {
+        return kStatusFailure;
+    }
+    return kStatusSuccess;
+}
+
+livox_status SetBatchDataCallback(uint8_t handle,
+                                  BatchDataCallback cb,
+                                  uint32_t max_batch,
+                                  uint32_t max_delay_us,
+                                  void *client_data) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    DataHandler::BatchCallback batch_cb;
+    if (cb) {
+        batch_cb = cb;
+    }
+    if (!data_handler().AddBatchListener(handle, batch_cb, max_batch, max_delay_us, client_data)) {
+        return kStatusFailure;
+    }
+    return kStatusSuccess;
+}
+
+livox_status SetFrameBuilder(uint8_t handle, const LivoxFrameConfig *config, FrameCallback cb, void *client_data) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    DataHandler::FrameCallback frame_cb;
+    if (cb) {
+        frame_cb = cb;
+    }
+    if (!data_handler().SetFrameBuilder(handle, config, frame_cb, client_data)) {
+        return kStatusFailure;
+    }
+    return kStatusSuccess;
+}
+
+livox_status AcquireFrame(uint8_t handle, LivoxFrame *frame) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    return data_handler().AcquireFrame(handle, frame) ? kStatusSuccess : kStatusFailure;
+}
+
+livox_status ReleaseFrame(uint8_t handle) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    return data_handler().ReleaseFrame(handle) ? kStatusSuccess : kStatusFailure;
+}
+
+livox_status SetVoxelFilter(uint8_t handle, const LivoxVoxelConfig *config) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    return data_handler().SetVoxelFilter(handle, config) ? kStatusSuccess : kStatusFailure;
+}
+
+livox_status StartFrameMerge(const uint8_t *handles,
+                             uint8_t handle_count,
+                             const LivoxMergeConfig *config,
+                             MergedFrameCallback cb,
+                             void *client_data) {
+    if (handles == NULL || config == NULL || cb == NULL) {
+        return kStatusFailure;
+    }
+    uint32_t device_mask = 0;
+    for (uint8_t i = 0; i < handle_count; i++) {
+        if (handles[i] >= kMaxConnectedDeviceNum) {
+            return kStatusInvalidHandle;
+        }
+        device_mask |= 1u << handles[i];
+    }
+    if (!data_handler().StartFrameMerge(device_mask, *config, cb, client_data)) {
+        return kStatusFailure;
+    }
+    return kStatusSuccess;
+}
+
+void StopFrameMerge() {
+    data_handler().StopFrameMerge();
+}
+
+livox_status SetMotionDeskew(uint8_t handle, bool enable) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    return data_handler().SetMotionDeskew(handle, enable) ? kStatusSuccess : kStatusFailure;
+}
+
+livox_status PushDevicePose(uint8_t handle, const LivoxPose *pose) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    if (pose == NULL) {
+        return kStatusFailure;
+    }
+    return data_handler().PushPose(handle, *pose) ? kStatusSuccess : kStatusFailure;
+}
+
+livox_status DeskewPointBuffer(uint8_t handle, LivoxPointBuffer *buffer, uint64_t target_time) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    return data_handler().Deskew(handle, buffer, target_time);
+}
+
+livox_status SetImuDataCallback(uint8_t handle, ImuDataCallback cb, void *client_data) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    if (cb == NULL) {
+        data_handler().AddImuListener(handle, DataHandler::ImuCallback(), client_data);
+    } else {
+        data_handler().AddImuListener(handle, cb, client_data);
+    }
+    return kStatusSuccess;
+}
+
+livox_status GetImuAt(uint8_t handle, uint64_t timestamp, LivoxImuSample *sample) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    return data_handler().GetImuAt(handle, timestamp, sample);
+}
+
+livox_status GetPacketTimeBase(const LivoxEthPacket *packet, LivoxPacketTimeBase *time_base) {
+    return livox::GetPacketTimeBase(packet, time_base);
+}
+
+livox_status GetPointTimestamps(const LivoxEthPacket *packet,
+                                uint32_t data_num,
+                                uint64_t *timestamps,
+                                uint32_t capacity) {
+    return ComputePointTimestamps(packet, data_num, timestamps, capacity);
+}
+
+livox_status ConvertPacketToPointBuffer(const LivoxEthPacket *packet, uint32_t data_num, LivoxPointBuffer *buffer) {
+    return ConvertPacket(packet, data_num, NULL, buffer);
+}
+
+livox_status SetHostExtrinsicParameter(uint8_t handle, const LidarSetExtrinsicParameterRequest *extrinsic) {
+    bool result = false;
+    if (extrinsic == NULL) {
+        result = data_handler().SetPointTransform(handle, NULL);
+    } else {
+        PointTransform transform = MakePointTransform(
+            extrinsic->roll, extrinsic->pitch, extrinsic->yaw, extrinsic->x, extrinsic->y, extrinsic->z);
+        result = data_handler().SetPointTransform(handle, &transform);
+    }
+    return result ? kStatusSuccess : kStatusInvalidHandle;
+}
+
+static livox_status ConvertFilteredPacket(const LivoxEthPacket *packet,
+                                          uint32_t data_num,
+                                          const PointTransform *transform,
+                                          const LivoxPointFilter *filter,
+                                          const RoiFilter *roi,
+                                          LivoxPointBuffer *buffer) {
+    if (buffer == NULL) {
+        return kStatusFailure;
+    }
+    uint32_t size = buffer->size;
+    livox_status status = ConvertPacket(packet, data_num, transform, buffer);
+    if (status != kStatusSuccess || (filter == NULL && roi == NULL)) {
+        return status;
+    }
+    static const LivoxPointFilter kKeepAll = {0, 0};
+    uint8_t keep[kMaxPacketPoints];
+    uint32_t kept = 0;
+    if (FilterPacketPoints(packet, data_num, filter ? *filter : kKeepAll, keep, kMaxPacketPoints, &kept) ==
+        kStatusSuccess) {
+        if (roi) {
+            roi->FlagLimits(packet, data_num, keep);
+        }
+        CropPoints(buffer, size, keep, 1, roi);
+    }
+    return kStatusSuccess;
+}
+
+livox_status ConvertDevicePacketToPointBuffer(uint8_t handle,
+                                              const LivoxEthPacket *packet,
+                                              uint32_t data_num,
+                                              LivoxPointBuffer *buffer) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    boost::shared_ptr<const PointTransform> transform = data_handler().point_transform(handle);
+    boost::shared_ptr<const LivoxPointFilter> filter = data_handler().point_filter(handle);
+    boost::shared_ptr<const RoiFilter> roi = data_handler().roi_filter(handle);
+    return ConvertFilteredPacket(packet, data_num, transform.get(), filter.get(), roi.get(), buffer);
+}
+
+livox_status ConvertDevicePacketsToPointBuffer(uint8_t handle,
+                                               LivoxEthPacket **packets,
+                                               const uint32_t *data_nums,
+                                               uint32_t packet_num,
+                                               LivoxPointBuffer *buffer) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    if (packets == NULL || data_nums == NULL) {
+        return kStatusFailure;
+    }
+    boost::shared_ptr<const PointTransform> transform = data_handler().point_transform(handle);
+    boost::shared_ptr<const LivoxPointFilter> filter = data_handler().point_filter(handle);
+    boost::shared_ptr<const RoiFilter> roi = data_handler().roi_filter(handle);
+    for (uint32_t i = 0; i < packet_num; i++) {
+        livox_status status =
+            ConvertFilteredPacket(packets[i], data_nums[i], transform.get(), filter.get(), roi.get(), buffer);
+        if (status != kStatusSuccess && status != kStatusNotSupported) {
+            return status;
+        }
+    }
+    return kStatusSuccess;
+}
+
+livox_status SetPointFilter(uint8_t handle, const LivoxPointFilter *filter) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    return data_handler().SetPointFilter(handle, filter) ? kStatusSuccess : kStatusFailure;
+}
+
+livox_status SetRoiFilter(uint8_t handle, const LivoxRoiConfig *config) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    return data_handler().SetRoiFilter(handle, config) ? kStatusSuccess : kStatusFailure;
+}
+
+livox_status GetFilteredPointCount(uint8_t handle, uint64_t *count) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    if (count == NULL) {
+        return kStatusFailure;
+    }
+    *count = data_handler().filtered_points(handle);
+    return kStatusSuccess;
+}
+
+livox_status ConvertDualPacketToPointBuffers(const LivoxEthPacket *packet,
+                                             uint32_t data_num,
+                                             LivoxPointBuffer *first,
+                                             LivoxPointBuffer *second) {
+    return ConvertDualPacket(packet, data_num, NULL, first, second);
+}
+
+static void OnReturnData(ReturnDataCallback cb,
+                         uint8_t handle,
+                         LivoxEthPacket *data,
+                         const LivoxPointBuffer *points,
+                         void *client_data) {
+    cb(handle, data, points, client_data);
+}
+
+livox_status SetDualReturnCallback(uint8_t handle,
+                                   ReturnDataCallback first_return_cb,
+                                   ReturnDataCallback second_return_cb,
+                                   void *client_data) {
+    DataHandler::ReturnCallback first_cb;
+    DataHandler::ReturnCallback second_cb;
+    if (first_return_cb) {
+        first_cb = boost::bind(OnReturnData, first_return_cb, _1, _2, _3, _4);
+    }
+    if (second_return_cb) {
+        second_cb = boost::bind(OnReturnData, second_return_cb, _1, _2, _3, _4);
+    }
+    if (!data_handler().AddReturnListener(handle, first_cb, second_cb, client_data)) {
+        return kStatusInvalidHandle;
+    }
+    return kStatusSuccess;
+}
+
+livox_status ConvertPacketsToPointBuffer(LivoxEthPacket **packets,
+                                         const uint32_t *data_nums,
+                                         uint32_t packet_num,
+                                         LivoxPointBuffer *buffer) {
+    return ConvertPackets(packets, data_nums, packet_num, NULL, buffer);
+}
+
+livox_status SetDataRecvBatchSize(uint32_t batch_size) {
+    if (!data_handler().SetRecvBatchSize(batch_size)) {
+        return kStatusFailure;
+    }
+    return kStatusSuccess;
+}
+
+livox_status SetDataRecvThreadCount(uint8_t thread_count) {
+    if (!data_handler().SetRecvThreadCount(thread_count)) {
+        return kStatusFailure;
+    }
+    return kStatusSuccess;
+}
+
+livox_status SetDataRecvThreadOfDevice(uint8_t handle, uint8_t thread_index) {
+    if (!data_handler().SetRecvThreadIndex(handle, thread_index)) {
+        return kStatusInvalidHandle;
+    }
+    return kStatusSuccess;
+}
+
+livox_status SetDataRecvThreadAffinity(uint8_t thread_index, int32_t cpu) {
+#ifndef __linux__
+    if (cpu >= 0) {
+        return kStatusNotSupported;
+    }
+#endif
+    if (!data_handler().SetRecvThreadCpu(thread_index, cpu)) {
+        return kStatusFailure;
+    }
+    return kStatusSuccess;
+}
+
+livox_status SetImuRecvThreadPriority(int32_t priority) {
+#ifndef __linux__
+    if (priority > 0) {
+        return kStatusNotSupported;
+    }
+#endif
+    if (!data_handler().SetImuThreadPriority(priority)) {
+        return kStatusFailure;
+    }
+    return kStatusSuccess;
+}
+
+livox_status SetDataQueue(uint8_t handle, uint32_t capacity, DataQueuePolicy policy) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    if (!data_handler().SetDataQueue(handle, capacity, policy)) {
+        return kStatusFailure;
+    }
+    return kStatusSuccess;
+}
+
+livox_status GetDataQueueStatus(uint8_t handle, DataQueueStatus *status) {
+    if (handle >= kMaxConnectedDeviceNum) {
+        return kStatusInvalidHandle;
+    }
+    if (!data_handler().GetDataQueueStatus(handle, status)) {
+        return kStatusFailure;
+    }
+    return kStatusSuccess;
+}
+
 livox_status DeviceSampleControl(uint8_t handle, bool enable, CommonCommandCallback cb, void *client_data) {
     uint8_t req = enable;
     livox_status result = command_handler().SendCommand(handle,
@@ -292,6 +684,32 @@ livox_status SetSphericalCoordinate(uint8_t handle, CommonCommandCallback cb, vo
     return result;
 }
 
+static void OnHostCartesianCoordinateSet(livox_status status, uint8_t handle, uint8_t response, void *client_data) {
+    if (status != kStatusSuccess || response != 0) {
+        LOG_WARN("Failed to set the coordinate system of device {}, status {}, response {}", handle, status, response);
+    }
+}
+
+livox_status SetHostCartesianConversion(uint8_t handle, bool enable) {
+    // The hub command set has no coordinate system command, the LiDARs behind a hub keep their own setting.
+    if (device_manager().device_mode() != kDeviceModeLidar) {
+        return kStatusNotSupported;
+    }
+    bool previous = data_handler().host_cartesian(handle);
+    if (!data_handler().SetHostCartesian(handle, enable)) {
+        return kStatusInvalidHandle;
+    }
+    if (!device_manager().IsDeviceConnected(handle)) {
+        return kStatusSuccess;
+    }
+    livox_status status = enable ? SetSphericalCoordinate(handle, OnHostCartesianCoordinateSet, NULL)
+                                 : SetCartesianCoordinate(handle, OnHostCartesianCoordinateSet, NULL);
+    if (status != kStatusSuccess) {
+        data_handler().SetHostCartesian(handle, previous);
+    }
+    return status;
+}
+
 livox_status SetErrorMessageCallback(uint8_t handle, ErrorMessageCallback cb) {
     livox_status result = command_handler().RegisterPush(
                               handle, kCommandSetGeneral, kCommandIDGeneralPushAbnormalState, MakeMessageCallback<ErrorMessage>(cb));
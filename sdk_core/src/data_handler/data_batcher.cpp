@@ -0,0 +1,112 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "data_batcher.h"
+#include <boost/thread/lock_guard.hpp>
+
+namespace livox {
+
+DataBatcher::DataBatcher(uint32_t max_batch,
+                         apr_interval_time_t max_delay,
+                         const Consumer &consumer,
+                         const Scheduler &scheduler)
+    : max_batch_(max_batch), max_delay_(max_delay), consumer_(consumer), scheduler_(scheduler), deadline_(0) {
+  buffers_.reserve(max_batch_);
+  packets_.reserve(max_batch_);
+  data_nums_.reserve(max_batch_);
+  flushing_buffers_.reserve(max_batch_);
+  flushing_packets_.reserve(max_batch_);
+  flushing_data_nums_.reserve(max_batch_);
+}
+
+DataBatcher::~DataBatcher() {
+  for (size_t i = 0; i < buffers_.size(); i++) {
+    buffers_[i]->Release();
+  }
+}
+
+void DataBatcher::Add(PacketBuffer *packet, uint32_t data_num) {
+  apr_time_t now = apr_time_now();
+  apr_time_t started = 0;
+  bool flush = false;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    if (buffers_.empty()) {
+      deadline_ = now + max_delay_;
+    }
+    packet->Retain();
+    buffers_.push_back(packet);
+    packets_.push_back(reinterpret_cast<LivoxEthPacket *>(packet->data()));
+    data_nums_.push_back(data_num);
+    if (buffers_.size() >= max_batch_ || now >= deadline_) {
+      flush = true;
+    } else if (buffers_.size() == 1) {
+      started = deadline_;
+    }
+  }
+  if (flush) {
+    Flush();
+  } else if (started != 0 && scheduler_) {
+    scheduler_(started);
+  }
+}
+
+apr_time_t DataBatcher::FlushExpired(apr_time_t now) {
+  {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    if (buffers_.empty()) {
+      return 0;
+    }
+    if (now < deadline_) {
+      return deadline_;
+    }
+  }
+  Flush();
+  return 0;
+}
+
+void DataBatcher::Flush() {
+  // The batch is handed over under mutex_ only, Add keeps filling the next one while the consumer runs.
+  boost::lock_guard<boost::mutex> flush_lock(flush_mutex_);
+  {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    buffers_.swap(flushing_buffers_);
+    packets_.swap(flushing_packets_);
+    data_nums_.swap(flushing_data_nums_);
+  }
+  if (flushing_buffers_.empty()) {
+    return;
+  }
+  if (consumer_) {
+    consumer_(&flushing_packets_[0], &flushing_data_nums_[0], static_cast<uint32_t>(flushing_packets_.size()));
+  }
+  for (size_t i = 0; i < flushing_buffers_.size(); i++) {
+    flushing_buffers_[i]->Release();
+  }
+  flushing_buffers_.clear();
+  flushing_packets_.clear();
+  flushing_data_nums_.clear();
+}
+
+}  // namespace livox
@@ -0,0 +1,93 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_DATA_BATCHER_H_
+#define LIVOX_DATA_BATCHER_H_
+
+#include <vector>
+#include <apr_time.h>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include "base/noncopyable.h"
+#include "base/packet_pool.h"
+#include "livox_def.h"
+
+namespace livox {
+
+/**
+ * Collects the packets of a device and hands them to the consumer in one
+ * call, once max_batch packets are pending or the oldest pending packet is
+ * older than max_delay. Packets are referenced, not copied. The scheduler
+ * is told the deadline of every batch Add leaves pending, so the owner only
+ * runs a flush timer while there is something to flush.
+ */
+class DataBatcher : public noncopyable {
+ public:
+  typedef boost::function<void(LivoxEthPacket **packets, uint32_t *data_nums, uint32_t count)> Consumer;
+  typedef boost::function<void(apr_time_t deadline)> Scheduler;
+
+  DataBatcher(uint32_t max_batch,
+              apr_interval_time_t max_delay,
+              const Consumer &consumer,
+              const Scheduler &scheduler);
+  ~DataBatcher();
+
+  /**
+   * Append a packet holding data_num points, called on the thread dispatching the device data. A packet starting
+   * a batch that is not flushed right away hands the batch deadline to the scheduler.
+   */
+  void Add(PacketBuffer *packet, uint32_t data_num);
+
+  /**
+   * Flush the pending packets if their deadline has passed.
+   * @return the time to check the batch again, 0 if nothing is pending.
+   */
+  apr_time_t FlushExpired(apr_time_t now);
+
+  /** Hand the pending packets to the consumer now, called without mutex_ held. */
+  void Flush();
+
+ private:
+
+  uint32_t max_batch_;
+  apr_interval_time_t max_delay_;
+  Consumer consumer_;
+  Scheduler scheduler_;
+  apr_time_t deadline_;
+  std::vector<PacketBuffer *> buffers_;
+  std::vector<LivoxEthPacket *> packets_;
+  std::vector<uint32_t> data_nums_;
+  /** The batch being delivered, swapped with the pending one so the consumer runs without mutex_. */
+  std::vector<PacketBuffer *> flushing_buffers_;
+  std::vector<LivoxEthPacket *> flushing_packets_;
+  std::vector<uint32_t> flushing_data_nums_;
+  /** Guards the pending batch. */
+  boost::mutex mutex_;
+  /** Held while the consumer runs, keeps the batches in order. */
+  boost::mutex flush_mutex_;
+};
+
+}  // namespace livox
+
+#endif  // LIVOX_DATA_BATCHER_H_
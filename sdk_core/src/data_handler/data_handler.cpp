@@ -24,12 +24,17 @@
 
 #include "data_handler.h"
 #include <base/logging.h>
+#include <string.h>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include "base/instrumentation.h"
 #include "hub_data_handler.h"
 #include "lidar_data_handler.h"
+#include "livox_packet_view.h"
 
 namespace livox {
 
-static const size_t kPrefixDataSize = 18;
+const uint8_t DataHandler::kRecvThreadRoundRobin;
 
 DataHandler &data_handler() {
   static DataHandler handler;
@@ -45,6 +50,438 @@ bool DataHandler::AddDataListener(uint8_t handle, const DataCallback &cb, void *
   return true;
 }
 
+bool DataHandler::AddLeaseListener(uint8_t handle, const LeaseCallback &cb, void *client_data) {
+  if (handle >= lease_callbacks_.size()) {
+    return false;
+  }
+  lease_client_data_[handle] = client_data;
+  lease_callbacks_[handle] = cb;
+  return true;
+}
+
+bool DataHandler::AddReturnListener(uint8_t handle,
+                                    const ReturnCallback &first_cb,
+                                    const ReturnCallback &second_cb,
+                                    void *client_data) {
+  if (handle >= first_return_callbacks_.size()) {
+    return false;
+  }
+  return_client_data_[handle] = client_data;
+  first_return_callbacks_[handle] = first_cb;
+  second_return_callbacks_[handle] = second_cb;
+  return true;
+}
+
+bool DataHandler::AddBatchListener(uint8_t handle,
+                                   const BatchCallback &cb,
+                                   uint32_t max_batch,
+                                   apr_interval_time_t max_delay,
+                                   void *client_data) {
+  if (handle >= batchers_.size()) {
+    return false;
+  }
+  if (!cb) {
+    boost::atomic_store(&batchers_[handle], boost::shared_ptr<DataBatcher>());
+    return true;
+  }
+  if (max_batch == 0 || max_batch > kMaxBatchPacketCount || max_delay < 0) {
+    return false;
+  }
+  boost::shared_ptr<DataBatcher> batcher(
+      new DataBatcher(max_batch,
+                      max_delay,
+                      boost::bind(cb, handle, _1, _2, _3, client_data),
+                      boost::bind(&DataHandler::ScheduleBatchFlush, this, handle, _1)));
+  boost::atomic_store(&batchers_[handle], batcher);
+  return true;
+}
+
+bool DataHandler::SetFrameBuilder(uint8_t handle,
+                                  const LivoxFrameConfig *config,
+                                  const FrameCallback &cb,
+                                  void *client_data) {
+  if (handle >= frame_builders_.size()) {
+    return false;
+  }
+  if (config == NULL) {
+    boost::atomic_store(&frame_builders_[handle], boost::shared_ptr<FrameBuilder>());
+    return true;
+  }
+  if (config->duration == 0 && config->max_points == 0) {
+    return false;
+  }
+  FrameBuilder::Consumer consumer;
+  if (cb) {
+    consumer = boost::bind(cb, handle, _1, client_data);
+  }
+  boost::shared_ptr<FrameBuilder> builder(
+      new FrameBuilder(*config, consumer, boost::bind(&DataHandler::FinishFrame, this, handle, _1)));
+  boost::atomic_store(&frame_builders_[handle], builder);
+  return true;
+}
+
+bool DataHandler::AcquireFrame(uint8_t handle, LivoxFrame *frame) {
+  if (handle >= frame_builders_.size() || frame == NULL) {
+    return false;
+  }
+  boost::shared_ptr<FrameBuilder> builder = boost::atomic_load(&frame_builders_[handle]);
+  return builder && builder->Acquire(frame);
+}
+
+bool DataHandler::ReleaseFrame(uint8_t handle) {
+  if (handle >= frame_builders_.size()) {
+    return false;
+  }
+  boost::shared_ptr<FrameBuilder> builder = boost::atomic_load(&frame_builders_[handle]);
+  if (!builder) {
+    return false;
+  }
+  builder->Release();
+  return true;
+}
+
+bool DataHandler::SetVoxelFilter(uint8_t handle, const LivoxVoxelConfig *config) {
+  if (handle >= frame_builders_.size()) {
+    return false;
+  }
+  if (config && (!(config->leaf_size > 0) || !(config->size_per_metre >= 0) || config->mode > kVoxelFirstPoint)) {
+    return false;
+  }
+  boost::shared_ptr<FrameBuilder> builder = boost::atomic_load(&frame_builders_[handle]);
+  if (!builder) {
+    return false;
+  }
+  builder->SetVoxelFilter(config);
+  return true;
+}
+
+bool DataHandler::StartFrameMerge(uint32_t device_mask,
+                                  const LivoxMergeConfig &config,
+                                  const MergedFrameCallback &cb,
+                                  void *client_data) {
+  if (device_mask == 0 || config.period == 0 || !cb) {
+    return false;
+  }
+  boost::shared_ptr<FrameMerger> merger(new FrameMerger(config, device_mask, boost::bind(cb, _1, client_data)));
+  boost::shared_ptr<FrameMerger> old = boost::atomic_exchange(&merger_, merger);
+  if (old) {
+    old->Flush();
+  }
+  return true;
+}
+
+void DataHandler::StopFrameMerge() {
+  boost::shared_ptr<FrameMerger> old = boost::atomic_exchange(&merger_, boost::shared_ptr<FrameMerger>());
+  if (old) {
+    old->Flush();
+  }
+}
+
+apr_time_t DataHandler::FlushBatch(uint8_t handle, apr_time_t now) {
+  if (handle >= batchers_.size()) {
+    return 0;
+  }
+  boost::shared_ptr<DataBatcher> batcher = boost::atomic_load(&batchers_[handle]);
+  return batcher ? batcher->FlushExpired(now) : 0;
+}
+
+void DataHandler::DrainBatch(uint8_t handle) {
+  if (handle >= batchers_.size()) {
+    return;
+  }
+  boost::shared_ptr<DataBatcher> batcher = boost::atomic_load(&batchers_[handle]);
+  if (batcher) {
+    batcher->Flush();
+  }
+}
+
+void DataHandler::ScheduleBatchFlush(uint8_t handle, apr_time_t deadline) {
+  if (impl_) {
+    impl_->ArmBatchTimer(handle, deadline);
+  }
+}
+
+bool DataHandler::SetPacketPoolSize(uint32_t buffer_count) {
+  if (buffer_count < kMinPacketPoolSize) {
+    return false;
+  }
+  packet_pool_.set_max_count(buffer_count);
+  return true;
+}
+
+bool DataHandler::SetRecvBatchSize(uint32_t batch_size) {
+  if (batch_size == 0 || batch_size > kMaxRecvBatchSize) {
+    return false;
+  }
+  recv_batch_size_ = batch_size;
+  return true;
+}
+
+bool DataHandler::SetRecvThreadCount(uint8_t count) {
+  if (impl_ != NULL || count > kMaxRecvThreadCount) {
+    return false;
+  }
+  recv_thread_count_ = count;
+  return true;
+}
+
+bool DataHandler::SetRecvThreadIndex(uint8_t handle, uint8_t thread_index) {
+  if (handle >= recv_thread_index_.size() || thread_index >= kMaxRecvThreadCount) {
+    return false;
+  }
+  recv_thread_index_[handle] = thread_index;
+  return true;
+}
+
+uint8_t DataHandler::RecvThreadIndex(uint8_t handle) const {
+  if (handle >= recv_thread_index_.size()) {
+    return 0;
+  }
+  if (recv_thread_index_[handle] == kRecvThreadRoundRobin) {
+    // Handles are allocated in connecting order, so this spreads devices round-robin.
+    return recv_thread_count_ ? handle % recv_thread_count_ : 0;
+  }
+  return recv_thread_index_[handle];
+}
+
+bool DataHandler::SetRecvThreadCpu(uint8_t thread_index, int32_t cpu) {
+  if (impl_ != NULL || thread_index >= kMaxRecvThreadCount || cpu < -1) {
+    return false;
+  }
+  recv_thread_cpu_[thread_index] = cpu;
+  return true;
+}
+
+bool DataHandler::SetDataQueue(uint8_t handle, uint32_t capacity, DataQueuePolicy policy) {
+  if (handle >= queues_.size() || capacity > kMaxDataQueueCapacity) {
+    return false;
+  }
+  if (policy != kDataQueueDropOldest && policy != kDataQueueDropNewest && policy != kDataQueueBlock) {
+    return false;
+  }
+  boost::shared_ptr<PacketQueue> old = boost::atomic_load(&queues_[handle]);
+  if (old && old->IsQueueThread()) {
+    // The queue thread cannot join itself.
+    return false;
+  }
+  // Stop the old queue here, the receive thread may still hold it but only drops packets into it from now on.
+  old = boost::atomic_exchange(&queues_[handle], boost::shared_ptr<PacketQueue>());
+  if (old) {
+    old->Stop();
+    old.reset();
+  }
+  if (capacity == 0) {
+    return true;
+  }
+
+  boost::shared_ptr<PacketQueue> queue(
+      new PacketQueue(capacity, policy, boost::bind(&DataHandler::DispatchData, this, handle, _1)));
+  if (!queue->Init()) {
+    LOG_ERROR("Failed to start the data queue of device {}", handle);
+    return false;
+  }
+  boost::atomic_store(&queues_[handle], queue);
+  return true;
+}
+
+bool DataHandler::SetHostCartesian(uint8_t handle, bool enable) {
+  if (handle >= host_cartesian_.size()) {
+    return false;
+  }
+  host_cartesian_[handle] = enable;
+  return true;
+}
+
+bool DataHandler::SetPointTransform(uint8_t handle, const PointTransform *transform) {
+  if (handle >= transforms_.size()) {
+    return false;
+  }
+  boost::shared_ptr<const PointTransform> value;
+  if (transform) {
+    value.reset(new PointTransform(*transform));
+  }
+  boost::atomic_store(&transforms_[handle], value);
+  return true;
+}
+
+boost::shared_ptr<const PointTransform> DataHandler::point_transform(uint8_t handle) const {
+  if (handle >= transforms_.size()) {
+    return boost::shared_ptr<const PointTransform>();
+  }
+  return boost::atomic_load(&transforms_[handle]);
+}
+
+bool DataHandler::SetPointFilter(uint8_t handle, const LivoxPointFilter *filter) {
+  if (handle >= point_filters_.size()) {
+    return false;
+  }
+  boost::shared_ptr<const LivoxPointFilter> value;
+  if (filter && (filter->tag_mask != 0 || filter->drop_zero)) {
+    value.reset(new LivoxPointFilter(*filter));
+  }
+  boost::atomic_store(&point_filters_[handle], value);
+  return true;
+}
+
+boost::shared_ptr<const LivoxPointFilter> DataHandler::point_filter(uint8_t handle) const {
+  if (handle >= point_filters_.size()) {
+    return boost::shared_ptr<const LivoxPointFilter>();
+  }
+  return boost::atomic_load(&point_filters_[handle]);
+}
+
+bool DataHandler::SetRoiFilter(uint8_t handle, const LivoxRoiConfig *config) {
+  if (handle >= roi_filters_.size()) {
+    return false;
+  }
+  boost::shared_ptr<const RoiFilter> value;
+  if (config) {
+    if (!RoiFilter::IsValid(*config)) {
+      return false;
+    }
+    value.reset(new RoiFilter(*config));
+    if (!value->has_limits() && !value->has_shapes()) {
+      value.reset();
+    }
+  }
+  boost::atomic_store(&roi_filters_[handle], value);
+  return true;
+}
+
+boost::shared_ptr<const RoiFilter> DataHandler::roi_filter(uint8_t handle) const {
+  if (handle >= roi_filters_.size()) {
+    return boost::shared_ptr<const RoiFilter>();
+  }
+  return boost::atomic_load(&roi_filters_[handle]);
+}
+
+bool DataHandler::SetMotionDeskew(uint8_t handle, bool enable) {
+  if (handle >= deskews_.size()) {
+    return false;
+  }
+  boost::shared_ptr<MotionDeskew> deskew;
+  if (enable) {
+    deskew = boost::atomic_load(&deskews_[handle]);
+    if (deskew) {
+      return true;
+    }
+    deskew.reset(new MotionDeskew);
+  }
+  boost::atomic_store(&deskews_[handle], deskew);
+  return true;
+}
+
+bool DataHandler::PushPose(uint8_t handle, const LivoxPose &pose) {
+  if (handle >= deskews_.size()) {
+    return false;
+  }
+  boost::shared_ptr<MotionDeskew> deskew = boost::atomic_load(&deskews_[handle]);
+  if (!deskew) {
+    return false;
+  }
+  deskew->AddPose(pose);
+  return true;
+}
+
+livox_status DataHandler::Deskew(uint8_t handle, LivoxPointBuffer *points, uint64_t target_time) {
+  if (handle >= deskews_.size()) {
+    return kStatusFailure;
+  }
+  boost::shared_ptr<MotionDeskew> deskew = boost::atomic_load(&deskews_[handle]);
+  if (!deskew) {
+    return kStatusFailure;
+  }
+  boost::shared_ptr<const PointTransform> transform = boost::atomic_load(&transforms_[handle]);
+  return deskew->Deskew(points, target_time, transform.get());
+}
+
+void DataHandler::FinishFrame(uint8_t handle, LivoxFrame *frame) {
+  boost::shared_ptr<MotionDeskew> deskew = boost::atomic_load(&deskews_[handle]);
+  if (deskew) {
+    boost::shared_ptr<const PointTransform> transform = boost::atomic_load(&transforms_[handle]);
+    deskew->Deskew(&frame->points, frame->end_time, transform.get());
+  }
+}
+
+bool DataHandler::AddImuListener(uint8_t handle, const ImuCallback &cb, void *client_data) {
+  if (handle >= imu_callbacks_.size()) {
+    return false;
+  }
+  imu_client_data_[handle] = client_data;
+  imu_callbacks_[handle] = cb;
+  return true;
+}
+
+livox_status DataHandler::GetImuAt(uint8_t handle, uint64_t timestamp, LivoxImuSample *sample) const {
+  if (handle >= imu_buffers_.size() || sample == NULL) {
+    return kStatusFailure;
+  }
+  boost::shared_ptr<ImuBuffer> buffer = boost::atomic_load(&imu_buffers_[handle]);
+  if (!buffer) {
+    return kStatusFailure;
+  }
+  return buffer->At(timestamp, sample);
+}
+
+bool DataHandler::SetImuThreadPriority(int32_t priority) {
+  if (impl_ != NULL || priority < 0 || priority > kMaxImuThreadPriority) {
+    return false;
+  }
+  imu_thread_priority_ = priority;
+  return true;
+}
+
+void DataHandler::SetImuChannel(uint8_t handle, bool enable) {
+  if (handle < imu_channel_.size()) {
+    imu_channel_[handle] = enable;
+  }
+}
+
+void DataHandler::OnImuData(uint8_t handle, PacketBuffer *packet) {
+  if (packet == NULL || packet->size() < kEthPacketHeaderSize || handle >= imu_channel_.size()) {
+    return;
+  }
+  const LivoxEthPacket *data = reinterpret_cast<const LivoxEthPacket *>(packet->data());
+  if (data->data_type == kImu) {
+    HandleImu(handle, data, PacketPointCount(data, packet->size()));
+  }
+}
+
+void DataHandler::HandleImu(uint8_t handle, const LivoxEthPacket *data, uint32_t data_num) {
+  LivoxPacketTimeBase time;
+  if (data_num == 0 || livox::GetPacketTimeBase(data, &time) != kStatusSuccess) {
+    return;
+  }
+  LivoxImuSample sample;
+  sample.timestamp = time.timestamp;
+  memcpy(&sample.imu, data->data, sizeof(sample.imu));
+  boost::shared_ptr<ImuBuffer> buffer = boost::atomic_load(&imu_buffers_[handle]);
+  if (buffer) {
+    buffer->Push(sample.timestamp, sample.imu);
+  }
+  boost::shared_ptr<MotionDeskew> deskew = boost::atomic_load(&deskews_[handle]);
+  if (deskew) {
+    deskew->AddImu(sample.timestamp, sample.imu);
+  }
+  const ImuCallback &cb = imu_callbacks_[handle];
+  if (cb) {
+    ScopedLatency latency(instrumentation().imu_callback());
+    cb(handle, &sample, imu_client_data_[handle]);
+  }
+}
+
+bool DataHandler::GetDataQueueStatus(uint8_t handle, DataQueueStatus *status) const {
+  if (handle >= queues_.size() || status == NULL) {
+    return false;
+  }
+  boost::shared_ptr<PacketQueue> queue = boost::atomic_load(&queues_[handle]);
+  if (!queue) {
+    return false;
+  }
+  queue->GetStatus(status);
+  return true;
+}
+
 bool DataHandler::AddDevice(const DeviceInfo &info) {
   if (impl_ == NULL) {
     DeviceMode mode = static_cast<DeviceMode>(device_manager().device_mode());
@@ -59,6 +496,9 @@ bool DataHandler::AddDevice(const DeviceInfo &info) {
       return false;
     }
   }
+  if (info.handle < imu_buffers_.size() && !boost::atomic_load(&imu_buffers_[info.handle])) {
+    boost::atomic_store(&imu_buffers_[info.handle], boost::make_shared<ImuBuffer>(ImuBuffer::kDefaultCapacity));
+  }
   return impl_->AddDevice(info);
 }
 
@@ -74,47 +514,63 @@ void DataHandler::Uninit() {
   if (impl_) {
     impl_.reset(NULL);
   }
+  for (size_t i = 0; i < queues_.size(); i++) {
+    queues_[i].reset();
+  }
+  for (size_t i = 0; i < batchers_.size(); i++) {
+    batchers_[i].reset();
+  }
   if (mem_pool_) {
     apr_pool_destroy(mem_pool_);
     mem_pool_ = NULL;
   }
 }
 
-void DataHandler::OnDataCallback(uint8_t handle, void *data, uint16_t size) {
-  LivoxEthPacket *lidar_data = (LivoxEthPacket *)data;
-  if (lidar_data == NULL) {
+void DataHandler::OnDataCallback(uint8_t handle, PacketBuffer *packet) {
+  if (handle < queues_.size()) {
+    boost::shared_ptr<PacketQueue> queue = boost::atomic_load(&queues_[handle]);
+    if (queue) {
+      queue->Push(packet);
+      return;
+    }
+  }
+  DispatchData(handle, packet);
+}
+
+void DataHandler::DispatchData(uint8_t handle, PacketBuffer *packet) {
+  if (packet == NULL || packet->size() < kEthPacketHeaderSize) {
     return;
   }
   if (handle >= callbacks_.size()) {
     return;
   }
-  DataCallback cb = callbacks_[handle];
-  switch (lidar_data->data_type) {
-    case kCartesian:
-      size = (size - kPrefixDataSize) / sizeof(LivoxRawPoint);
-      break;
-    case kSpherical:
-      size = (size - kPrefixDataSize) / sizeof(LivoxSpherPoint);
-      break;
-    case kExtendCartesian:
-      size = (size - kPrefixDataSize) / sizeof(LivoxExtendRawPoint);
-      break;
-    case kExtendSpherical:
-      size = (size - kPrefixDataSize) / sizeof(LivoxExtendSpherPoint);
-      break;
-    case kDualExtendCartesian:
-      size = (size - kPrefixDataSize) / sizeof(LivoxDualExtendRawPoint);
-      break;
-    case kDualExtendSpherical:
-      size = (size - kPrefixDataSize) / sizeof(LivoxDualExtendSpherPoint);
-      break;
-    case kImu:
-      size = (size - kPrefixDataSize) / sizeof(LivoxImuPoint);
-      break;
-    default: 
+  LivoxEthPacket *lidar_data = (LivoxEthPacket *)packet->data();
+  if (PointSizeOf(lidar_data->data_type) == 0) {
+    return;
+  }
+  uint32_t size = PacketPointCount(lidar_data, packet->size());
+  if (host_cartesian_[handle] && (lidar_data->data_type == kSpherical || lidar_data->data_type == kExtendSpherical ||
+                                  lidar_data->data_type == kDualExtendSpherical)) {
+    PacketBuffer *converted = packet_pool_.Acquire();
+    if (converted == NULL) {
       return;
+    }
+    converted->set_size(SphericalToCartesianPacket(
+        lidar_data, size, reinterpret_cast<LivoxEthPacket *>(converted->data()), converted->capacity()));
+    if (converted->size() > 0) {
+      DispatchData(handle, converted);
+    }
+    converted->Release();
+    return;
   }
+  // After the conversion, which dispatches the converted packet again.
+  ScopedLatency latency(instrumentation().data_dispatch());
+  if (lidar_data->data_type == kImu && !imu_channel_[handle]) {
+    HandleImu(handle, lidar_data, size);
+  }
+  const DataCallback &cb = callbacks_[handle];
   if (cb) {
+    ScopedLatency callback_latency(instrumentation().data_callback());
     //LOG_INFO(" device_sn: {}",  device_sn);
     //LOG_INFO(" version: {}", (uint32_t)lidar_data->version);
     //LOG_INFO(" slot: {}", (uint32_t)lidar_data->slot);
@@ -126,12 +582,139 @@ void DataHandler::OnDataCallback(uint8_t handle, void *data, uint16_t size) {
     //LOG_INFO(" dataType: {}", (uint16_t) lidar_data->data_type);
     cb(handle, lidar_data, size, client_data_[handle]);
   }
+  const LeaseCallback &lease_cb = lease_callbacks_[handle];
+  if (lease_cb) {
+    lease_cb(handle, packet, lidar_data, size, lease_client_data_[handle]);
+  }
+  boost::shared_ptr<DataBatcher> batcher = boost::atomic_load(&batchers_[handle]);
+  if (batcher) {
+    batcher->Add(packet, size);
+  }
+  // Flag the points to drop once, for every stage building point buffers.
+  uint8_t keep_flags[kMaxPacketPoints];
+  const uint8_t *keep = NULL;
+  boost::shared_ptr<const LivoxPointFilter> filter = boost::atomic_load(&point_filters_[handle]);
+  boost::shared_ptr<const RoiFilter> roi = boost::atomic_load(&roi_filters_[handle]);
+  if (filter || (roi && roi->has_limits())) {
+    static const LivoxPointFilter kKeepAll = {0, 0};
+    uint32_t kept = 0;
+    if (FilterPacketPoints(lidar_data, size, filter ? *filter : kKeepAll, keep_flags, kMaxPacketPoints, &kept) ==
+        kStatusSuccess) {
+      keep = keep_flags;
+      uint32_t count = size;
+      if (lidar_data->data_type == kDualExtendCartesian || lidar_data->data_type == kDualExtendSpherical) {
+        count *= 2;
+      }
+      filtered_points_[handle] += count - kept;
+      if (roi) {
+        // The range and azimuth limits need the sensor frame, they are tested before the conversion.
+        roi->FlagLimits(lidar_data, size, keep_flags);
+      }
+    }
+  }
+  if (lidar_data->data_type == kDualExtendCartesian || lidar_data->data_type == kDualExtendSpherical) {
+    DispatchReturns(handle, lidar_data, size, keep, roi.get());
+  }
+  boost::shared_ptr<FrameBuilder> builder = boost::atomic_load(&frame_builders_[handle]);
+  boost::shared_ptr<FrameMerger> merger = boost::atomic_load(&merger_);
+  if (merger && !merger->Contains(handle)) {
+    merger.reset();
+  }
+  if (builder || merger) {
+    boost::shared_ptr<const PointTransform> transform = boost::atomic_load(&transforms_[handle]);
+    if (builder) {
+      builder->Add(lidar_data, size, transform.get(), keep, roi.get());
+    }
+    if (merger) {
+      merger->Add(handle, lidar_data, size, transform.get(), keep, roi.get());
+    }
+  }
+}
+
+void DataHandler::DispatchReturns(
+    uint8_t handle, LivoxEthPacket *data, uint32_t data_num, const uint8_t *keep, const RoiFilter *roi) {
+  static const uint32_t kMaxReturnPoints = PointTraits<kDualExtendCartesian>::kPointsPerPacket;
+  const ReturnCallback &first_cb = first_return_callbacks_[handle];
+  const ReturnCallback &second_cb = second_return_callbacks_[handle];
+  if ((!first_cb && !second_cb) || data_num > kMaxReturnPoints) {
+    return;
+  }
+  float xyz[2][3][kMaxReturnPoints];
+  uint8_t reflectivity[2][kMaxReturnPoints];
+  uint8_t tag[2][kMaxReturnPoints];
+  uint64_t timestamp[2][kMaxReturnPoints];
+  LivoxPointBuffer first = {
+      xyz[0][0], xyz[0][1], xyz[0][2], reflectivity[0], tag[0], timestamp[0], kMaxReturnPoints, 0};
+  LivoxPointBuffer second = {
+      xyz[1][0], xyz[1][1], xyz[1][2], reflectivity[1], tag[1], timestamp[1], kMaxReturnPoints, 0};
+  boost::shared_ptr<const PointTransform> transform = boost::atomic_load(&transforms_[handle]);
+  if (ConvertDualPacket(data, data_num, transform.get(), first_cb ? &first : NULL, second_cb ? &second : NULL) !=
+      kStatusSuccess) {
+    return;
+  }
+  CropPoints(&first, 0, keep, 2, roi);
+  CropPoints(&second, 0, keep ? keep + 1 : NULL, 2, roi);
+  if (first_cb) {
+    first_cb(handle, data, &first, return_client_data_[handle]);
+  }
+  if (second_cb) {
+    second_cb(handle, data, &second, return_client_data_[handle]);
+  }
 }
 
 void DataHandler::RemoveDevice(uint8_t handle) {
   if (impl_) {
     impl_->RemoveDevice(handle);
   }
+  SetImuChannel(handle, false);
+}
+
+void DataHandlerImpl::WatchBatch(uint8_t handle, IOLoop *loop) {
+  if (handle >= flush_loops_.size()) {
+    return;
+  }
+  boost::lock_guard<boost::mutex> lock(flush_mutex_);
+  if (flush_timers_[handle] != 0) {
+    flush_loops_[handle]->CancelTimer(flush_timers_[handle]);
+    flush_timers_[handle] = 0;
+  }
+  flush_loops_[handle] = loop;
+}
+
+void DataHandlerImpl::ArmBatchTimer(uint8_t handle, apr_time_t deadline) {
+  if (handle >= flush_loops_.size()) {
+    return;
+  }
+  boost::lock_guard<boost::mutex> lock(flush_mutex_);
+  StartBatchTimer(handle, deadline);
+}
+
+void DataHandlerImpl::StartBatchTimer(uint8_t handle, apr_time_t deadline) {
+  IOLoop *loop = flush_loops_[handle];
+  if (loop == NULL || (flush_timers_[handle] != 0 && flush_deadlines_[handle] <= deadline)) {
+    return;
+  }
+  if (flush_timers_[handle] != 0) {
+    loop->CancelTimer(flush_timers_[handle]);
+  }
+  flush_deadlines_[handle] = deadline;
+  // A cancel from another thread may come too late, the sequence number tells a stale timer apart.
+  flush_timers_[handle] = loop->AddTimer(
+      deadline, boost::bind(&DataHandlerImpl::OnBatchTimer, this, handle, ++flush_sequences_[handle], _1));
+}
+
+void DataHandlerImpl::OnBatchTimer(uint8_t handle, uint32_t sequence, apr_time_t now) {
+  {
+    boost::lock_guard<boost::mutex> lock(flush_mutex_);
+    if (flush_timers_[handle] == 0 || flush_sequences_[handle] != sequence) {
+      return;
+    }
+    flush_timers_[handle] = 0;
+  }
+  apr_time_t next = handler_ ? handler_->FlushBatch(handle, now) : 0;
+  if (next != 0) {
+    ArmBatchTimer(handle, next);
+  }
 }
 
 }  // namespace livox
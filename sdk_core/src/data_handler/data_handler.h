@@ -26,22 +26,60 @@
 #define LIVOX_DATA_HANDLER_H_
 
 #include <boost/array.hpp>
+#include <boost/atomic.hpp>
 #include <boost/function.hpp>
 #include <boost/smart_ptr.hpp>
 #include <boost/thread/mutex.hpp>
 #include "apr_pools.h"
 #include "base/io_thread.h"
+#include "base/packet_pool.h"
+#include "data_batcher.h"
+#include "frame_builder.h"
+#include "frame_merger.h"
 #include "device_manager.h"
+#include "imu_buffer.h"
+#include "motion_deskew.h"
+#include "packet_queue.h"
+#include "point_convert.h"
+#include "roi_filter.h"
 
 namespace livox {
 class DataHandlerImpl;
 
+/** Largest data packet, a Livox data packet always fits in one ethernet frame. */
+static const uint32_t kMaxDataPacketSize = 1500;
+
 class DataHandler : public noncopyable {
  public:
   typedef boost::function<void(uint8_t handle, LivoxEthPacket *data, uint32_t data_num, void *client_data)> DataCallback;
+  typedef boost::function<void(uint8_t handle, PacketBuffer *packet, LivoxEthPacket *data, uint32_t data_num,
+                               void *client_data)>
+      LeaseCallback;
+  typedef boost::function<void(uint8_t handle, LivoxEthPacket **packets, uint32_t *data_nums, uint32_t count,
+                               void *client_data)>
+      BatchCallback;
+  typedef boost::function<void(uint8_t handle, LivoxEthPacket *data, const LivoxPointBuffer *points,
+                               void *client_data)>
+      ReturnCallback;
+  typedef boost::function<void(uint8_t handle, const LivoxFrame *frame, void *client_data)> FrameCallback;
+  typedef boost::function<void(const LivoxMergedFrame *frame, void *client_data)> MergedFrameCallback;
+  typedef boost::function<void(uint8_t handle, const LivoxImuSample *sample, void *client_data)> ImuCallback;
 
  public:
-  DataHandler() : mem_pool_(NULL) {}
+  DataHandler()
+      : mem_pool_(NULL),
+        packet_pool_(kMaxDataPacketSize, kPacketPoolSlabCount, kDefaultPacketPoolSize),
+        recv_batch_size_(kDefaultRecvBatchSize),
+        recv_thread_count_(0),
+        imu_thread_priority_(0) {
+    recv_thread_index_.assign(kRecvThreadRoundRobin);
+    recv_thread_cpu_.assign(-1);
+    host_cartesian_.assign(false);
+    imu_channel_.assign(false);
+    for (size_t i = 0; i < filtered_points_.size(); i++) {
+      filtered_points_[i] = 0;
+    }
+  }
 
   bool Init();
   void Uninit();
@@ -50,18 +88,193 @@ class DataHandler : public noncopyable {
   void RemoveDevice(uint8_t handle);
 
   bool AddDataListener(uint8_t handle, const DataCallback &cb, void *client_data);
-  void OnDataCallback(uint8_t handle, void *data, uint16_t size);
+  /** Like AddDataListener, the callback also gets the packet buffer so it can keep a reference past the call. */
+  bool AddLeaseListener(uint8_t handle, const LeaseCallback &cb, void *client_data);
+  /**
+   * Deliver the data of a device in batches of up to max_batch packets, flushed when full or max_delay after the
+   * first packet of the batch arrived. An empty callback removes the batch listener.
+   */
+  bool AddBatchListener(uint8_t handle, const BatchCallback &cb, uint32_t max_batch, apr_interval_time_t max_delay,
+                        void *client_data);
+  /**
+   * Deliver the first and the second returns of the dual return packets of a device as separate point buffers.
+   * Either callback may be empty.
+   */
+  bool AddReturnListener(uint8_t handle, const ReturnCallback &first_cb, const ReturnCallback &second_cb,
+                         void *client_data);
+  /**
+   * Group the points of a device into frames, delivered to cb if not empty and kept for AcquireFrame. A NULL
+   * config removes the frame builder.
+   */
+  bool SetFrameBuilder(uint8_t handle, const LivoxFrameConfig *config, const FrameCallback &cb, void *client_data);
+  bool AcquireFrame(uint8_t handle, LivoxFrame *frame);
+  bool ReleaseFrame(uint8_t handle);
+  /** Downsample the frames of the device frame builder with a voxel grid, NULL to stop. */
+  bool SetVoxelFilter(uint8_t handle, const LivoxVoxelConfig *config);
+  /** Merge the points of the devices in device_mask into frames of a common time grid, replacing any merge. */
+  bool StartFrameMerge(uint32_t device_mask,
+                       const LivoxMergeConfig &config,
+                       const MergedFrameCallback &cb,
+                       void *client_data);
+  /** Deliver the pending merged frames and stop merging. */
+  void StopFrameMerge();
+  void OnDataCallback(uint8_t handle, PacketBuffer *packet);
+  /**
+   * Flush the batch of a device if its deadline has passed.
+   * @return the time to flush again, 0 if no batch is pending.
+   */
+  apr_time_t FlushBatch(uint8_t handle, apr_time_t now);
+  /** Deliver the pending batch of a device right away, once its data stopped coming. */
+  void DrainBatch(uint8_t handle);
+  /** Have the batch timer of a device fire at deadline, called by its batcher starting a batch. */
+  void ScheduleBatchFlush(uint8_t handle, apr_time_t deadline);
+
+  /** Pool of the receive buffers, shared by all the devices. */
+  PacketPool *packet_pool() { return &packet_pool_; }
+  /** Limit the number of receive buffers, packets are discarded while all of them are in use. */
+  bool SetPacketPoolSize(uint32_t buffer_count);
+
+  /**
+   * Set the number of datagrams drained from a data socket per receive call.
+   * Takes effect for devices connected afterwards.
+   */
+  bool SetRecvBatchSize(uint32_t batch_size);
+  uint32_t recv_batch_size() const { return recv_batch_size_; }
+
+  /**
+   * Set the number of receive threads shared by all the LiDAR units, 0 for one thread per LiDAR unit.
+   * Takes effect before the first device is connected.
+   */
+  bool SetRecvThreadCount(uint8_t count);
+  uint8_t recv_thread_count() const { return recv_thread_count_; }
+
+  /** Pin the data of a device to a shared receive thread instead of assigning it round-robin. */
+  bool SetRecvThreadIndex(uint8_t handle, uint8_t thread_index);
+  uint8_t RecvThreadIndex(uint8_t handle) const;
+
+  /** Bind a shared receive thread to a cpu core, -1 to leave it unbound. */
+  bool SetRecvThreadCpu(uint8_t thread_index, int32_t cpu);
+  int32_t recv_thread_cpu(uint8_t thread_index) const { return recv_thread_cpu_[thread_index]; }
+
+  /**
+   * Deliver the data of a device through a queue drained on a dedicated thread, capacity 0 to deliver it on the
+   * receive thread again.
+   */
+  bool SetDataQueue(uint8_t handle, uint32_t capacity, DataQueuePolicy policy);
+  bool GetDataQueueStatus(uint8_t handle, DataQueueStatus *status) const;
+
+  /** Deliver the spherical packets of a device converted to the matching Cartesian format. */
+  bool SetHostCartesian(uint8_t handle, bool enable);
+  bool host_cartesian(uint8_t handle) const { return handle < host_cartesian_.size() && host_cartesian_[handle]; }
+
+  /**
+   * Set the transform applied to the points of a device when they are converted, NULL to remove it. The swap is
+   * atomic, a conversion in progress finishes with the transform it started with.
+   */
+  bool SetPointTransform(uint8_t handle, const PointTransform *transform);
+  boost::shared_ptr<const PointTransform> point_transform(uint8_t handle) const;
+
+  /**
+   * Drop the points rejected by a filter from the point buffers of a device: the return buffers, the frames and the
+   * merged frames. NULL to keep every point.
+   */
+  bool SetPointFilter(uint8_t handle, const LivoxPointFilter *filter);
+  boost::shared_ptr<const LivoxPointFilter> point_filter(uint8_t handle) const;
+  /**
+   * Crop the point buffers of a device to a region of interest, like the point filter. NULL to keep every point.
+   * @return false if the configuration is invalid.
+   */
+  bool SetRoiFilter(uint8_t handle, const LivoxRoiConfig *config);
+  boost::shared_ptr<const RoiFilter> roi_filter(uint8_t handle) const;
+  /** Number of points of a device dropped by its filter. */
+  uint64_t filtered_points(uint8_t handle) const {
+    return handle < filtered_points_.size() ? filtered_points_[handle].load() : 0;
+  }
+
+  /**
+   * Remove the motion distortion of the frames of a device, tracking its motion from its IMU data or from the poses
+   * pushed with PushPose. Disabling it drops the tracked motion.
+   */
+  bool SetMotionDeskew(uint8_t handle, bool enable);
+  bool PushPose(uint8_t handle, const LivoxPose &pose);
+  /** Move the points of a buffer of the device to where they would have been measured at target_time. */
+  livox_status Deskew(uint8_t handle, LivoxPointBuffer *points, uint64_t target_time);
+
+  /**
+   * Deliver the IMU samples of a device as they arrive, on the IMU receive thread for the devices with an IMU
+   * channel and on the receive thread of the point data otherwise. An empty callback removes the listener.
+   */
+  bool AddImuListener(uint8_t handle, const ImuCallback &cb, void *client_data);
+  /** The IMU sample of a device at a time, interpolated from the recent samples. */
+  livox_status GetImuAt(uint8_t handle, uint64_t timestamp, LivoxImuSample *sample) const;
+  /**
+   * Set the real-time priority of the IMU receive thread, 0 for the default scheduling.
+   * Takes effect before the first device is connected.
+   */
+  bool SetImuThreadPriority(int32_t priority);
+  int32_t imu_thread_priority() const { return imu_thread_priority_; }
+  /** Mark a device as sending its IMU data to its own sensor port rather than with its point data. */
+  void SetImuChannel(uint8_t handle, bool enable);
+  /** Handle an IMU packet received on the sensor port of a device, called by the IMU receive thread. */
+  void OnImuData(uint8_t handle, PacketBuffer *packet);
+
+  static const uint8_t kMaxRecvThreadCount = 16;
+  static const uint32_t kMaxDataQueueCapacity = 65536;
+  static const uint32_t kMaxBatchPacketCount = 1024;
 
  private:
+  void DispatchData(uint8_t handle, PacketBuffer *packet);
+  void DispatchReturns(
+      uint8_t handle, LivoxEthPacket *data, uint32_t data_num, const uint8_t *keep, const RoiFilter *roi);
+  void FinishFrame(uint8_t handle, LivoxFrame *frame);
+  void HandleImu(uint8_t handle, const LivoxEthPacket *data, uint32_t data_num);
+
+  static const uint32_t kDefaultRecvBatchSize = 32;
+  static const uint32_t kMaxRecvBatchSize = 1024;
+  static const uint8_t kRecvThreadRoundRobin = 0xFF;
+  static const uint32_t kPacketPoolSlabCount = 256;
+  static const uint32_t kDefaultPacketPoolSize = 8192;
+  static const uint32_t kMinPacketPoolSize = 64;
+  static const int32_t kMaxImuThreadPriority = 99;
   apr_pool_t *mem_pool_;
+  PacketPool packet_pool_;
+  uint32_t recv_batch_size_;
+  uint8_t recv_thread_count_;
+  boost::array<uint8_t, kMaxConnectedDeviceNum> recv_thread_index_;
+  boost::array<int32_t, kMaxRecvThreadCount> recv_thread_cpu_;
+  boost::array<bool, kMaxConnectedDeviceNum> host_cartesian_;
   boost::array<DataCallback, kMaxConnectedDeviceNum> callbacks_;
   boost::array<void *, kMaxConnectedDeviceNum> client_data_;
+  boost::array<LeaseCallback, kMaxConnectedDeviceNum> lease_callbacks_;
+  boost::array<void *, kMaxConnectedDeviceNum> lease_client_data_;
+  boost::array<ReturnCallback, kMaxConnectedDeviceNum> first_return_callbacks_;
+  boost::array<ReturnCallback, kMaxConnectedDeviceNum> second_return_callbacks_;
+  boost::array<void *, kMaxConnectedDeviceNum> return_client_data_;
+  boost::array<boost::shared_ptr<const PointTransform>, kMaxConnectedDeviceNum> transforms_;
+  boost::array<boost::shared_ptr<const LivoxPointFilter>, kMaxConnectedDeviceNum> point_filters_;
+  boost::array<boost::atomic<uint64_t>, kMaxConnectedDeviceNum> filtered_points_;
+  boost::array<boost::shared_ptr<const RoiFilter>, kMaxConnectedDeviceNum> roi_filters_;
+  boost::array<boost::shared_ptr<PacketQueue>, kMaxConnectedDeviceNum> queues_;
+  boost::array<boost::shared_ptr<DataBatcher>, kMaxConnectedDeviceNum> batchers_;
+  boost::array<boost::shared_ptr<FrameBuilder>, kMaxConnectedDeviceNum> frame_builders_;
+  boost::array<boost::shared_ptr<MotionDeskew>, kMaxConnectedDeviceNum> deskews_;
+  int32_t imu_thread_priority_;
+  boost::array<bool, kMaxConnectedDeviceNum> imu_channel_;
+  boost::array<boost::shared_ptr<ImuBuffer>, kMaxConnectedDeviceNum> imu_buffers_;
+  boost::array<ImuCallback, kMaxConnectedDeviceNum> imu_callbacks_;
+  boost::array<void *, kMaxConnectedDeviceNum> imu_client_data_;
+  boost::shared_ptr<FrameMerger> merger_;
   boost::scoped_ptr<DataHandlerImpl> impl_;
 };
 
 class DataHandlerImpl : public IOLoop::IOLoopDelegate {
  public:
-  DataHandlerImpl(DataHandler *handler) : handler_(handler) {}
+  DataHandlerImpl(DataHandler *handler) : handler_(handler) {
+    flush_loops_.fill(NULL);
+    flush_timers_.fill(0);
+    flush_deadlines_.fill(0);
+    flush_sequences_.fill(0);
+  }
   virtual ~DataHandlerImpl() {}
 
   virtual bool Init() = 0;
@@ -69,15 +282,33 @@ class DataHandlerImpl : public IOLoop::IOLoopDelegate {
 
   virtual bool AddDevice(const DeviceInfo &info) = 0;
   virtual void RemoveDevice(uint8_t handle) = 0;
-  void OnDataCallback(uint8_t handle, void *data, uint16_t size) {
+  /** Flush the batch of a device on its watched loop no later than deadline, any thread. */
+  void ArmBatchTimer(uint8_t handle, apr_time_t deadline);
+  void OnDataCallback(uint8_t handle, PacketBuffer *packet) {
     if (handler_) {
-      handler_->OnDataCallback(handle, data, size);
+      handler_->OnDataCallback(handle, packet);
     }
   }
 
  protected:
-  static const size_t kMaxBufferSize = 8192;
+  /**
+   * Flush the expired batch of a device from a timer of loop, the loop receiving the device data, NULL to stop.
+   * The timer only runs while a batch is pending, the loop has to outlive it.
+   */
+  void WatchBatch(uint8_t handle, IOLoop *loop);
+
   DataHandler *handler_;
+
+ private:
+  /** Called with flush_mutex_ held. */
+  void StartBatchTimer(uint8_t handle, apr_time_t deadline);
+  void OnBatchTimer(uint8_t handle, uint32_t sequence, apr_time_t now);
+
+  boost::mutex flush_mutex_;
+  boost::array<IOLoop *, kMaxConnectedDeviceNum> flush_loops_;
+  boost::array<IOLoop::TimerId, kMaxConnectedDeviceNum> flush_timers_;
+  boost::array<apr_time_t, kMaxConnectedDeviceNum> flush_deadlines_;
+  boost::array<uint32_t, kMaxConnectedDeviceNum> flush_sequences_;
 };
 
 DataHandler &data_handler();
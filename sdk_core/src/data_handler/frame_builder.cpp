@@ -0,0 +1,192 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "frame_builder.h"
+#include <boost/thread/lock_guard.hpp>
+#include <algorithm>
+
+namespace livox {
+
+const uint32_t FrameBuilder::kMinFramePoints;
+
+FrameBuilder::FrameBuilder(const LivoxFrameConfig &config, const Consumer &consumer, const Finisher &finisher)
+    : config_(config),
+      duration_(static_cast<uint64_t>(config.duration) * 1000),
+      consumer_(consumer),
+      finisher_(finisher),
+      filling_(&buffers_[0]),
+      complete_(&buffers_[1]),
+      subframe_begin_(0),
+      frame_index_(0),
+      dropped_(0),
+      complete_ready_(false),
+      complete_held_(false) {
+  config_.max_points = std::max(config_.max_points, kMinFramePoints);
+  InitBuffer(&buffers_[0]);
+  InitBuffer(&buffers_[1]);
+}
+
+void FrameBuilder::InitBuffer(Buffer *buffer) {
+  buffer->x.resize(config_.max_points);
+  buffer->y.resize(config_.max_points);
+  buffer->z.resize(config_.max_points);
+  buffer->reflectivity.resize(config_.max_points);
+  buffer->tag.resize(config_.max_points);
+  buffer->timestamp.resize(config_.max_points);
+  LivoxPointBuffer points = {&buffer->x[0],
+                             &buffer->y[0],
+                             &buffer->z[0],
+                             &buffer->reflectivity[0],
+                             &buffer->tag[0],
+                             &buffer->timestamp[0],
+                             config_.max_points,
+                             0};
+  buffer->frame.points = points;
+  buffer->frame.start_time = 0;
+  buffer->frame.end_time = 0;
+  buffer->frame.frame_index = 0;
+  buffer->frame.is_subframe = 0;
+}
+
+void FrameBuilder::Add(const LivoxEthPacket *packet,
+                       uint32_t data_num,
+                       const PointTransform *transform,
+                       const uint8_t *keep,
+                       const RoiFilter *roi) {
+  LivoxPacketTimeBase time;
+  if (data_num == 0 || GetPacketTimeBase(packet, &time) != kStatusSuccess) {
+    return;
+  }
+  LivoxFrame &frame = filling_->frame;
+  if (frame.points.size > 0) {
+    // Close on the frame duration, or when the LiDAR time goes backwards after a sync change.
+    bool expired = duration_ > 0 && time.timestamp >= frame.start_time + duration_;
+    bool full = data_num * time.points_per_interval > frame.points.capacity - frame.points.size;
+    if (expired || full || time.timestamp < frame.start_time) {
+      Complete();
+    }
+  }
+
+  LivoxFrame &current = filling_->frame;
+  uint32_t size = current.points.size;
+  if (ConvertPacket(packet, data_num, transform, &current.points) != kStatusSuccess) {
+    return;
+  }
+  CropPoints(&current.points, size, keep, 1, roi);
+  if (current.points.size == size) {
+    return;
+  }
+  if (size == 0) {
+    current.start_time = current.points.timestamp[0];
+    current.frame_index = frame_index_;
+    voxel_filter_ = boost::atomic_load(&next_voxel_filter_);
+  }
+  current.end_time = current.points.timestamp[current.points.size - 1];
+  if (voxel_filter_) {
+    voxel_filter_->Add(&current.points, size);
+  }
+  if (config_.subframe_points > 0 && current.points.size - subframe_begin_ >= config_.subframe_points) {
+    EmitSubframe();
+  }
+}
+
+void FrameBuilder::EmitSubframe() {
+  const LivoxFrame &frame = filling_->frame;
+  uint32_t begin = subframe_begin_;
+  uint32_t count = frame.points.size - begin;
+  subframe_begin_ = frame.points.size;
+  if (count == 0 || !consumer_) {
+    return;
+  }
+  LivoxFrame subframe;
+  LivoxPointBuffer points = {frame.points.x + begin,
+                             frame.points.y + begin,
+                             frame.points.z + begin,
+                             frame.points.reflectivity + begin,
+                             frame.points.tag + begin,
+                             frame.points.timestamp + begin,
+                             count,
+                             count};
+  subframe.points = points;
+  subframe.start_time = points.timestamp[0];
+  subframe.end_time = frame.end_time;
+  subframe.frame_index = frame.frame_index;
+  subframe.is_subframe = 1;
+  consumer_(&subframe);
+}
+
+void FrameBuilder::Complete() {
+  if (config_.subframe_points > 0) {
+    EmitSubframe();
+  }
+  subframe_begin_ = 0;
+  frame_index_++;
+  if (voxel_filter_) {
+    voxel_filter_->Finish(&filling_->frame.points);
+  }
+  if (finisher_) {
+    finisher_(&filling_->frame);
+  }
+  {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    if (complete_held_) {
+      // The consumer still reads the other buffer, drop this frame and refill the same buffer.
+      dropped_++;
+      filling_->frame.points.size = 0;
+      return;
+    }
+    std::swap(filling_, complete_);
+    complete_ready_ = true;
+  }
+  filling_->frame.points.size = 0;
+  if (consumer_) {
+    consumer_(&complete_->frame);
+  }
+}
+
+void FrameBuilder::SetVoxelFilter(const LivoxVoxelConfig *config) {
+  boost::shared_ptr<VoxelFilter> filter;
+  if (config) {
+    filter.reset(new VoxelFilter(*config, config_.max_points));
+  }
+  boost::atomic_store(&next_voxel_filter_, filter);
+}
+
+bool FrameBuilder::Acquire(LivoxFrame *frame) {
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  if (!complete_ready_ || complete_held_) {
+    return false;
+  }
+  complete_ready_ = false;
+  complete_held_ = true;
+  *frame = complete_->frame;
+  return true;
+}
+
+void FrameBuilder::Release() {
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  complete_held_ = false;
+}
+
+}  // namespace livox
@@ -0,0 +1,114 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_FRAME_BUILDER_H_
+#define LIVOX_FRAME_BUILDER_H_
+
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include "base/noncopyable.h"
+#include "livox_def.h"
+#include "point_convert.h"
+#include "roi_filter.h"
+#include "voxel_filter.h"
+
+namespace livox {
+
+/**
+ * Groups the packets of a device into frames by LiDAR time or point count.
+ * The points are converted straight into one of two frame buffers allocated
+ * up front: one is filled while the other holds the last complete frame, so
+ * no memory is allocated per frame. A complete frame stays valid until the
+ * next one completes, or until it is released when it was acquired.
+ */
+class FrameBuilder : public noncopyable {
+ public:
+  typedef boost::function<void(const LivoxFrame *frame)> Consumer;
+  /** Called on each frame once it is full, before it is delivered, to correct its points in place. */
+  typedef boost::function<void(LivoxFrame *frame)> Finisher;
+
+  FrameBuilder(const LivoxFrameConfig &config, const Consumer &consumer, const Finisher &finisher = Finisher());
+
+  /**
+   * Append the points of a packet, called on the thread dispatching the device data.
+   * @param keep flags of the points to keep from FilterPacketPoints, NULL to keep every point.
+   * @param roi region of interest the points are cropped to, NULL for none.
+   */
+  void Add(const LivoxEthPacket *packet,
+           uint32_t data_num,
+           const PointTransform *transform,
+           const uint8_t *keep,
+           const RoiFilter *roi);
+
+  /**
+   * Take the last complete frame if it was not taken yet, it is not overwritten until Release. Frames completed
+   * in the meantime are dropped.
+   */
+  bool Acquire(LivoxFrame *frame);
+  void Release();
+
+  /** Downsample the frames with a voxel grid from the next frame on, NULL to stop. */
+  void SetVoxelFilter(const LivoxVoxelConfig *config);
+
+  uint32_t dropped() const { return dropped_; }
+
+  static const uint32_t kMinFramePoints = 100;
+
+ private:
+  struct Buffer {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<uint8_t> reflectivity;
+    std::vector<uint8_t> tag;
+    std::vector<uint64_t> timestamp;
+    LivoxFrame frame;
+  };
+
+  void InitBuffer(Buffer *buffer);
+  void Complete();
+  void EmitSubframe();
+
+  LivoxFrameConfig config_;
+  uint64_t duration_;
+  Consumer consumer_;
+  Finisher finisher_;
+  Buffer buffers_[2];
+  Buffer *filling_;
+  Buffer *complete_;
+  uint32_t subframe_begin_;
+  uint32_t frame_index_;
+  uint32_t dropped_;
+  bool complete_ready_;
+  bool complete_held_;
+  boost::shared_ptr<VoxelFilter> voxel_filter_;
+  boost::shared_ptr<VoxelFilter> next_voxel_filter_;
+  boost::mutex mutex_;
+};
+
+}  // namespace livox
+
+#endif  // LIVOX_FRAME_BUILDER_H_
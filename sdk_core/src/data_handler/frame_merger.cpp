@@ -0,0 +1,239 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "frame_merger.h"
+#include <string.h>
+#include <boost/thread/lock_guard.hpp>
+#include <algorithm>
+
+namespace livox {
+
+const uint32_t FrameMerger::kMinFramePoints;
+
+namespace {
+
+const uint64_t kNoFrame = ~0ULL;
+
+}  // namespace
+
+FrameMerger::FrameMerger(const LivoxMergeConfig &config, uint32_t device_mask, const Consumer &consumer)
+    : config_(config),
+      period_(std::max<uint64_t>(config.period, 1) * 1000),
+      max_latency_(static_cast<uint64_t>(config.max_latency) * 1000),
+      device_mask_(device_mask),
+      consumer_(consumer),
+      started_(false),
+      open_begin_(0),
+      emit_begin_(0),
+      newest_time_(0),
+      late_points_(0) {
+  config_.max_points = std::max(config_.max_points, kMinFramePoints);
+  // Enough frames to hold max_latency of data, plus the frame being delivered.
+  uint64_t frame_count = std::min<uint64_t>(max_latency_ / period_ + 2, kMaxFrameCount);
+  frames_.resize(frame_count);
+  for (size_t i = 0; i < frames_.size(); i++) {
+    InitFrame(&frames_[i]);
+  }
+  memset(watermarks_, 0, sizeof(watermarks_));
+}
+
+void FrameMerger::InitFrame(Frame *frame) {
+  uint32_t capacity = config_.max_points;
+  frame->index = kNoFrame;
+  frame->reserved = 0;
+  frame->committed = 0;
+  frame->x.resize(capacity);
+  frame->y.resize(capacity);
+  frame->z.resize(capacity);
+  frame->reflectivity.resize(capacity);
+  frame->tag.resize(capacity);
+  frame->timestamp.resize(capacity);
+  frame->handles.resize(capacity);
+  LivoxPointBuffer points = {
+      &frame->x[0], &frame->y[0], &frame->z[0], &frame->reflectivity[0], &frame->tag[0], &frame->timestamp[0],
+      capacity, 0};
+  memset(&frame->merged, 0, sizeof(frame->merged));
+  frame->merged.points = points;
+  frame->merged.handles = &frame->handles[0];
+}
+
+void FrameMerger::Add(uint8_t handle,
+                      const LivoxEthPacket *packet,
+                      uint32_t data_num,
+                      const PointTransform *transform,
+                      const uint8_t *keep,
+                      const RoiFilter *roi) {
+  LivoxPacketTimeBase time;
+  if (!Contains(handle) || data_num == 0 || packet->data_type == kImu ||
+      GetPacketTimeBase(packet, &time) != kStatusSuccess) {
+    return;
+  }
+  uint32_t count = data_num * time.points_per_interval;
+  // Filtered points are converted and cropped on the stack first, the frame only has room for the kept points.
+  float xyz[3][kMaxPacketPoints];
+  uint8_t reflectivity[kMaxPacketPoints];
+  uint8_t tag[kMaxPacketPoints];
+  uint64_t timestamp[kMaxPacketPoints];
+  LivoxPointBuffer scratch = {xyz[0], xyz[1], xyz[2], reflectivity, tag, timestamp, kMaxPacketPoints, 0};
+  bool cropped = keep != NULL || (roi != NULL && roi->has_shapes());
+  if (cropped) {
+    if (ConvertPacket(packet, data_num, transform, &scratch) != kStatusSuccess) {
+      return;
+    }
+    CropPoints(&scratch, 0, keep, 1, roi);
+    count = scratch.size;
+  }
+  uint64_t last_time = time.timestamp + static_cast<uint64_t>(data_num - 1) * time.interval;
+  uint64_t index = time.timestamp / period_;
+
+  Frame *frame = NULL;
+  uint32_t offset = 0;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    if (!started_) {
+      // Leave room in the ring for the devices behind the first one.
+      uint64_t history = frames_.size() - 1;
+      open_begin_ = emit_begin_ = index > history ? index - history : 0;
+      started_ = true;
+    }
+    watermarks_[handle] = std::max(watermarks_[handle], last_time);
+    newest_time_ = std::max(newest_time_, last_time);
+    CloseExpiredLocked();
+
+    if (index < open_begin_ || index >= emit_begin_ + frames_.size()) {
+      // The frame is closed, or the ring is still busy delivering older frames.
+      late_points_ += count;
+    } else if (count > 0) {
+      Frame &f = FrameAt(index);
+      if (f.index != index) {
+        f.index = index;
+        f.reserved = 0;
+        f.committed = 0;
+        f.merged.device_mask = 0;
+        f.merged.dropped_points = 0;
+      }
+      if (count > config_.max_points - f.reserved) {
+        f.merged.dropped_points += count;
+      } else {
+        offset = f.reserved;
+        f.reserved += count;
+        f.merged.device_mask |= 1u << handle;
+        frame = &f;
+      }
+    }
+  }
+
+  if (frame) {
+    // Decode outside the lock, every device writes its own reserved range.
+    const LivoxPointBuffer &points = frame->merged.points;
+    LivoxPointBuffer range = {points.x + offset,
+                              points.y + offset,
+                              points.z + offset,
+                              points.reflectivity + offset,
+                              points.tag + offset,
+                              points.timestamp + offset,
+                              count,
+                              0};
+    if (cropped) {
+      memcpy(range.x, scratch.x, count * sizeof(float));
+      memcpy(range.y, scratch.y, count * sizeof(float));
+      memcpy(range.z, scratch.z, count * sizeof(float));
+      memcpy(range.reflectivity, scratch.reflectivity, count);
+      memcpy(range.tag, scratch.tag, count);
+      memcpy(range.timestamp, scratch.timestamp, count * sizeof(uint64_t));
+    } else {
+      ConvertPacket(packet, data_num, transform, &range);
+    }
+    memset(frame->merged.handles + offset, handle, count);
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    frame->committed += count;
+  }
+  EmitClosed();
+}
+
+void FrameMerger::CloseExpiredLocked() {
+  // Frame i ends at (i + 1) * period_, it is closed once that end is at or before a bound.
+  uint64_t min_watermark = ~0ULL;
+  for (uint8_t i = 0; i < 32; i++) {
+    if (Contains(i)) {
+      min_watermark = std::min(min_watermark, watermarks_[i]);
+    }
+  }
+  uint64_t close_end = min_watermark / period_;
+  if (newest_time_ > max_latency_) {
+    close_end = std::max(close_end, (newest_time_ - max_latency_) / period_);
+  }
+  open_begin_ = std::max(open_begin_, close_end);
+}
+
+void FrameMerger::EmitClosed() {
+  boost::lock_guard<boost::mutex> emit_lock(emit_mutex_);
+  for (;;) {
+    Frame *frame = NULL;
+    {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      if (emit_begin_ >= open_begin_) {
+        return;
+      }
+      Frame &f = FrameAt(emit_begin_);
+      if (f.index != emit_begin_) {
+        // No data in this period, skip to the next frame holding data.
+        uint64_t next = open_begin_;
+        for (size_t i = 0; i < frames_.size(); i++) {
+          if (frames_[i].index != kNoFrame && frames_[i].index >= emit_begin_) {
+            next = std::min(next, frames_[i].index);
+          }
+        }
+        emit_begin_ = next;
+        continue;
+      }
+      if (f.committed != f.reserved) {
+        // A device is still decoding into the frame, it delivers the frame when done.
+        return;
+      }
+      frame = &f;
+    }
+
+    frame->merged.points.size = frame->reserved;
+    frame->merged.start_time = frame->index * period_;
+    frame->merged.end_time = frame->merged.start_time + period_;
+    if (consumer_ && frame->reserved > 0) {
+      consumer_(&frame->merged);
+    }
+
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    frame->index = kNoFrame;
+    emit_begin_++;
+  }
+}
+
+void FrameMerger::Flush() {
+  {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    open_begin_ = kNoFrame;
+  }
+  EmitClosed();
+}
+
+}  // namespace livox
@@ -0,0 +1,115 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_FRAME_MERGER_H_
+#define LIVOX_FRAME_MERGER_H_
+
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include "base/noncopyable.h"
+#include "livox_def.h"
+#include "point_convert.h"
+#include "roi_filter.h"
+
+namespace livox {
+
+/**
+ * Merges the points of several devices into frames of a common time grid.
+ * A packet goes to the grid period of its first point. Each device converts
+ * its packets on its own dispatch thread straight into a range of the frame
+ * it reserved under the lock, so devices decode in parallel. A fixed ring of
+ * frames, allocated up front, bounds the memory and the jitter buffer: a
+ * frame is closed once every device has sent data past its end, or at the
+ * latest max_latency after its end in the time of the newest device. Packets
+ * of closed frames are dropped as late.
+ */
+class FrameMerger : public noncopyable {
+ public:
+  typedef boost::function<void(const LivoxMergedFrame *frame)> Consumer;
+
+  FrameMerger(const LivoxMergeConfig &config, uint32_t device_mask, const Consumer &consumer);
+
+  bool Contains(uint8_t handle) const { return handle < 32 && ((device_mask_ >> handle) & 1) != 0; }
+
+  /**
+   * Add the points of a packet, called on the thread dispatching the data of the device.
+   * @param keep flags of the points to keep from FilterPacketPoints, NULL to keep every point.
+   * @param roi region of interest the points are cropped to, NULL for none.
+   */
+  void Add(uint8_t handle,
+           const LivoxEthPacket *packet,
+           uint32_t data_num,
+           const PointTransform *transform,
+           const uint8_t *keep,
+           const RoiFilter *roi);
+
+  /** Close and deliver every frame, packets added afterwards are dropped. */
+  void Flush();
+
+  uint64_t late_points() const { return late_points_; }
+
+  static const uint32_t kMinFramePoints = 100;
+  static const uint32_t kMaxFrameCount = 64;
+
+ private:
+  struct Frame {
+    uint64_t index;
+    uint32_t reserved;
+    uint32_t committed;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<uint8_t> reflectivity;
+    std::vector<uint8_t> tag;
+    std::vector<uint64_t> timestamp;
+    std::vector<uint8_t> handles;
+    LivoxMergedFrame merged;
+  };
+
+  void InitFrame(Frame *frame);
+  void CloseExpiredLocked();
+  void EmitClosed();
+  Frame &FrameAt(uint64_t index) { return frames_[index % frames_.size()]; }
+
+  LivoxMergeConfig config_;
+  uint64_t period_;
+  uint64_t max_latency_;
+  uint32_t device_mask_;
+  Consumer consumer_;
+  std::vector<Frame> frames_;
+  bool started_;
+  /** Frames before open_begin_ are closed, frames before emit_begin_ are delivered. */
+  uint64_t open_begin_;
+  uint64_t emit_begin_;
+  uint64_t newest_time_;
+  uint64_t watermarks_[32];
+  uint64_t late_points_;
+  boost::mutex mutex_;
+  boost::mutex emit_mutex_;
+};
+
+}  // namespace livox
+
+#endif  // LIVOX_FRAME_MERGER_H_
@@ -24,18 +24,26 @@
 
 #include "hub_data_handler.h"
 #include <base/logging.h>
+#include "base/instrumentation.h"
 #include "base/network_util.h"
 
 namespace livox {
 
 bool HubDataHandlerImpl::Init() {
-  if (thread_->Init(false, false)) {
-    return thread_->Start();
+  if (thread_->Init() && thread_->Start()) {
+    // Every device behind the hub is received on the same thread.
+    for (uint8_t i = 0; i < kMaxConnectedDeviceNum; i++) {
+      WatchBatch(i, thread_->loop());
+    }
+    return true;
   }
   return false;
 }
 
 void HubDataHandlerImpl::Uninit() {
+  for (uint8_t i = 0; i < kMaxConnectedDeviceNum; i++) {
+    WatchBatch(i, NULL);
+  }
   if (thread_) {
     thread_->Quit();
     thread_->Join();
@@ -58,6 +66,12 @@ bool HubDataHandlerImpl::AddDevice(const DeviceInfo &info) {
   is_valid_ = true;
   hub_info_ = info;
 
+  receiver_.reset(new BatchReceiver);
+  if (!receiver_->Init(handler_->recv_batch_size(), handler_->packet_pool())) {
+    is_valid_ = false;
+    return false;
+  }
+
   sock_ = util::CreateBindSocket(info.data_port, mem_pool_);
   if (sock_ == NULL) {
     is_valid_ = false;
@@ -69,16 +83,19 @@ bool HubDataHandlerImpl::AddDevice(const DeviceInfo &info) {
 }
 
 void HubDataHandlerImpl::OnData(apr_socket_t *, void *) {
-  apr_sockaddr_t addr;
-  if (buf_.size() < kMaxBufferSize) {
-    buf_.resize(kMaxBufferSize);
+  if (receiver_ == NULL) {
+    return;
   }
-  apr_size_t size = kMaxBufferSize;
-  apr_socket_recvfrom(&addr, sock_, 0, &buf_[0], &size);
 
-  if (handler_) {
-    handler_->OnDataCallback(hub_info_.handle, &buf_[0], size);
-  }
+  ScopedLatency latency(instrumentation().data_delegate());
+  // Drain the socket, the loop may be edge-triggered.
+  uint32_t count = 0;
+  do {
+    count = receiver_->Receive(sock_);
+    for (uint32_t i = 0; i < count && handler_; i++) {
+      handler_->OnDataCallback(hub_info_.handle, receiver_->packet(i));
+    }
+  } while (!receiver_->drained());
 }
 
 void HubDataHandlerImpl::RemoveDevice(uint8_t handle) {
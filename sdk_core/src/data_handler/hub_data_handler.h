@@ -26,6 +26,7 @@
 #define LIVOX_HUB_DATA_HANDLER_H_
 
 #include <boost/smart_ptr.hpp>
+#include "base/batch_receiver.h"
 #include "base/io_thread.h"
 #include "data_handler.h"
 
@@ -49,7 +50,7 @@ class HubDataHandlerImpl : public DataHandlerImpl {
   apr_socket_t *sock_;
   DeviceInfo hub_info_;
   bool is_valid_;
-  std::vector<char> buf_;
+  boost::scoped_ptr<BatchReceiver> receiver_;
 };
 
 }  // namespace livox
@@ -0,0 +1,149 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "imu_buffer.h"
+#include <string.h>
+
+namespace livox {
+
+const uint32_t ImuBuffer::kDefaultCapacity;
+
+namespace {
+
+/** Time before the newest sample a sample must go back to reset the buffer, after a sync change. */
+const uint64_t kTimeResetThreshold = 1000000000;
+
+inline float Lerp(float a, float b, float alpha) {
+  return a + alpha * (b - a);
+}
+
+}  // namespace
+
+ImuBuffer::ImuBuffer(uint32_t capacity) : mask_(0), count_(0), last_timestamp_(0) {
+  uint32_t size = 2;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  mask_ = size - 1;
+  slots_.reset(new Slot[size]);
+  for (uint32_t i = 0; i < size; i++) {
+    slots_[i].sequence.store(0, boost::memory_order_relaxed);
+    slots_[i].timestamp.store(0, boost::memory_order_relaxed);
+    for (uint32_t w = 0; w < kWords; w++) {
+      slots_[i].words[w].store(0, boost::memory_order_relaxed);
+    }
+  }
+}
+
+void ImuBuffer::Push(uint64_t timestamp, const LivoxImuPoint &imu) {
+  uint64_t count = count_.load(boost::memory_order_relaxed);
+  if (count > 0 && timestamp <= last_timestamp_) {
+    if (last_timestamp_ - timestamp < kTimeResetThreshold) {
+      return;
+    }
+    count = 0;
+  }
+  uint32_t words[kWords];
+  memcpy(words, &imu, sizeof(words));
+
+  Slot &slot = slots_[count & mask_];
+  uint32_t sequence = slot.sequence.load(boost::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, boost::memory_order_relaxed);
+  boost::atomic_thread_fence(boost::memory_order_release);
+  slot.timestamp.store(timestamp, boost::memory_order_relaxed);
+  for (uint32_t w = 0; w < kWords; w++) {
+    slot.words[w].store(words[w], boost::memory_order_relaxed);
+  }
+  slot.sequence.store(sequence + 2, boost::memory_order_release);
+  count_.store(count + 1, boost::memory_order_release);
+  last_timestamp_ = timestamp;
+}
+
+bool ImuBuffer::Read(uint64_t position, LivoxImuSample *sample) const {
+  const Slot &slot = slots_[position & mask_];
+  uint32_t before = slot.sequence.load(boost::memory_order_acquire);
+  if (before & 1) {
+    return false;
+  }
+  uint32_t words[kWords];
+  sample->timestamp = slot.timestamp.load(boost::memory_order_relaxed);
+  for (uint32_t w = 0; w < kWords; w++) {
+    words[w] = slot.words[w].load(boost::memory_order_relaxed);
+  }
+  boost::atomic_thread_fence(boost::memory_order_acquire);
+  if (slot.sequence.load(boost::memory_order_relaxed) != before) {
+    return false;
+  }
+  memcpy(&sample->imu, words, sizeof(words));
+  return true;
+}
+
+livox_status ImuBuffer::At(uint64_t timestamp, LivoxImuSample *sample) const {
+  if (sample == NULL) {
+    return kStatusFailure;
+  }
+  for (;;) {
+    uint64_t count = count_.load(boost::memory_order_acquire);
+    if (count == 0) {
+      return kStatusFailure;
+    }
+    // Keep one slot of margin, the writer may be filling the slot after the newest one.
+    uint64_t oldest = count > mask_ ? count - mask_ : 0;
+    LivoxImuSample after;
+    if (!Read(count - 1, &after)) {
+      continue;
+    }
+    if (timestamp >= after.timestamp) {
+      *sample = after;
+      sample->timestamp = timestamp;
+      return kStatusSuccess;
+    }
+    bool torn = false;
+    for (uint64_t position = count - 1; position > oldest; position--) {
+      LivoxImuSample before;
+      if (!Read(position - 1, &before) || before.timestamp >= after.timestamp) {
+        // Overwritten by the writer wrapping around, or by a reset.
+        torn = true;
+        break;
+      }
+      if (before.timestamp <= timestamp) {
+        float alpha = static_cast<float>(timestamp - before.timestamp) / (after.timestamp - before.timestamp);
+        sample->imu.gyro_x = Lerp(before.imu.gyro_x, after.imu.gyro_x, alpha);
+        sample->imu.gyro_y = Lerp(before.imu.gyro_y, after.imu.gyro_y, alpha);
+        sample->imu.gyro_z = Lerp(before.imu.gyro_z, after.imu.gyro_z, alpha);
+        sample->imu.acc_x = Lerp(before.imu.acc_x, after.imu.acc_x, alpha);
+        sample->imu.acc_y = Lerp(before.imu.acc_y, after.imu.acc_y, alpha);
+        sample->imu.acc_z = Lerp(before.imu.acc_z, after.imu.acc_z, alpha);
+        sample->timestamp = timestamp;
+        return kStatusSuccess;
+      }
+      after = before;
+    }
+    if (!torn) {
+      return kStatusFailure;
+    }
+  }
+}
+
+}  // namespace livox
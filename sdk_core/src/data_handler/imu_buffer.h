@@ -0,0 +1,78 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_IMU_BUFFER_H_
+#define LIVOX_IMU_BUFFER_H_
+
+#include <boost/atomic.hpp>
+#include <boost/smart_ptr/scoped_array.hpp>
+#include "base/noncopyable.h"
+#include "livox_def.h"
+
+namespace livox {
+
+/**
+ * Recent IMU samples of a device, written by the IMU receive thread and read
+ * from any thread without locks. The ring overwrites its oldest sample; every
+ * slot is guarded by a sequence number that is odd while the slot is written,
+ * so a reader retries instead of returning a torn sample.
+ */
+class ImuBuffer : public noncopyable {
+ public:
+  /** @param capacity number of samples kept, rounded up to a power of two. */
+  explicit ImuBuffer(uint32_t capacity);
+
+  /** Append a sample, called by one writer thread. Samples older than the newest one are dropped. */
+  void Push(uint64_t timestamp, const LivoxImuPoint &imu);
+
+  /**
+   * The sample at a time, interpolated between the two samples around it. A time after the newest sample gets the
+   * newest sample.
+   * @return kStatusSuccess, kStatusFailure if there is no sample yet or the time is older than every kept sample.
+   */
+  livox_status At(uint64_t timestamp, LivoxImuSample *sample) const;
+
+  static const uint32_t kDefaultCapacity = 1024;
+
+ private:
+  static const uint32_t kWords = sizeof(LivoxImuPoint) / sizeof(uint32_t);
+
+  struct Slot {
+    boost::atomic<uint32_t> sequence;
+    boost::atomic<uint64_t> timestamp;
+    boost::atomic<uint32_t> words[kWords];
+  };
+
+  /** Copy a slot, false if it was being written. */
+  bool Read(uint64_t position, LivoxImuSample *sample) const;
+
+  boost::scoped_array<Slot> slots_;
+  uint32_t mask_;
+  boost::atomic<uint64_t> count_;
+  uint64_t last_timestamp_;
+};
+
+}  // namespace livox
+
+#endif  // LIVOX_IMU_BUFFER_H_
@@ -23,101 +23,222 @@
 //
 
 #include "lidar_data_handler.h"
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/future.hpp>
 #include <boost/thread/lock_guard.hpp>
 #include <boost/thread/locks.hpp>
+#include "base/instrumentation.h"
 #include "base/network_util.h"
 
 using boost::lock_guard;
 using boost::mutex;
 using boost::shared_ptr;
 using std::list;
+using std::vector;
 
 namespace livox {
 
 bool LidarDataHandlerImpl::Init() {
+  for (uint8_t i = 0; i < handler_->recv_thread_count(); i++) {
+    shared_ptr<IOThread> thread = boost::make_shared<IOThread>();
+    thread->SetCpuAffinity(handler_->recv_thread_cpu(i));
+    if (!thread->Init() || !thread->Start()) {
+      thread->Uninit();
+      return false;
+    }
+    threads_.push_back(thread);
+  }
+
+  imu_thread_ = boost::make_shared<IOThread>();
+  imu_thread_->SetPriority(handler_->imu_thread_priority());
+  if (!imu_thread_->Init() || !imu_thread_->Start()) {
+    imu_thread_->Uninit();
+    imu_thread_.reset();
+    return false;
+  }
   return true;
 }
 
 void LidarDataHandlerImpl::Uninit() {
-  for (list<DeviceItem>::iterator ite = devices_.begin(); ite != devices_.end(); ++ite) {
-    DeviceItem &item = *ite;
-    if (item.thread) {
-      if (item.thread->loop()) {
-        item.thread->loop()->RemoveDelegate(item.sock, this);
-      }
+  for (list<DeviceItemPtr>::iterator ite = devices_.begin(); ite != devices_.end(); ++ite) {
+    WatchBatch((*ite)->handle, NULL);
+  }
+  if (imu_thread_) {
+    imu_thread_->Quit();
+    imu_thread_->Join();
+    imu_thread_->Uninit();
+    imu_thread_.reset();
+  }
+
+  for (list<DeviceItemPtr>::iterator ite = devices_.begin(); ite != devices_.end(); ++ite) {
+    DeviceItem &item = **ite;
+    if (item.thread && item.thread->loop()) {
+      item.thread->loop()->RemoveDelegate(item.sock, this);
+    }
+    if (item.thread && threads_.empty()) {
       item.thread->Quit();
       item.thread->Join();
       item.thread->Uninit();
     }
+  }
 
-    if (item.sock) {
-      apr_socket_close(item.sock);
-    }
+  for (vector<shared_ptr<IOThread> >::iterator ite = threads_.begin(); ite != threads_.end(); ++ite) {
+    (*ite)->Quit();
+    (*ite)->Join();
+    (*ite)->Uninit();
   }
+  threads_.clear();
 
+  for (list<DeviceItemPtr>::iterator ite = devices_.begin(); ite != devices_.end(); ++ite) {
+    if ((*ite)->sock) {
+      apr_socket_close((*ite)->sock);
+    }
+    if ((*ite)->imu_sock) {
+      apr_socket_close((*ite)->imu_sock);
+    }
+  }
   devices_.clear();
 }
 
 bool LidarDataHandlerImpl::AddDevice(const DeviceInfo &info) {
-  apr_socket_t *sock = util::CreateBindSocket(info.data_port, mem_pool_);
-  if (sock == NULL) {
+  DeviceItemPtr item = boost::make_shared<DeviceItem>();
+  item->handle = info.handle;
+  item->sock = NULL;
+  item->imu_sock = NULL;
+  if (!item->receiver.Init(handler_->recv_batch_size(), handler_->packet_pool())) {
     return false;
   }
 
-  shared_ptr<IOThread> thread = boost::make_shared<IOThread>();
-  thread->Init(false, false);
-  thread->loop()->AddDelegate(sock, this, reinterpret_cast<void *>(info.handle));
+  item->sock = util::CreateBindSocket(info.data_port, mem_pool_);
+  if (item->sock == NULL) {
+    return false;
+  }
+
+  if (info.sensor_port != 0 && info.sensor_port != info.data_port) {
+    // IMU packets come one at a time, a small batch is enough to drain them.
+    if (!item->imu_receiver.Init(kImuBatchSize, handler_->packet_pool())) {
+      apr_socket_close(item->sock);
+      return false;
+    }
+    item->imu_sock = util::CreateBindSocket(info.sensor_port, mem_pool_);
+    if (item->imu_sock == NULL) {
+      apr_socket_close(item->sock);
+      return false;
+    }
+  }
+
+  if (threads_.empty()) {
+    item->thread = boost::make_shared<IOThread>();
+    item->thread->Init();
+  } else {
+    item->thread = threads_[handler_->RecvThreadIndex(info.handle) % threads_.size()];
+  }
+  item->thread->loop()->AddDelegate(item->sock, this, item.get());
+  // The batch timer of the device runs on its receive thread, never on the IMU thread.
+  WatchBatch(info.handle, item->thread->loop());
+  if (item->imu_sock) {
+    imu_thread_->loop()->AddDelegate(item->imu_sock, this, item.get());
+    handler_->SetImuChannel(info.handle, true);
+  }
   {
     lock_guard<mutex> lock(mutex_);
-    DeviceItem item = {sock, thread, info.handle};
     devices_.push_back(item);
   }
-  return thread->Start();
+  return threads_.empty() ? item->thread->Start() : true;
 }
 
 void LidarDataHandlerImpl::RemoveDevice(uint8_t handle) {
-  DeviceItem item;
-  bool found = false;
+  DeviceItemPtr item;
   {
     lock_guard<mutex> lock(mutex_);
-    for (list<DeviceItem>::iterator ite = devices_.begin(); ite != devices_.end(); ++ite) {
-      if (ite->handle == handle) {
+    for (list<DeviceItemPtr>::iterator ite = devices_.begin(); ite != devices_.end(); ++ite) {
+      if ((*ite)->handle == handle) {
         item = *ite;
-        found = true;
         devices_.erase(ite);
         break;
       }
     }
   }
 
-  if (found) {
-    item.thread->loop()->RemoveDelegate(item.sock, this);
-    item.thread->Quit();
-    item.thread->Join();
-    item.thread->Uninit();
-    if (item.sock) {
-      apr_socket_close(item.sock);
+  if (item == NULL) {
+    return;
+  }
+  WatchBatch(handle, NULL);
+
+  if (item->imu_sock) {
+    // The IMU thread posts to the data thread of the device, it has to let go of the device first.
+    shared_ptr<boost::promise<void> > removed = boost::make_shared<boost::promise<void> >();
+    boost::unique_future<void> done = removed->get_future();
+    imu_thread_->loop()->PostTask(boost::bind(&LidarDataHandlerImpl::RemoveImuAsync, this, item, removed));
+    done.wait();
+  }
+  if (threads_.empty()) {
+    item->thread->loop()->RemoveDelegate(item->sock, this);
+    item->thread->Quit();
+    item->thread->Join();
+    item->thread->Uninit();
+    if (item->sock) {
+      apr_socket_close(item->sock);
     }
+    handler_->DrainBatch(handle);
+  } else {
+    // The thread keeps serving other devices, so the socket is detached and closed on it.
+    item->thread->loop()->PostTask(boost::bind(&LidarDataHandlerImpl::RemoveDeviceAsync, this, item));
   }
 }
 
+void LidarDataHandlerImpl::RemoveDeviceAsync(const DeviceItemPtr &item) {
+  item->thread->loop()->RemoveDelegateSync(item->sock);
+  apr_socket_close(item->sock);
+  item->sock = NULL;
+  handler_->DrainBatch(static_cast<uint8_t>(item->handle));
+}
+
+void LidarDataHandlerImpl::RemoveImuAsync(const DeviceItemPtr &item,
+                                          const shared_ptr<boost::promise<void> > &removed) {
+  imu_thread_->loop()->RemoveDelegateSync(item->imu_sock);
+  apr_socket_close(item->imu_sock);
+  item->imu_sock = NULL;
+  removed->set_value();
+}
+
+void LidarDataHandlerImpl::DeliverImu(uint8_t handle, const PacketRef &packet) {
+  OnDataCallback(handle, packet.get());
+}
+
 void LidarDataHandlerImpl::OnData(apr_socket_t *sock, void *client_data) {
-  uint8_t handle = static_cast<uint8_t>(reinterpret_cast<uintptr_t>(client_data));
-  if (handle > data_buffers_.size()) {
+  DeviceItem *item = static_cast<DeviceItem *>(client_data);
+  if (item == NULL) {
     return;
   }
-  boost::scoped_array<char> &buf = data_buffers_[handle];
-  if (buf.get() == NULL) {
-    buf.reset(new char[kMaxBufferSize]);
+
+  if (sock == item->imu_sock) {
+    ScopedLatency latency(instrumentation().imu_delegate());
+    uint32_t count = 0;
+    do {
+      count = item->imu_receiver.Receive(sock);
+      for (uint32_t i = 0; i < count && handler_; i++) {
+        PacketBuffer *packet = item->imu_receiver.packet(i);
+        handler_->OnImuData(item->handle, packet);
+        // The data callbacks still get the IMU packets, on the thread they get the point data on. The task holds a
+        // reference, released even if the loop stops before running it.
+        item->thread->loop()->PostTask(boost::bind(
+            &LidarDataHandlerImpl::DeliverImu, this, static_cast<uint8_t>(item->handle), PacketRef(packet)));
+      }
+    } while (!item->imu_receiver.drained());
+    return;
   }
 
-  apr_sockaddr_t addr;
-  apr_size_t size = kMaxBufferSize;
-  if (APR_SUCCESS == apr_socket_recvfrom(&addr, sock, 0, buf.get(), &size)) {
-    if (handler_) {
-      handler_->OnDataCallback(handle, buf.get(), size);
+  ScopedLatency latency(instrumentation().data_delegate());
+  // Drain the socket, the loop may be edge-triggered.
+  uint32_t count = 0;
+  do {
+    count = item->receiver.Receive(sock);
+    for (uint32_t i = 0; i < count && handler_; i++) {
+      handler_->OnDataCallback(item->handle, item->receiver.packet(i));
     }
-  }
+  } while (!item->receiver.drained());
 }
 
 }  // namespace livox
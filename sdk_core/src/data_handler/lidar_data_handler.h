@@ -26,8 +26,11 @@
 #define LIVOX_LIDAR_DATA_HANDLER_H_
 
 #include <boost/shared_ptr.hpp>
-#include <boost/smart_ptr/scoped_array.hpp>
+#include <boost/thread/future.hpp>
 #include <boost/thread/mutex.hpp>
+#include <list>
+#include <vector>
+#include "base/batch_receiver.h"
 #include "data_handler.h"
 #include "device_manager.h"
 
@@ -48,10 +51,24 @@ class LidarDataHandlerImpl : public DataHandlerImpl {
     apr_socket_t *sock;
     boost::shared_ptr<IOThread> thread;
     uint16_t handle;
+    BatchReceiver receiver;
+    /** Socket of the sensor port, served by the IMU thread. */
+    apr_socket_t *imu_sock;
+    BatchReceiver imu_receiver;
   } DeviceItem;
-  std::list<DeviceItem> devices_;
+  typedef boost::shared_ptr<DeviceItem> DeviceItemPtr;
 
-  boost::array<boost::scoped_array<char>, kMaxConnectedDeviceNum> data_buffers_;
+  void RemoveDeviceAsync(const DeviceItemPtr &item);
+  void RemoveImuAsync(const DeviceItemPtr &item, const boost::shared_ptr<boost::promise<void> > &removed);
+  /** Hand an IMU packet to the data callbacks on the data thread of the device. */
+  void DeliverImu(uint8_t handle, const PacketRef &packet);
+
+  static const uint32_t kImuBatchSize = 4;
+  std::list<DeviceItemPtr> devices_;
+  /** Shared receive threads, empty when every device owns a receive thread. */
+  std::vector<boost::shared_ptr<IOThread> > threads_;
+  /** Receive thread of the sensor ports of all the LiDAR units. */
+  boost::shared_ptr<IOThread> imu_thread_;
   apr_pool_t *mem_pool_;
   boost::mutex mutex_;
 };
@@ -0,0 +1,377 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "motion_deskew.h"
+#include <math.h>
+#include <string.h>
+#include <boost/thread/lock_guard.hpp>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LIVOX_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace livox {
+
+namespace {
+
+/** Points deskewed per kernel call. */
+const uint32_t kDeskewBlock = 64;
+
+void QuaternionToMatrix(const double q[4], double m[3][3]) {
+  double w = q[0], x = q[1], y = q[2], z = q[3];
+  m[0][0] = 1 - 2 * (y * y + z * z);
+  m[0][1] = 2 * (x * y - w * z);
+  m[0][2] = 2 * (x * z + w * y);
+  m[1][0] = 2 * (x * y + w * z);
+  m[1][1] = 1 - 2 * (x * x + z * z);
+  m[1][2] = 2 * (y * z - w * x);
+  m[2][0] = 2 * (x * z - w * y);
+  m[2][1] = 2 * (y * z + w * x);
+  m[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+void NormalizeQuaternion(double q[4]) {
+  double norm = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  if (norm <= 0) {
+    q[0] = 1;
+    q[1] = q[2] = q[3] = 0;
+    return;
+  }
+  for (int i = 0; i < 4; i++) {
+    q[i] /= norm;
+  }
+}
+
+/** p -> a(b(p)). */
+PointTransform Compose(const PointTransform &a, const PointTransform &b) {
+  PointTransform out;
+  for (int r = 0; r < 3; r++) {
+    for (int c = 0; c < 3; c++) {
+      out.rotation[r][c] =
+          a.rotation[r][0] * b.rotation[0][c] + a.rotation[r][1] * b.rotation[1][c] + a.rotation[r][2] * b.rotation[2][c];
+    }
+    out.translation[r] = a.rotation[r][0] * b.translation[0] + a.rotation[r][1] * b.translation[1] +
+                         a.rotation[r][2] * b.translation[2] + a.translation[r];
+  }
+  return out;
+}
+
+PointTransform Inverse(const PointTransform &t) {
+  PointTransform out;
+  for (int r = 0; r < 3; r++) {
+    for (int c = 0; c < 3; c++) {
+      out.rotation[r][c] = t.rotation[c][r];
+    }
+  }
+  for (int r = 0; r < 3; r++) {
+    out.translation[r] = -(out.rotation[r][0] * t.translation[0] + out.rotation[r][1] * t.translation[1] +
+                           out.rotation[r][2] * t.translation[2]);
+  }
+  return out;
+}
+
+typedef void (*DeskewKernel)(const PointTransform &, const PointTransform &, const float *, uint32_t, float *, float *,
+                             float *);
+
+/** p' = base(p) + alpha * (delta.rotation * p + delta.translation), the transform interpolated along a segment. */
+void DeskewScalar(const PointTransform &base,
+                  const PointTransform &delta,
+                  const float *alpha,
+                  uint32_t count,
+                  float *x,
+                  float *y,
+                  float *z) {
+  for (uint32_t i = 0; i < count; i++) {
+    float p[3] = {x[i], y[i], z[i]};
+    float out[3];
+    for (int r = 0; r < 3; r++) {
+      float v = base.rotation[r][0] * p[0] + base.rotation[r][1] * p[1] + base.rotation[r][2] * p[2] +
+                base.translation[r];
+      float d = delta.rotation[r][0] * p[0] + delta.rotation[r][1] * p[1] + delta.rotation[r][2] * p[2] +
+                delta.translation[r];
+      out[r] = v + alpha[i] * d;
+    }
+    x[i] = out[0];
+    y[i] = out[1];
+    z[i] = out[2];
+  }
+}
+
+#ifdef LIVOX_X86_DISPATCH
+__attribute__((target("avx2"))) void DeskewAvx2(const PointTransform &base,
+                                               const PointTransform &delta,
+                                               const float *alpha,
+                                               uint32_t count,
+                                               float *x,
+                                               float *y,
+                                               float *z) {
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 p[3] = {_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), _mm256_loadu_ps(z + i)};
+    __m256 a = _mm256_loadu_ps(alpha + i);
+    __m256 out[3];
+    for (int r = 0; r < 3; r++) {
+      __m256 v = _mm256_set1_ps(base.translation[r]);
+      __m256 d = _mm256_set1_ps(delta.translation[r]);
+      for (int c = 0; c < 3; c++) {
+        v = _mm256_add_ps(v, _mm256_mul_ps(_mm256_set1_ps(base.rotation[r][c]), p[c]));
+        d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(delta.rotation[r][c]), p[c]));
+      }
+      out[r] = _mm256_add_ps(v, _mm256_mul_ps(a, d));
+    }
+    _mm256_storeu_ps(x + i, out[0]);
+    _mm256_storeu_ps(y + i, out[1]);
+    _mm256_storeu_ps(z + i, out[2]);
+  }
+  DeskewScalar(base, delta, alpha + i, count - i, x + i, y + i, z + i);
+}
+#endif
+
+DeskewKernel SelectDeskewKernel() {
+#ifdef LIVOX_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return DeskewAvx2;
+  }
+#endif
+  return DeskewScalar;
+}
+
+}  // namespace
+
+MotionDeskew::MotionDeskew() : poses_(kPoseCount), begin_(0), size_(0), external_(false), has_imu_(false) {}
+
+void MotionDeskew::PushLocked(const Pose &pose) {
+  if (size_ > 0) {
+    const Pose &last = PoseAt(size_ - 1);
+    if (pose.timestamp < last.timestamp) {
+      // The clock went backwards, after a sync change: the old poses no longer apply.
+      size_ = 0;
+    } else if (pose.timestamp == last.timestamp) {
+      poses_[(begin_ + size_ - 1) % kPoseCount] = pose;
+      return;
+    }
+  }
+  if (size_ < kPoseCount) {
+    poses_[(begin_ + size_) % kPoseCount] = pose;
+    size_++;
+  } else {
+    poses_[begin_] = pose;
+    begin_ = (begin_ + 1) % kPoseCount;
+  }
+}
+
+void MotionDeskew::AddImu(uint64_t timestamp, const LivoxImuPoint &imu) {
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  if (external_) {
+    return;
+  }
+  if (size_ == 0 || !has_imu_ || timestamp < PoseAt(size_ - 1).timestamp) {
+    Pose pose = {timestamp, {1, 0, 0, 0}, {0, 0, 0}};
+    size_ = 0;
+    PushLocked(pose);
+    last_imu_ = imu;
+    has_imu_ = true;
+    return;
+  }
+
+  Pose pose = PoseAt(size_ - 1);
+  double dt = (timestamp - pose.timestamp) * 1e-9;
+  // Rotate by the mean angular rate over the interval, in the body frame.
+  double theta[3] = {0.5 * (last_imu_.gyro_x + imu.gyro_x) * dt,
+                     0.5 * (last_imu_.gyro_y + imu.gyro_y) * dt,
+                     0.5 * (last_imu_.gyro_z + imu.gyro_z) * dt};
+  double angle = sqrt(theta[0] * theta[0] + theta[1] * theta[1] + theta[2] * theta[2]);
+  double scale = angle > 1e-12 ? sin(angle / 2) / angle : 0.5;
+  double dq[4] = {cos(angle / 2), theta[0] * scale, theta[1] * scale, theta[2] * scale};
+  const double *q = pose.q;
+  double out[4] = {q[0] * dq[0] - q[1] * dq[1] - q[2] * dq[2] - q[3] * dq[3],
+                   q[0] * dq[1] + q[1] * dq[0] + q[2] * dq[3] - q[3] * dq[2],
+                   q[0] * dq[2] - q[1] * dq[3] + q[2] * dq[0] + q[3] * dq[1],
+                   q[0] * dq[3] + q[1] * dq[2] - q[2] * dq[1] + q[3] * dq[0]};
+  NormalizeQuaternion(out);
+  std::copy(out, out + 4, pose.q);
+  pose.timestamp = timestamp;
+  PushLocked(pose);
+  last_imu_ = imu;
+}
+
+void MotionDeskew::AddPose(const LivoxPose &pose) {
+  boost::lock_guard<boost::mutex> lock(mutex_);
+  if (!external_) {
+    external_ = true;
+    size_ = 0;
+  }
+  Pose value = {pose.timestamp, {pose.qw, pose.qx, pose.qy, pose.qz}, {pose.x, pose.y, pose.z}};
+  NormalizeQuaternion(value.q);
+  PushLocked(value);
+}
+
+MotionDeskew::Pose MotionDeskew::InterpolateLocked(uint64_t timestamp) const {
+  uint32_t low = 0;
+  uint32_t high = size_;
+  while (low < high) {
+    uint32_t mid = (low + high) / 2;
+    if (PoseAt(mid).timestamp <= timestamp) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low == 0) {
+    return PoseAt(0);
+  }
+  if (low == size_) {
+    return PoseAt(size_ - 1);
+  }
+  const Pose &a = PoseAt(low - 1);
+  const Pose &b = PoseAt(low);
+  double alpha = static_cast<double>(timestamp - a.timestamp) / (b.timestamp - a.timestamp);
+  double dot = a.q[0] * b.q[0] + a.q[1] * b.q[1] + a.q[2] * b.q[2] + a.q[3] * b.q[3];
+  double sign = dot < 0 ? -1 : 1;
+  Pose pose;
+  pose.timestamp = timestamp;
+  for (int i = 0; i < 4; i++) {
+    pose.q[i] = (1 - alpha) * a.q[i] + alpha * sign * b.q[i];
+  }
+  NormalizeQuaternion(pose.q);
+  for (int i = 0; i < 3; i++) {
+    pose.t[i] = (1 - alpha) * a.t[i] + alpha * b.t[i];
+  }
+  return pose;
+}
+
+livox_status MotionDeskew::Deskew(LivoxPointBuffer *points, uint64_t target_time, const PointTransform *extrinsic) {
+  if (points == NULL || points->timestamp == NULL) {
+    return kStatusFailure;
+  }
+  if (points->size == 0) {
+    return kStatusSuccess;
+  }
+  const uint64_t *timestamps = points->timestamp;
+  uint64_t first = *std::min_element(timestamps, timestamps + points->size);
+  uint64_t last = *std::max_element(timestamps, timestamps + points->size);
+
+  // Motion from the key poses to the target, sampled at the poses within the points' time span.
+  uint64_t key_times[kMaxKeyPoses];
+  PointTransform keys[kMaxKeyPoses];
+  uint32_t key_count = 0;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    if (size_ == 0) {
+      return kStatusFailure;
+    }
+    Pose target = InterpolateLocked(target_time);
+    double target_rotation[3][3];
+    QuaternionToMatrix(target.q, target_rotation);
+
+    uint32_t inner_begin = 0;
+    while (inner_begin < size_ && PoseAt(inner_begin).timestamp <= first) {
+      inner_begin++;
+    }
+    uint32_t inner_end = inner_begin;
+    while (inner_end < size_ && PoseAt(inner_end).timestamp < last) {
+      inner_end++;
+    }
+    uint32_t stride = (inner_end - inner_begin) / (kMaxKeyPoses - 2) + 1;
+
+    Pose key_poses[kMaxKeyPoses];
+    key_poses[key_count++] = InterpolateLocked(first);
+    for (uint32_t i = inner_begin; i < inner_end; i += stride) {
+      key_poses[key_count++] = PoseAt(i);
+    }
+    if (last > first) {
+      key_poses[key_count++] = InterpolateLocked(last);
+    }
+
+    for (uint32_t k = 0; k < key_count; k++) {
+      const Pose &pose = key_poses[k];
+      double rotation[3][3];
+      QuaternionToMatrix(pose.q, rotation);
+      PointTransform &key = keys[k];
+      for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+          key.rotation[r][c] = static_cast<float>(target_rotation[0][r] * rotation[0][c] +
+                                                  target_rotation[1][r] * rotation[1][c] +
+                                                  target_rotation[2][r] * rotation[2][c]);
+        }
+        key.translation[r] = static_cast<float>(target_rotation[0][r] * (pose.t[0] - target.t[0]) +
+                                                target_rotation[1][r] * (pose.t[1] - target.t[1]) +
+                                                target_rotation[2][r] * (pose.t[2] - target.t[2]));
+      }
+      key_times[k] = pose.timestamp;
+    }
+  }
+
+  if (extrinsic) {
+    // The motion is in the sensor frame, the points are in the extrinsic frame.
+    PointTransform inverse = Inverse(*extrinsic);
+    for (uint32_t k = 0; k < key_count; k++) {
+      keys[k] = Compose(*extrinsic, Compose(keys[k], inverse));
+    }
+  }
+
+  static const DeskewKernel kernel = SelectDeskewKernel();
+  float alpha[kDeskewBlock];
+  uint32_t i = 0;
+  while (i < points->size) {
+    // Segment [k, k + 1) holding the point, the last segment also takes the points after it.
+    uint32_t k = static_cast<uint32_t>(std::upper_bound(key_times, key_times + key_count, timestamps[i]) - key_times);
+    k = k > 0 ? k - 1 : 0;
+    if (k + 1 >= key_count) {
+      k = key_count > 1 ? key_count - 2 : 0;
+    }
+    PointTransform delta;
+    float inverse_duration = 0;
+    if (key_count > 1) {
+      for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+          delta.rotation[r][c] = keys[k + 1].rotation[r][c] - keys[k].rotation[r][c];
+        }
+        delta.translation[r] = keys[k + 1].translation[r] - keys[k].translation[r];
+      }
+      inverse_duration = 1.0f / static_cast<float>(key_times[k + 1] - key_times[k]);
+    } else {
+      memset(&delta, 0, sizeof(delta));
+    }
+    uint64_t segment_begin = key_times[k];
+    uint64_t segment_end = key_count > 1 ? key_times[k + 1] : segment_begin;
+    uint32_t n = 0;
+    while (i + n < points->size && n < kDeskewBlock) {
+      uint64_t t = timestamps[i + n];
+      if (n > 0 && (t < segment_begin || (t > segment_end && k + 2 < key_count))) {
+        break;
+      }
+      float a = t <= segment_begin ? 0.0f : static_cast<float>(t - segment_begin) * inverse_duration;
+      alpha[n++] = std::min(a, 1.0f);
+    }
+    kernel(keys[k], delta, alpha, n, points->x + i, points->y + i, points->z + i);
+    i += n;
+  }
+  return kStatusSuccess;
+}
+
+}  // namespace livox
@@ -0,0 +1,84 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_MOTION_DESKEW_H_
+#define LIVOX_MOTION_DESKEW_H_
+
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include "base/noncopyable.h"
+#include "livox_def.h"
+#include "point_convert.h"
+
+namespace livox {
+
+/**
+ * Tracks the motion of a device and removes the motion distortion of its
+ * points. The orientation is integrated from the gyroscope of the IMU
+ * packets, or taken with the position from an external pose stream, which
+ * replaces the IMU once a pose is pushed. Poses are kept in a fixed ring.
+ */
+class MotionDeskew : public noncopyable {
+ public:
+  MotionDeskew();
+
+  /** Integrate an IMU sample, ignored once external poses are pushed. */
+  void AddImu(uint64_t timestamp, const LivoxImuPoint &imu);
+  void AddPose(const LivoxPose &pose);
+
+  /**
+   * Move every point of a buffer, ordered by time, to where it would have been measured at target_time. Points
+   * outside the tracked time span use the nearest pose.
+   * @param extrinsic transform already applied to the points, NULL for none.
+   * @return kStatusSuccess, kStatusFailure if no motion is tracked yet or the buffer has no timestamps.
+   */
+  livox_status Deskew(LivoxPointBuffer *points, uint64_t target_time, const PointTransform *extrinsic);
+
+  static const uint32_t kPoseCount = 4096;
+  static const uint32_t kMaxKeyPoses = 256;
+
+ private:
+  struct Pose {
+    uint64_t timestamp;
+    double q[4];
+    double t[3];
+  };
+
+  void PushLocked(const Pose &pose);
+  /** Pose at a time, interpolated between the two poses around it. */
+  Pose InterpolateLocked(uint64_t timestamp) const;
+  const Pose &PoseAt(uint32_t index) const { return poses_[(begin_ + index) % kPoseCount]; }
+
+  std::vector<Pose> poses_;
+  uint32_t begin_;
+  uint32_t size_;
+  bool external_;
+  bool has_imu_;
+  LivoxImuPoint last_imu_;
+  mutable boost::mutex mutex_;
+};
+
+}  // namespace livox
+
+#endif  // LIVOX_MOTION_DESKEW_H_
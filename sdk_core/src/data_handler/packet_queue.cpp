@@ -0,0 +1,171 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "packet_queue.h"
+#include <apr_time.h>
+
+namespace livox {
+
+/** Upper bound of an idle wait, guards against a wake-up missed across the lock-free handoff. */
+static const apr_interval_time_t kIdleWaitTime = apr_time_from_msec(10);
+/** Back-off of the receive thread while the queue is full under kDataQueueBlock. */
+static const apr_interval_time_t kBlockRetryTime = 100;
+
+PacketQueue::PacketQueue(uint32_t capacity, DataQueuePolicy policy, const Consumer &consumer)
+    : ring_(capacity),
+      policy_(policy),
+      consumer_(consumer),
+      mutex_(NULL),
+      cond_(NULL),
+      waiting_(false),
+      thread_id_(),
+      has_thread_id_(false),
+      received_(0),
+      dropped_(0),
+      high_water_mark_(0) {}
+
+bool PacketQueue::Init() {
+  if (!ThreadBase::Init()) {
+    return false;
+  }
+  if (apr_thread_mutex_create(&mutex_, APR_THREAD_MUTEX_DEFAULT, pool_) != APR_SUCCESS ||
+      apr_thread_cond_create(&cond_, pool_) != APR_SUCCESS) {
+    ThreadBase::Uninit();
+    return false;
+  }
+  return Start();
+}
+
+void PacketQueue::Uninit() {
+  if (pool_ == NULL) {
+    return;
+  }
+  Stop();
+  while (DropOldest()) {
+  }
+  // mutex_ and cond_ are released together with the pool.
+  mutex_ = NULL;
+  cond_ = NULL;
+  ThreadBase::Uninit();
+}
+
+void PacketQueue::Push(PacketBuffer *packet) {
+  PacketBuffer **slot = ring_.AcquireWrite();
+  while (slot == NULL) {
+    if (policy_ == kDataQueueDropNewest || IsQuit()) {
+      ++dropped_;
+      return;
+    }
+    if (policy_ == kDataQueueDropOldest) {
+      // A cell the queue thread is reading is released right away, only make room when the ring is really full.
+      if (ring_.size() == ring_.capacity() && DropOldest()) {
+        ++dropped_;
+      }
+    } else {
+      Wake();
+      apr_sleep(kBlockRetryTime);
+    }
+    slot = ring_.AcquireWrite();
+  }
+  packet->Retain();
+  *slot = packet;
+  ring_.CommitWrite();
+  ++received_;
+
+  uint32_t queued = ring_.size();
+  if (queued > high_water_mark_.load(boost::memory_order_relaxed)) {
+    high_water_mark_.store(queued, boost::memory_order_relaxed);
+  }
+
+  boost::atomic_thread_fence(boost::memory_order_seq_cst);
+  if (waiting_.load(boost::memory_order_relaxed)) {
+    Wake();
+  }
+}
+
+void PacketQueue::Stop() {
+  Quit();
+  Wake();
+  Join();
+}
+
+bool PacketQueue::IsQueueThread() const {
+  return has_thread_id_ && apr_os_thread_equal(thread_id_, apr_os_thread_current());
+}
+
+bool PacketQueue::DropOldest() {
+  uint32_t ticket = 0;
+  PacketBuffer **slot = ring_.AcquireRead(&ticket);
+  if (slot == NULL) {
+    return false;
+  }
+  PacketBuffer *packet = *slot;
+  ring_.ReleaseRead(ticket);
+  packet->Release();
+  return true;
+}
+
+void PacketQueue::GetStatus(DataQueueStatus *status) const {
+  status->received = received_.load();
+  status->dropped = dropped_.load();
+  status->size = ring_.size();
+  status->high_water_mark = high_water_mark_.load();
+  status->capacity = ring_.capacity();
+}
+
+void PacketQueue::Wake() {
+  if (mutex_ == NULL) {
+    return;
+  }
+  apr_thread_mutex_lock(mutex_);
+  apr_thread_cond_signal(cond_);
+  apr_thread_mutex_unlock(mutex_);
+}
+
+void PacketQueue::ThreadFunc() {
+  thread_id_ = apr_os_thread_current();
+  has_thread_id_ = true;
+  while (!IsQuit()) {
+    uint32_t ticket = 0;
+    PacketBuffer **slot = ring_.AcquireRead(&ticket);
+    if (slot != NULL) {
+      PacketBuffer *packet = *slot;
+      ring_.ReleaseRead(ticket);
+      consumer_(packet);
+      packet->Release();
+      continue;
+    }
+
+    apr_thread_mutex_lock(mutex_);
+    waiting_.store(true, boost::memory_order_relaxed);
+    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+    if (ring_.empty() && !IsQuit()) {
+      apr_thread_cond_timedwait(cond_, mutex_, kIdleWaitTime);
+    }
+    waiting_.store(false, boost::memory_order_relaxed);
+    apr_thread_mutex_unlock(mutex_);
+  }
+}
+
+}  // namespace livox
@@ -0,0 +1,84 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_PACKET_QUEUE_H_
+#define LIVOX_PACKET_QUEUE_H_
+
+#include <apr_portable.h>
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include "base/packet_pool.h"
+#include "base/spsc_ring.h"
+#include "base/thread_base.h"
+#include "livox_def.h"
+
+namespace livox {
+
+/**
+ * Decouples the data callback of a device from its receive thread: the
+ * receive thread puts a reference to each packet into a lock-free ring and the
+ * callback is called on the queue's own thread.
+ */
+class PacketQueue : public ThreadBase {
+ public:
+  typedef boost::function<void(PacketBuffer *packet)> Consumer;
+
+  PacketQueue(uint32_t capacity, DataQueuePolicy policy, const Consumer &consumer);
+  ~PacketQueue() { Uninit(); }
+
+  bool Init();
+  void Uninit();
+  /** Stop the queue thread, packets pushed afterwards are dropped. Not to be called on the queue thread. */
+  void Stop();
+  /** True on the thread calling the consumer. */
+  bool IsQueueThread() const;
+
+  /** Called on the receive thread only. */
+  void Push(PacketBuffer *packet);
+  void GetStatus(DataQueueStatus *status) const;
+
+  void ThreadFunc();
+
+ private:
+  void Wake();
+  bool DropOldest();
+
+  SpscRing<PacketBuffer *> ring_;
+  DataQueuePolicy policy_;
+  Consumer consumer_;
+  apr_thread_mutex_t *mutex_;
+  apr_thread_cond_t *cond_;
+  boost::atomic_bool waiting_;
+  apr_os_thread_t thread_id_;
+  boost::atomic_bool has_thread_id_;
+  boost::atomic<uint64_t> received_;
+  boost::atomic<uint64_t> dropped_;
+  boost::atomic<uint32_t> high_water_mark_;
+};
+
+}  // namespace livox
+
+#endif  // LIVOX_PACKET_QUEUE_H_
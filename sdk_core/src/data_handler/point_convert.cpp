@@ -0,0 +1,1067 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "point_convert.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include "livox_packet_view.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LIVOX_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace livox {
+
+namespace {
+
+const float kMillimetreToMetre = 0.001f;
+
+/** Level the kernels are selected for, the supported one unless lowered by SetSimdLevel. */
+SimdLevel &simd_level() {
+  static SimdLevel level = SupportedSimdLevel();
+  return level;
+}
+
+typedef void (*CartesianKernel)(const PointTransform &, const uint8_t *, uint32_t, uint32_t, float *, float *, float *);
+
+inline int32_t LoadInt32(const uint8_t *p) {
+  int32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline void TransformPoint(const PointTransform &t, float px, float py, float pz, float *x, float *y, float *z) {
+  *x = t.rotation[0][0] * px + t.rotation[0][1] * py + t.rotation[0][2] * pz + t.translation[0];
+  *y = t.rotation[1][0] * px + t.rotation[1][1] * py + t.rotation[1][2] * pz + t.translation[1];
+  *z = t.rotation[2][0] * px + t.rotation[2][1] * py + t.rotation[2][2] * pz + t.translation[2];
+}
+
+void ConvertCartesianScalar(
+    const PointTransform &t, const uint8_t *points, uint32_t stride, uint32_t count, float *x, float *y, float *z) {
+  for (uint32_t i = 0; i < count; i++, points += stride) {
+    TransformPoint(t,
+                   LoadInt32(points) * kMillimetreToMetre,
+                   LoadInt32(points + 4) * kMillimetreToMetre,
+                   LoadInt32(points + 8) * kMillimetreToMetre,
+                   x + i,
+                   y + i,
+                   z + i);
+  }
+}
+
+#ifdef LIVOX_X86_DISPATCH
+/** Rotate and translate 4 points held in registers. */
+__attribute__((target("sse4.1"))) inline void TransformSse41(const PointTransform &t, __m128 *x, __m128 *y, __m128 *z) {
+  __m128 out[3];
+  for (int row = 0; row < 3; row++) {
+    __m128 v = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.rotation[row][0]), *x), _mm_set1_ps(t.translation[row]));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(t.rotation[row][1]), *y));
+    out[row] = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(t.rotation[row][2]), *z));
+  }
+  *x = out[0];
+  *y = out[1];
+  *z = out[2];
+}
+
+/** Rotate and translate 8 points held in registers. */
+__attribute__((target("avx2"))) inline void TransformAvx2(const PointTransform &t, __m256 *x, __m256 *y, __m256 *z) {
+  __m256 out[3];
+  for (int row = 0; row < 3; row++) {
+    __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(t.rotation[row][0]), *x), _mm256_set1_ps(t.translation[row]));
+    v = _mm256_add_ps(v, _mm256_mul_ps(_mm256_set1_ps(t.rotation[row][1]), *y));
+    out[row] = _mm256_add_ps(v, _mm256_mul_ps(_mm256_set1_ps(t.rotation[row][2]), *z));
+  }
+  *x = out[0];
+  *y = out[1];
+  *z = out[2];
+}
+
+__attribute__((target("sse4.1"))) void ConvertCartesianSse41(
+    const PointTransform &t, const uint8_t *points, uint32_t stride, uint32_t count, float *x, float *y, float *z) {
+  const __m128 scale = _mm_set1_ps(kMillimetreToMetre);
+  uint32_t i = 0;
+  for (; i + 4 <= count; i += 4, points += 4 * stride) {
+    const uint8_t *p1 = points + stride;
+    const uint8_t *p2 = p1 + stride;
+    const uint8_t *p3 = p2 + stride;
+    __m128i vx = _mm_cvtsi32_si128(LoadInt32(points));
+    __m128i vy = _mm_cvtsi32_si128(LoadInt32(points + 4));
+    __m128i vz = _mm_cvtsi32_si128(LoadInt32(points + 8));
+    vx = _mm_insert_epi32(vx, LoadInt32(p1), 1);
+    vy = _mm_insert_epi32(vy, LoadInt32(p1 + 4), 1);
+    vz = _mm_insert_epi32(vz, LoadInt32(p1 + 8), 1);
+    vx = _mm_insert_epi32(vx, LoadInt32(p2), 2);
+    vy = _mm_insert_epi32(vy, LoadInt32(p2 + 4), 2);
+    vz = _mm_insert_epi32(vz, LoadInt32(p2 + 8), 2);
+    vx = _mm_insert_epi32(vx, LoadInt32(p3), 3);
+    vy = _mm_insert_epi32(vy, LoadInt32(p3 + 4), 3);
+    vz = _mm_insert_epi32(vz, LoadInt32(p3 + 8), 3);
+    __m128 fx = _mm_mul_ps(_mm_cvtepi32_ps(vx), scale);
+    __m128 fy = _mm_mul_ps(_mm_cvtepi32_ps(vy), scale);
+    __m128 fz = _mm_mul_ps(_mm_cvtepi32_ps(vz), scale);
+    TransformSse41(t, &fx, &fy, &fz);
+    _mm_storeu_ps(x + i, fx);
+    _mm_storeu_ps(y + i, fy);
+    _mm_storeu_ps(z + i, fz);
+  }
+  ConvertCartesianScalar(t, points, stride, count - i, x + i, y + i, z + i);
+}
+
+__attribute__((target("avx2"))) void ConvertCartesianAvx2(
+    const PointTransform &t, const uint8_t *points, uint32_t stride, uint32_t count, float *x, float *y, float *z) {
+  const __m256 scale = _mm256_set1_ps(kMillimetreToMetre);
+  const int s = static_cast<int>(stride);
+  // Byte offsets of 8 consecutive points, gathered with a scale of 1.
+  const __m256i offsets = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8, points += 8 * stride) {
+    const int *base = reinterpret_cast<const int *>(points);
+    __m256i vx = _mm256_i32gather_epi32(base, offsets, 1);
+    __m256i vy = _mm256_i32gather_epi32(base + 1, offsets, 1);
+    __m256i vz = _mm256_i32gather_epi32(base + 2, offsets, 1);
+    __m256 fx = _mm256_mul_ps(_mm256_cvtepi32_ps(vx), scale);
+    __m256 fy = _mm256_mul_ps(_mm256_cvtepi32_ps(vy), scale);
+    __m256 fz = _mm256_mul_ps(_mm256_cvtepi32_ps(vz), scale);
+    TransformAvx2(t, &fx, &fy, &fz);
+    _mm256_storeu_ps(x + i, fx);
+    _mm256_storeu_ps(y + i, fy);
+    _mm256_storeu_ps(z + i, fz);
+  }
+  ConvertCartesianScalar(t, points, stride, count - i, x + i, y + i, z + i);
+}
+#endif
+
+CartesianKernel SelectCartesianKernel() {
+#ifdef LIVOX_X86_DISPATCH
+  if (simd_level() >= kSimdAvx2) {
+    return ConvertCartesianAvx2;
+  }
+  if (simd_level() >= kSimdSse41) {
+    return ConvertCartesianSse41;
+  }
+#endif
+  return ConvertCartesianScalar;
+}
+
+typedef void (*DualCartesianKernel)(const PointTransform &, const uint8_t *, uint32_t, float *const *,
+                                    float *const *);
+
+/** Split the two returns of dual Cartesian points into the first (x, y, z) and the second (x, y, z) arrays. */
+void ConvertDualCartesianScalar(
+    const PointTransform &t, const uint8_t *points, uint32_t count, float *const *first, float *const *second) {
+  const uint32_t stride = sizeof(LivoxDualExtendRawPoint);
+  const uint32_t second_offset = offsetof(LivoxDualExtendRawPoint, x2);
+  for (uint32_t i = 0; i < count; i++, points += stride) {
+    const uint8_t *p2 = points + second_offset;
+    TransformPoint(t,
+                   LoadInt32(points) * kMillimetreToMetre,
+                   LoadInt32(points + 4) * kMillimetreToMetre,
+                   LoadInt32(points + 8) * kMillimetreToMetre,
+                   first[0] + i,
+                   first[1] + i,
+                   first[2] + i);
+    TransformPoint(t,
+                   LoadInt32(p2) * kMillimetreToMetre,
+                   LoadInt32(p2 + 4) * kMillimetreToMetre,
+                   LoadInt32(p2 + 8) * kMillimetreToMetre,
+                   second[0] + i,
+                   second[1] + i,
+                   second[2] + i);
+  }
+}
+
+#ifdef LIVOX_X86_DISPATCH
+/** Both returns of 8 records are gathered in the same iteration, so every record is loaded once. */
+__attribute__((target("avx2"))) void ConvertDualCartesianAvx2(const PointTransform &t,
+                                                             const uint8_t *points,
+                                                             uint32_t count,
+                                                             float *const *first,
+                                                             float *const *second) {
+  const __m256 scale = _mm256_set1_ps(kMillimetreToMetre);
+  const int s = static_cast<int>(sizeof(LivoxDualExtendRawPoint));
+  const int second_offset = static_cast<int>(offsetof(LivoxDualExtendRawPoint, x2));
+  const __m256i offsets = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8, points += 8 * s) {
+    __m256 v1[3];
+    __m256 v2[3];
+    for (int axis = 0; axis < 3; axis++) {
+      const int *base = reinterpret_cast<const int *>(points + 4 * axis);
+      const int *base2 = reinterpret_cast<const int *>(points + second_offset + 4 * axis);
+      v1[axis] = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_i32gather_epi32(base, offsets, 1)), scale);
+      v2[axis] = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_i32gather_epi32(base2, offsets, 1)), scale);
+    }
+    TransformAvx2(t, &v1[0], &v1[1], &v1[2]);
+    TransformAvx2(t, &v2[0], &v2[1], &v2[2]);
+    for (int axis = 0; axis < 3; axis++) {
+      _mm256_storeu_ps(first[axis] + i, v1[axis]);
+      _mm256_storeu_ps(second[axis] + i, v2[axis]);
+    }
+  }
+  float *first_tail[3] = {first[0] + i, first[1] + i, first[2] + i};
+  float *second_tail[3] = {second[0] + i, second[1] + i, second[2] + i};
+  ConvertDualCartesianScalar(t, points, count - i, first_tail, second_tail);
+}
+#endif
+
+DualCartesianKernel SelectDualCartesianKernel() {
+#ifdef LIVOX_X86_DISPATCH
+  if (simd_level() >= kSimdAvx2) {
+    return ConvertDualCartesianAvx2;
+  }
+#endif
+  return ConvertDualCartesianScalar;
+}
+
+inline uint32_t LoadUint32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint16_t LoadUint16(const uint8_t *p) {
+  uint16_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+/**
+ * sin of every angle step of the spherical formats, sent in 0.01 degree steps. The table runs a quarter turn past
+ * the largest azimuth, so cos(a) is sin_table[a + kQuarterTurn].
+ */
+struct TrigTable {
+  static const uint32_t kMaxTheta = 18000;
+  static const uint32_t kMaxPhi = 36000;
+  static const uint32_t kQuarterTurn = 9000;
+  static const uint32_t kSize = kMaxPhi + kQuarterTurn + 1;
+  float sin_table[kSize];
+
+  TrigTable() {
+    for (uint32_t i = 0; i < kSize; i++) {
+      sin_table[i] = static_cast<float>(sin(i * M_PI / kMaxTheta));
+    }
+  }
+};
+
+/** Angles out of range come from a corrupt point, it is converted as a point without a return. */
+inline bool ValidAngles(uint32_t theta, uint32_t phi) {
+  return theta <= TrigTable::kMaxTheta && phi <= TrigTable::kMaxPhi;
+}
+
+const TrigTable &trig_table() {
+  static const TrigTable table;
+  return table;
+}
+
+typedef void (*SphericalKernel)(const TrigTable &, const PointTransform &, const uint8_t *, uint32_t, uint32_t,
+                                uint32_t, uint32_t, float *, float *, float *);
+
+void ConvertSphericalScalar(const TrigTable &table,
+                            const PointTransform &t,
+                            const uint8_t *points,
+                            uint32_t stride,
+                            uint32_t depth_offset,
+                            uint32_t angle_offset,
+                            uint32_t count,
+                            float *x,
+                            float *y,
+                            float *z) {
+  for (uint32_t i = 0; i < count; i++, points += stride) {
+    float depth = LoadUint32(points + depth_offset) * kMillimetreToMetre;
+    uint32_t theta = LoadUint16(points + angle_offset);
+    uint32_t phi = LoadUint16(points + angle_offset + 2);
+    if (!ValidAngles(theta, phi)) {
+      depth = 0.0f;
+      theta = 0;
+      phi = 0;
+    }
+    float radius = depth * table.sin_table[theta];
+    TransformPoint(t,
+                   radius * table.sin_table[phi + TrigTable::kQuarterTurn],
+                   radius * table.sin_table[phi],
+                   depth * table.sin_table[theta + TrigTable::kQuarterTurn],
+                   x + i,
+                   y + i,
+                   z + i);
+  }
+}
+
+#ifdef LIVOX_X86_DISPATCH
+__attribute__((target("avx2"))) void ConvertSphericalAvx2(const TrigTable &table,
+                                                         const PointTransform &t,
+                                                         const uint8_t *points,
+                                                         uint32_t stride,
+                                                         uint32_t depth_offset,
+                                                         uint32_t angle_offset,
+                                                         uint32_t count,
+                                                         float *x,
+                                                         float *y,
+                                                         float *z) {
+  const __m256 scale = _mm256_set1_ps(kMillimetreToMetre);
+  const __m256i low_mask = _mm256_set1_epi32(0xFFFF);
+  const __m256i max_theta = _mm256_set1_epi32(TrigTable::kMaxTheta);
+  const __m256i max_phi = _mm256_set1_epi32(TrigTable::kMaxPhi);
+  const __m256i quarter_turn = _mm256_set1_epi32(TrigTable::kQuarterTurn);
+  const int s = static_cast<int>(stride);
+  const __m256i offsets = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8, points += 8 * stride) {
+    __m256i depth = _mm256_i32gather_epi32(reinterpret_cast<const int *>(points + depth_offset), offsets, 1);
+    // theta in the low and phi in the high half of each 32 bit lane.
+    __m256i angles = _mm256_i32gather_epi32(reinterpret_cast<const int *>(points + angle_offset), offsets, 1);
+    __m256i theta = _mm256_and_si256(angles, low_mask);
+    __m256i phi = _mm256_srli_epi32(angles, 16);
+    __m256i invalid = _mm256_or_si256(_mm256_cmpgt_epi32(theta, max_theta), _mm256_cmpgt_epi32(phi, max_phi));
+    theta = _mm256_andnot_si256(invalid, theta);
+    phi = _mm256_andnot_si256(invalid, phi);
+    depth = _mm256_andnot_si256(invalid, depth);
+
+    __m256 sin_theta = _mm256_i32gather_ps(table.sin_table, theta, 4);
+    __m256 cos_theta = _mm256_i32gather_ps(table.sin_table, _mm256_add_epi32(theta, quarter_turn), 4);
+    __m256 sin_phi = _mm256_i32gather_ps(table.sin_table, phi, 4);
+    __m256 cos_phi = _mm256_i32gather_ps(table.sin_table, _mm256_add_epi32(phi, quarter_turn), 4);
+
+    // depth is unsigned, converted as two exact 16 bit halves so the sum rounds like the scalar conversion.
+    __m256 depth_high = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(depth, 16)), _mm256_set1_ps(65536.0f));
+    __m256 depth_low = _mm256_cvtepi32_ps(_mm256_and_si256(depth, low_mask));
+    __m256 d = _mm256_mul_ps(_mm256_add_ps(depth_high, depth_low), scale);
+    __m256 radius = _mm256_mul_ps(d, sin_theta);
+    __m256 fx = _mm256_mul_ps(radius, cos_phi);
+    __m256 fy = _mm256_mul_ps(radius, sin_phi);
+    __m256 fz = _mm256_mul_ps(d, cos_theta);
+    TransformAvx2(t, &fx, &fy, &fz);
+    _mm256_storeu_ps(x + i, fx);
+    _mm256_storeu_ps(y + i, fy);
+    _mm256_storeu_ps(z + i, fz);
+  }
+  ConvertSphericalScalar(table, t, points, stride, depth_offset, angle_offset, count - i, x + i, y + i, z + i);
+}
+#endif
+
+SphericalKernel SelectSphericalKernel() {
+#ifdef LIVOX_X86_DISPATCH
+  if (simd_level() >= kSimdAvx2) {
+    return ConvertSphericalAvx2;
+  }
+#endif
+  return ConvertSphericalScalar;
+}
+
+void ConvertSpherical(const PointTransform &t,
+                      const uint8_t *points,
+                      uint32_t stride,
+                      uint32_t depth_offset,
+                      uint32_t angle_offset,
+                      uint32_t count,
+                      float *x,
+                      float *y,
+                      float *z) {
+  SphericalKernel kernel = SelectSphericalKernel();
+  kernel(trig_table(), t, points, stride, depth_offset, angle_offset, count, x, y, z);
+}
+
+/** Interleave the two returns of the dual spherical points, both returns share the angles of their record. */
+void ConvertDualSpherical(
+    const PointTransform &t, const uint8_t *points, uint32_t count, float *x, float *y, float *z) {
+  static const uint32_t kChunkSize = 64;
+  const uint32_t stride = sizeof(LivoxDualExtendSpherPoint);
+  float first[3][kChunkSize];
+  float second[3][kChunkSize];
+  for (uint32_t done = 0; done < count; done += kChunkSize, points += kChunkSize * stride) {
+    uint32_t n = std::min(kChunkSize, count - done);
+    ConvertSpherical(
+        t, points, stride, offsetof(LivoxDualExtendSpherPoint, depth1), 0, n, first[0], first[1], first[2]);
+    ConvertSpherical(
+        t, points, stride, offsetof(LivoxDualExtendSpherPoint, depth2), 0, n, second[0], second[1], second[2]);
+    float *out[3] = {x + 2 * done, y + 2 * done, z + 2 * done};
+    for (uint32_t axis = 0; axis < 3; axis++) {
+      for (uint32_t i = 0; i < n; i++) {
+        out[axis][2 * i] = first[axis][i];
+        out[axis][2 * i + 1] = second[axis][i];
+      }
+    }
+  }
+}
+
+/**
+ * Copy the reflectivity and tag bytes of every point.
+ * @param tag_offset offset of the tag, negative for formats without tag.
+ * @param step distance between two output entries.
+ */
+void CopyReflectivityAndTag(const uint8_t *points,
+                            uint32_t stride,
+                            uint32_t count,
+                            uint32_t reflectivity_offset,
+                            int32_t tag_offset,
+                            uint32_t step,
+                            uint8_t *reflectivity,
+                            uint8_t *tag) {
+  if (reflectivity) {
+    for (uint32_t i = 0; i < count; i++) {
+      reflectivity[i * step] = points[i * stride + reflectivity_offset];
+    }
+  }
+  if (tag) {
+    for (uint32_t i = 0; i < count; i++) {
+      tag[i * step] = tag_offset < 0 ? 0 : points[i * stride + tag_offset];
+    }
+  }
+}
+
+typedef void (*TimestampKernel)(uint64_t, uint32_t, uint32_t, uint32_t, uint64_t *);
+
+/** Point i is sampled at base + (i / repeat) * interval. */
+void FillTimestampsScalar(uint64_t base, uint32_t interval, uint32_t repeat, uint32_t count, uint64_t *out) {
+  for (uint32_t i = 0; i < count; i++) {
+    out[i] = base + static_cast<uint64_t>(i / repeat) * interval;
+  }
+}
+
+#ifdef LIVOX_X86_DISPATCH
+/** repeat must divide 4. */
+__attribute__((target("avx2"))) void FillTimestampsAvx2(
+    uint64_t base, uint32_t interval, uint32_t repeat, uint32_t count, uint64_t *out) {
+  __m256i value = _mm256_setr_epi64x(base,
+                                     base + static_cast<uint64_t>(1 / repeat) * interval,
+                                     base + static_cast<uint64_t>(2 / repeat) * interval,
+                                     base + static_cast<uint64_t>(3 / repeat) * interval);
+  const __m256i step = _mm256_set1_epi64x(static_cast<uint64_t>(4 / repeat) * interval);
+  uint32_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), value);
+    value = _mm256_add_epi64(value, step);
+  }
+  FillTimestampsScalar(base + static_cast<uint64_t>(i / repeat) * interval, interval, repeat, count - i, out + i);
+}
+#endif
+
+TimestampKernel SelectTimestampKernel() {
+#ifdef LIVOX_X86_DISPATCH
+  if (simd_level() >= kSimdAvx2) {
+    return FillTimestampsAvx2;
+  }
+#endif
+  return FillTimestampsScalar;
+}
+
+void FillTimestamps(const LivoxPacketTimeBase &time, uint32_t count, uint64_t *out) {
+  TimestampKernel kernel = SelectTimestampKernel();
+  kernel(time.timestamp, time.interval, time.points_per_interval, count, out);
+}
+
+/** Days from 1970-01-01 to a date of the proleptic Gregorian calendar. */
+int64_t DaysFromCivil(int64_t year, int32_t month, int32_t day) {
+  year -= month <= 2;
+  int64_t era = (year >= 0 ? year : year - 399) / 400;
+  int64_t year_of_era = year - era * 400;
+  int64_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  return era * 146097 + day_of_era - 719468;
+}
+
+/** Check that count more points fit in a buffer, they are appended at buffer->size. */
+livox_status CheckPointBuffer(const LivoxPointBuffer *buffer, uint32_t count) {
+  if (buffer->x == NULL || buffer->y == NULL || buffer->z == NULL) {
+    return kStatusFailure;
+  }
+  if (buffer->size > buffer->capacity || count > buffer->capacity - buffer->size) {
+    return kStatusNotEnoughMemory;
+  }
+  return kStatusSuccess;
+}
+
+/**
+ * Flag count points, stride bytes apart, as kept unless zero or tagged; words is 3 for x/y/z and 1 for a depth. A
+ * spherical point with angles out of range counts as zero, angle_offset is negative for Cartesian points.
+ */
+void FlagPoints(const uint8_t *points,
+                uint32_t stride,
+                uint32_t count,
+                int zero_offset,
+                int words,
+                int angle_offset,
+                int tag_offset,
+                const LivoxPointFilter &filter,
+                uint8_t *keep,
+                uint32_t step) {
+  for (uint32_t i = 0; i < count; i++) {
+    const uint8_t *point = points + i * stride;
+    uint32_t bits = 0;
+    for (int w = 0; w < words; w++) {
+      bits |= LoadUint32(point + zero_offset + 4 * w);
+    }
+    if (angle_offset >= 0 && !ValidAngles(LoadUint16(point + angle_offset), LoadUint16(point + angle_offset + 2))) {
+      bits = 0;
+    }
+    bool dropped = (filter.drop_zero && bits == 0) || (tag_offset >= 0 && (point[tag_offset] & filter.tag_mask));
+    keep[i * step] = !dropped;
+  }
+}
+
+typedef uint32_t (*CompactKernel)(LivoxPointBuffer *, uint32_t, const uint8_t *, uint32_t);
+
+/** Branch free compaction, the store is unconditional and only the output position depends on the flag. */
+uint32_t CompactPointsScalar(LivoxPointBuffer *buffer, uint32_t begin, const uint8_t *keep, uint32_t keep_stride) {
+  uint32_t out = begin;
+  for (uint32_t i = begin; i < buffer->size; i++) {
+    uint32_t flag = keep[(i - begin) * keep_stride] != 0;
+    buffer->x[out] = buffer->x[i];
+    buffer->y[out] = buffer->y[i];
+    buffer->z[out] = buffer->z[i];
+    if (buffer->reflectivity) {
+      buffer->reflectivity[out] = buffer->reflectivity[i];
+    }
+    if (buffer->tag) {
+      buffer->tag[out] = buffer->tag[i];
+    }
+    if (buffer->timestamp) {
+      buffer->timestamp[out] = buffer->timestamp[i];
+    }
+    out += flag;
+  }
+  return out;
+}
+
+#ifdef LIVOX_X86_DISPATCH
+/** Lane permutations moving the lanes flagged in an 8 bit mask to the front, and 4 bit masks for 64 bit lanes. */
+struct CompactTable {
+  int32_t lanes32[256][8];
+  int32_t lanes64[16][8];
+
+  CompactTable() {
+    for (uint32_t mask = 0; mask < 256; mask++) {
+      uint32_t n = 0;
+      for (uint32_t lane = 0; lane < 8; lane++) {
+        if (mask & (1u << lane)) {
+          lanes32[mask][n++] = lane;
+        }
+      }
+      for (; n < 8; n++) {
+        lanes32[mask][n] = 0;
+      }
+    }
+    for (uint32_t mask = 0; mask < 16; mask++) {
+      uint32_t n = 0;
+      for (uint32_t lane = 0; lane < 4; lane++) {
+        if (mask & (1u << lane)) {
+          lanes64[mask][n++] = 2 * lane;
+          lanes64[mask][n++] = 2 * lane + 1;
+        }
+      }
+      for (; n < 8; n++) {
+        lanes64[mask][n] = 0;
+      }
+    }
+  }
+};
+
+const CompactTable &compact_table() {
+  static const CompactTable table;
+  return table;
+}
+
+/**
+ * Compact eight points per step with lane permutations. The eight lane stores land at or below the points being
+ * read, so they only overwrite points already loaded.
+ */
+__attribute__((target("avx2,popcnt"))) uint32_t CompactPointsAvx2(LivoxPointBuffer *buffer,
+                                                                   uint32_t begin,
+                                                                   const uint8_t *keep,
+                                                                   uint32_t keep_stride) {
+  const CompactTable &table = compact_table();
+  float *x = buffer->x;
+  float *y = buffer->y;
+  float *z = buffer->z;
+  uint64_t *timestamp = buffer->timestamp;
+  uint32_t out = begin;
+  uint32_t i = begin;
+  for (; i + 8 <= buffer->size; i += 8) {
+    const uint8_t *flags = keep + (i - begin) * keep_stride;
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < 8; lane++) {
+      mask |= static_cast<uint32_t>(flags[lane * keep_stride] != 0) << lane;
+    }
+    if (mask == 0xFF && out == i) {
+      out += 8;
+      continue;
+    }
+    __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(table.lanes32[mask]));
+    _mm256_storeu_ps(x + out, _mm256_permutevar8x32_ps(_mm256_loadu_ps(x + i), lanes));
+    _mm256_storeu_ps(y + out, _mm256_permutevar8x32_ps(_mm256_loadu_ps(y + i), lanes));
+    _mm256_storeu_ps(z + out, _mm256_permutevar8x32_ps(_mm256_loadu_ps(z + i), lanes));
+    if (timestamp) {
+      __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(timestamp + i));
+      __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(timestamp + i + 4));
+      uint32_t low_count = _mm_popcnt_u32(mask & 0xF);
+      low = _mm256_permutevar8x32_epi32(
+          low, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(table.lanes64[mask & 0xF])));
+      high = _mm256_permutevar8x32_epi32(
+          high, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(table.lanes64[mask >> 4])));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(timestamp + out), low);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(timestamp + out + low_count), high);
+    }
+    uint32_t n = out;
+    for (uint32_t lane = 0; lane < 8; lane++) {
+      if (buffer->reflectivity) {
+        buffer->reflectivity[n] = buffer->reflectivity[i + lane];
+      }
+      if (buffer->tag) {
+        buffer->tag[n] = buffer->tag[i + lane];
+      }
+      n += (mask >> lane) & 1;
+    }
+    out += _mm_popcnt_u32(mask);
+  }
+  if (i == buffer->size) {
+    return out;
+  }
+  // Shift the tail behind the compacted points, then compact it in place.
+  uint32_t tail = buffer->size - i;
+  LivoxPointBuffer rest = *buffer;
+  uint32_t removed = i - out;
+  if (removed > 0) {
+    memmove(x + out, x + i, tail * sizeof(float));
+    memmove(y + out, y + i, tail * sizeof(float));
+    memmove(z + out, z + i, tail * sizeof(float));
+    if (buffer->reflectivity) {
+      memmove(buffer->reflectivity + out, buffer->reflectivity + i, tail);
+    }
+    if (buffer->tag) {
+      memmove(buffer->tag + out, buffer->tag + i, tail);
+    }
+    if (timestamp) {
+      memmove(timestamp + out, timestamp + i, tail * sizeof(uint64_t));
+    }
+  }
+  rest.size = out + tail;
+  return CompactPointsScalar(&rest, out, keep + (i - begin) * keep_stride, keep_stride);
+}
+#endif
+
+CompactKernel SelectCompactKernel() {
+#ifdef LIVOX_X86_DISPATCH
+  if (simd_level() >= kSimdAvx2 && __builtin_cpu_supports("popcnt")) {
+    return CompactPointsAvx2;
+  }
+#endif
+  return CompactPointsScalar;
+}
+
+}  // namespace
+
+SimdLevel SupportedSimdLevel() {
+#ifdef LIVOX_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return kSimdAvx2;
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    return kSimdSse41;
+  }
+#endif
+  return kSimdScalar;
+}
+
+void SetSimdLevel(SimdLevel level) {
+  simd_level() = std::min(level, SupportedSimdLevel());
+}
+
+const PointTransform &IdentityTransform() {
+  static const PointTransform identity = {{{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}, {0.0f, 0.0f, 0.0f}};
+  return identity;
+}
+
+PointTransform MakePointTransform(float roll, float pitch, float yaw, int32_t x, int32_t y, int32_t z) {
+  const double kDegreeToRadian = M_PI / 180.0;
+  double cr = cos(roll * kDegreeToRadian);
+  double sr = sin(roll * kDegreeToRadian);
+  double cp = cos(pitch * kDegreeToRadian);
+  double sp = sin(pitch * kDegreeToRadian);
+  double cy = cos(yaw * kDegreeToRadian);
+  double sy = sin(yaw * kDegreeToRadian);
+  // rotation = Rz(yaw) * Ry(pitch) * Rx(roll).
+  PointTransform t = {{{static_cast<float>(cy * cp),
+                        static_cast<float>(cy * sp * sr - sy * cr),
+                        static_cast<float>(cy * sp * cr + sy * sr)},
+                       {static_cast<float>(sy * cp),
+                        static_cast<float>(sy * sp * sr + cy * cr),
+                        static_cast<float>(sy * sp * cr - cy * sr)},
+                       {static_cast<float>(-sp), static_cast<float>(cp * sr), static_cast<float>(cp * cr)}},
+                      {x * kMillimetreToMetre, y * kMillimetreToMetre, z * kMillimetreToMetre}};
+  return t;
+}
+
+void ConvertCartesian(const PointTransform &transform,
+                      const uint8_t *points,
+                      uint32_t stride,
+                      uint32_t count,
+                      float *x,
+                      float *y,
+                      float *z) {
+  CartesianKernel kernel = SelectCartesianKernel();
+  kernel(transform, points, stride, count, x, y, z);
+}
+
+livox_status GetPacketTimeBase(const LivoxEthPacket *packet, LivoxPacketTimeBase *time) {
+  if (packet == NULL || time == NULL || packet->data_type >= kMaxPointDataType) {
+    return kStatusFailure;
+  }
+  if (packet->timestamp_type == kTimestampTypePpsGps) {
+    LidarSetUtcSyncTimeRequest utc;
+    memcpy(&utc, packet->timestamp, sizeof(utc));
+    if (utc.month < 1 || utc.month > 12 || utc.day < 1 || utc.day > 31 || utc.hour > 23) {
+      return kStatusFailure;
+    }
+    int64_t days = DaysFromCivil(2000 + utc.year, utc.month, utc.day);
+    time->timestamp = (static_cast<uint64_t>(days) * 24 + utc.hour) * 3600000000000ULL +
+                      static_cast<uint64_t>(utc.mircrosecond) * 1000;
+  } else {
+    memcpy(&time->timestamp, packet->timestamp, sizeof(time->timestamp));
+  }
+  time->interval = PointIntervalOf(packet->data_type);
+  bool dual = packet->data_type == kDualExtendCartesian || packet->data_type == kDualExtendSpherical;
+  time->points_per_interval = dual ? 2 : 1;
+  return kStatusSuccess;
+}
+
+livox_status ComputePointTimestamps(const LivoxEthPacket *packet,
+                                    uint32_t data_num,
+                                    uint64_t *timestamps,
+                                    uint32_t capacity) {
+  LivoxPacketTimeBase time;
+  livox_status status = GetPacketTimeBase(packet, &time);
+  if (status != kStatusSuccess) {
+    return status;
+  }
+  uint32_t count = data_num * time.points_per_interval;
+  if (timestamps == NULL || count > capacity) {
+    return kStatusNotEnoughMemory;
+  }
+  FillTimestamps(time, count, timestamps);
+  return kStatusSuccess;
+}
+
+livox_status ConvertPacket(const LivoxEthPacket *packet,
+                           uint32_t data_num,
+                           const PointTransform *transform,
+                           LivoxPointBuffer *buffer) {
+  if (packet == NULL || buffer == NULL) {
+    return kStatusFailure;
+  }
+  const PointTransform &t = transform ? *transform : IdentityTransform();
+
+  uint8_t data_type = packet->data_type;
+  uint32_t count = data_num;
+  if (data_type == kDualExtendCartesian || data_type == kDualExtendSpherical) {
+    count = data_num * 2;
+  } else if (data_type == kImu || data_type >= kMaxPointDataType) {
+    return kStatusNotSupported;
+  }
+  livox_status status = CheckPointBuffer(buffer, count);
+  if (status != kStatusSuccess) {
+    return status;
+  }
+  LivoxPacketTimeBase time;
+  if (buffer->timestamp) {
+    status = GetPacketTimeBase(packet, &time);
+    if (status != kStatusSuccess) {
+      return status;
+    }
+    FillTimestamps(time, count, buffer->timestamp + buffer->size);
+  }
+
+  const uint8_t *points = packet->data;
+  uint32_t offset = buffer->size;
+  float *x = buffer->x + offset;
+  float *y = buffer->y + offset;
+  float *z = buffer->z + offset;
+  uint8_t *reflectivity = buffer->reflectivity ? buffer->reflectivity + offset : NULL;
+  uint8_t *tag = buffer->tag ? buffer->tag + offset : NULL;
+  switch (data_type) {
+    case kCartesian:
+      ConvertCartesian(t, points, sizeof(LivoxRawPoint), count, x, y, z);
+      CopyReflectivityAndTag(points, sizeof(LivoxRawPoint), count, 12, -1, 1, reflectivity, tag);
+      break;
+    case kExtendCartesian:
+    case kDualExtendCartesian:
+      // Both returns of a dual point share the extended point layout, so they convert as two consecutive points.
+      ConvertCartesian(t, points, sizeof(LivoxExtendRawPoint), count, x, y, z);
+      CopyReflectivityAndTag(points, sizeof(LivoxExtendRawPoint), count, 12, 13, 1, reflectivity, tag);
+      break;
+    case kSpherical:
+      ConvertSpherical(t, points, sizeof(LivoxSpherPoint), 0, 4, count, x, y, z);
+      CopyReflectivityAndTag(points, sizeof(LivoxSpherPoint), count, 8, -1, 1, reflectivity, tag);
+      break;
+    case kExtendSpherical:
+      ConvertSpherical(t, points, sizeof(LivoxExtendSpherPoint), 0, 4, count, x, y, z);
+      CopyReflectivityAndTag(points, sizeof(LivoxExtendSpherPoint), count, 8, 9, 1, reflectivity, tag);
+      break;
+    case kDualExtendSpherical:
+      ConvertDualSpherical(t, points, data_num, x, y, z);
+      CopyReflectivityAndTag(points, sizeof(LivoxDualExtendSpherPoint), data_num, 8, 9, 2, reflectivity, tag);
+      CopyReflectivityAndTag(points,
+                             sizeof(LivoxDualExtendSpherPoint),
+                             data_num,
+                             14,
+                             15,
+                             2,
+                             reflectivity ? reflectivity + 1 : NULL,
+                             tag ? tag + 1 : NULL);
+      break;
+    default:
+      return kStatusNotSupported;
+  }
+  buffer->size += count;
+  return kStatusSuccess;
+}
+
+livox_status ConvertDualPacket(const LivoxEthPacket *packet,
+                               uint32_t data_num,
+                               const PointTransform *transform,
+                               LivoxPointBuffer *first,
+                               LivoxPointBuffer *second) {
+  static const uint32_t kChunkSize = 64;
+  if (packet == NULL || (first == NULL && second == NULL)) {
+    return kStatusFailure;
+  }
+  const PointTransform &t = transform ? *transform : IdentityTransform();
+  if (packet->data_type != kDualExtendCartesian && packet->data_type != kDualExtendSpherical) {
+    return kStatusNotSupported;
+  }
+  LivoxPointBuffer *buffers[2] = {first, second};
+  float *out[2][3];
+  uint8_t *reflectivity[2];
+  uint8_t *tag[2];
+  // Returns without a buffer are converted into a scratch chunk and dropped.
+  float scratch[3][kChunkSize];
+  LivoxPacketTimeBase time;
+  bool has_time = false;
+  for (int r = 0; r < 2; r++) {
+    LivoxPointBuffer *buffer = buffers[r];
+    if (buffer == NULL) {
+      continue;
+    }
+    livox_status status = CheckPointBuffer(buffer, data_num);
+    if (status != kStatusSuccess) {
+      return status;
+    }
+    if (buffer->timestamp && !has_time) {
+      status = GetPacketTimeBase(packet, &time);
+      if (status != kStatusSuccess) {
+        return status;
+      }
+      // Every point of a single return has its own sample.
+      time.points_per_interval = 1;
+      has_time = true;
+    }
+    uint32_t offset = buffer->size;
+    out[r][0] = buffer->x + offset;
+    out[r][1] = buffer->y + offset;
+    out[r][2] = buffer->z + offset;
+    reflectivity[r] = buffer->reflectivity ? buffer->reflectivity + offset : NULL;
+    tag[r] = buffer->tag ? buffer->tag + offset : NULL;
+  }
+
+  const uint8_t *points = packet->data;
+  if (packet->data_type == kDualExtendCartesian) {
+    const uint32_t stride = sizeof(LivoxDualExtendRawPoint);
+    DualCartesianKernel kernel = SelectDualCartesianKernel();
+    for (uint32_t done = 0; done < data_num; done += kChunkSize) {
+      uint32_t n = std::min(kChunkSize, data_num - done);
+      float *chunk[2][3];
+      for (int r = 0; r < 2; r++) {
+        for (int axis = 0; axis < 3; axis++) {
+          chunk[r][axis] = buffers[r] ? out[r][axis] + done : scratch[axis];
+        }
+      }
+      kernel(t, points + done * stride, n, chunk[0], chunk[1]);
+    }
+    for (int r = 0; r < 2; r++) {
+      if (buffers[r]) {
+        uint32_t base = r == 0 ? 0 : offsetof(LivoxDualExtendRawPoint, x2);
+        CopyReflectivityAndTag(points, stride, data_num, base + 12, base + 13, 1, reflectivity[r], tag[r]);
+      }
+    }
+  } else {
+    const uint32_t stride = sizeof(LivoxDualExtendSpherPoint);
+    for (int r = 0; r < 2; r++) {
+      if (buffers[r] == NULL) {
+        continue;
+      }
+      uint32_t depth_offset = r == 0 ? offsetof(LivoxDualExtendSpherPoint, depth1)
+                                     : offsetof(LivoxDualExtendSpherPoint, depth2);
+      ConvertSpherical(t, points, stride, depth_offset, 0, data_num, out[r][0], out[r][1], out[r][2]);
+      CopyReflectivityAndTag(points, stride, data_num, depth_offset + 4, depth_offset + 5, 1, reflectivity[r],
+                             tag[r]);
+    }
+  }
+  for (int r = 0; r < 2; r++) {
+    if (buffers[r]) {
+      if (buffers[r]->timestamp) {
+        FillTimestamps(time, data_num, buffers[r]->timestamp + buffers[r]->size);
+      }
+      buffers[r]->size += data_num;
+    }
+  }
+  return kStatusSuccess;
+}
+
+uint32_t SphericalToCartesianPacket(const LivoxEthPacket *src,
+                                    uint32_t data_num,
+                                    LivoxEthPacket *dst,
+                                    uint32_t dst_capacity) {
+  uint8_t data_type = kMaxPointDataType;
+  uint32_t point_size = 0;
+  uint32_t count = data_num;
+  switch (src->data_type) {
+    case kSpherical:
+      data_type = kCartesian;
+      point_size = sizeof(LivoxRawPoint);
+      break;
+    case kExtendSpherical:
+      data_type = kExtendCartesian;
+      point_size = sizeof(LivoxExtendRawPoint);
+      break;
+    case kDualExtendSpherical:
+      // A dual Cartesian point is two extended points back to back.
+      data_type = kDualExtendCartesian;
+      point_size = sizeof(LivoxExtendRawPoint);
+      count = data_num * 2;
+      break;
+    default:
+      return 0;
+  }
+  uint32_t size = offsetof(LivoxEthPacket, data) + count * point_size;
+  if (count > kMaxPacketPoints || size > dst_capacity) {
+    return 0;
+  }
+
+  float x[kMaxPacketPoints];
+  float y[kMaxPacketPoints];
+  float z[kMaxPacketPoints];
+  uint8_t reflectivity[kMaxPacketPoints];
+  uint8_t tag[kMaxPacketPoints];
+  LivoxPointBuffer buffer = {x, y, z, reflectivity, tag, NULL, kMaxPacketPoints, 0};
+  if (ConvertPacket(src, data_num, NULL, &buffer) != kStatusSuccess) {
+    return 0;
+  }
+
+  memcpy(dst, src, offsetof(LivoxEthPacket, data));
+  dst->data_type = data_type;
+  uint8_t *out = dst->data;
+  for (uint32_t i = 0; i < count; i++, out += point_size) {
+    int32_t xyz[3] = {static_cast<int32_t>(lrintf(x[i] * 1000.0f)),
+                      static_cast<int32_t>(lrintf(y[i] * 1000.0f)),
+                      static_cast<int32_t>(lrintf(z[i] * 1000.0f))};
+    memcpy(out, xyz, sizeof(xyz));
+    out[12] = reflectivity[i];
+    if (point_size == sizeof(LivoxExtendRawPoint)) {
+      out[13] = tag[i];
+    }
+  }
+  return size;
+}
+
+livox_status FilterPacketPoints(const LivoxEthPacket *packet,
+                                uint32_t data_num,
+                                const LivoxPointFilter &filter,
+                                uint8_t *keep,
+                                uint32_t capacity,
+                                uint32_t *kept) {
+  if (packet == NULL || keep == NULL || kept == NULL) {
+    return kStatusFailure;
+  }
+  uint8_t data_type = packet->data_type;
+  uint32_t count = data_num;
+  if (data_type == kDualExtendCartesian || data_type == kDualExtendSpherical) {
+    count = data_num * 2;
+  } else if (data_type == kImu || data_type >= kMaxPointDataType) {
+    return kStatusNotSupported;
+  }
+  if (count > capacity) {
+    return kStatusNotEnoughMemory;
+  }
+
+  const uint8_t *points = packet->data;
+  switch (data_type) {
+    case kCartesian:
+      FlagPoints(points, sizeof(LivoxRawPoint), count, 0, 3, -1, -1, filter, keep, 1);
+      break;
+    case kExtendCartesian:
+    case kDualExtendCartesian:
+      FlagPoints(points, sizeof(LivoxExtendRawPoint), count, 0, 3, -1, 13, filter, keep, 1);
+      break;
+    case kSpherical:
+      FlagPoints(points, sizeof(LivoxSpherPoint), count, 0, 1, 4, -1, filter, keep, 1);
+      break;
+    case kExtendSpherical:
+      FlagPoints(points, sizeof(LivoxExtendSpherPoint), count, 0, 1, 4, 9, filter, keep, 1);
+      break;
+    case kDualExtendSpherical:
+      FlagPoints(points, sizeof(LivoxDualExtendSpherPoint), data_num, 4, 1, 0, 9, filter, keep, 2);
+      FlagPoints(points, sizeof(LivoxDualExtendSpherPoint), data_num, 10, 1, 0, 15, filter, keep + 1, 2);
+      break;
+    default:
+      return kStatusNotSupported;
+  }
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    n += keep[i];
+  }
+  *kept = n;
+  return kStatusSuccess;
+}
+
+uint32_t CompactPoints(LivoxPointBuffer *buffer, uint32_t begin, const uint8_t *keep, uint32_t keep_stride) {
+  if (buffer == NULL || keep == NULL || begin >= buffer->size) {
+    return 0;
+  }
+  CompactKernel kernel = SelectCompactKernel();
+  uint32_t size = kernel(buffer, begin, keep, keep_stride);
+  uint32_t removed = buffer->size - size;
+  buffer->size = size;
+  return removed;
+}
+
+livox_status ConvertPackets(LivoxEthPacket *const *packets,
+                            const uint32_t *data_nums,
+                            uint32_t packet_num,
+                            const PointTransform *transform,
+                            LivoxPointBuffer *buffer) {
+  if (packets == NULL || data_nums == NULL) {
+    return kStatusFailure;
+  }
+  for (uint32_t i = 0; i < packet_num; i++) {
+    livox_status status = ConvertPacket(packets[i], data_nums[i], transform, buffer);
+    if (status != kStatusSuccess && status != kStatusNotSupported) {
+      return status;
+    }
+  }
+  return kStatusSuccess;
+}
+
+}  // namespace livox
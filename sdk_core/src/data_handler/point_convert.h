@@ -0,0 +1,159 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_POINT_CONVERT_H_
+#define LIVOX_POINT_CONVERT_H_
+
+#include <stdint.h>
+#include "livox_def.h"
+
+namespace livox {
+
+/** Rigid transform applied to the points as they are converted, p' = rotation * p + translation, in metres. */
+struct PointTransform {
+  float rotation[3][3];
+  float translation[3];
+};
+
+const PointTransform &IdentityTransform();
+
+/** Instruction sets the point kernels may use, in increasing order. */
+enum SimdLevel { kSimdScalar, kSimdSse41, kSimdAvx2 };
+
+/** Highest \ref SimdLevel the cpu supports, the kernels use it by default. */
+SimdLevel SupportedSimdLevel();
+
+/**
+ * Limit the point kernels to level, capped at SupportedSimdLevel(). Used to check the vector kernels against the
+ * scalar ones; not thread safe, set it while no points are converted.
+ */
+void SetSimdLevel(SimdLevel level);
+
+/** Most points a 1500 byte data packet can hold, two per dual return spherical point. */
+const uint32_t kMaxPacketPoints = 1500 / sizeof(LivoxDualExtendSpherPoint) * 2;
+
+/**
+ * Build the transform of extrinsic parameters, with the rotation Rz(yaw) * Ry(pitch) * Rx(roll).
+ * @param roll, pitch, yaw angles in degrees.
+ * @param x, y, z translation in mm.
+ */
+PointTransform MakePointTransform(float roll, float pitch, float yaw, int32_t x, int32_t y, int32_t z);
+
+/**
+ * Append the points of a packet to a structure-of-arrays buffer in metres.
+ * @param packet the packet.
+ * @param data_num number of points in the packet.
+ * @param transform transform applied to every point, NULL for none.
+ * @param buffer the buffer to append to.
+ * @return kStatusSuccess, kStatusNotSupported for a point format that cannot be converted or
+ * kStatusNotEnoughMemory if the points do not fit in the buffer.
+ */
+livox_status ConvertPacket(const LivoxEthPacket *packet,
+                           uint32_t data_num,
+                           const PointTransform *transform,
+                           LivoxPointBuffer *buffer);
+
+/** Append a batch of packets, skipping the packets in formats that cannot be converted. */
+livox_status ConvertPackets(LivoxEthPacket *const *packets,
+                            const uint32_t *data_nums,
+                            uint32_t packet_num,
+                            const PointTransform *transform,
+                            LivoxPointBuffer *buffer);
+
+/** Sampling time of the points of a packet, the timestamp normalized to ns. */
+livox_status GetPacketTimeBase(const LivoxEthPacket *packet, LivoxPacketTimeBase *time);
+
+/**
+ * Write the sampling time in ns of every point of a packet, both returns of a dual return point get the same time.
+ * @param capacity number of entries of timestamps.
+ * @return kStatusSuccess, kStatusFailure for a malformed timestamp or kStatusNotEnoughMemory if the points do not
+ * fit.
+ */
+livox_status ComputePointTimestamps(const LivoxEthPacket *packet,
+                                    uint32_t data_num,
+                                    uint64_t *timestamps,
+                                    uint32_t capacity);
+
+/**
+ * Split the two returns of a dual return packet into separate buffers, data_num points are appended to each.
+ * @param first buffer of the first returns, NULL to skip them.
+ * @param second buffer of the second returns, NULL to skip them.
+ * @return kStatusSuccess, kStatusNotSupported if the packet is not a dual return packet or kStatusNotEnoughMemory
+ * if the points do not fit, in which case neither buffer is changed.
+ */
+livox_status ConvertDualPacket(const LivoxEthPacket *packet,
+                               uint32_t data_num,
+                               const PointTransform *transform,
+                               LivoxPointBuffer *first,
+                               LivoxPointBuffer *second);
+
+/**
+ * Flag the points of a packet kept by a filter, in the order ConvertPacket appends them.
+ * @param keep receives 1 for a kept point and 0 for a dropped one, holds at least capacity flags.
+ * @param kept receives the number of kept points.
+ * @return kStatusSuccess, kStatusNotSupported for a packet without points or kStatusNotEnoughMemory if the flags do
+ * not fit.
+ */
+livox_status FilterPacketPoints(const LivoxEthPacket *packet,
+                                uint32_t data_num,
+                                const LivoxPointFilter &filter,
+                                uint8_t *keep,
+                                uint32_t capacity,
+                                uint32_t *kept);
+
+/**
+ * Remove the points [begin, buffer->size) of a buffer whose flag is 0, keeping the order of the others. The flag of
+ * point begin + i is keep[i * keep_stride].
+ * @return number of removed points.
+ */
+uint32_t CompactPoints(LivoxPointBuffer *buffer, uint32_t begin, const uint8_t *keep, uint32_t keep_stride);
+
+/**
+ * Rewrite a spherical packet in the matching Cartesian format: kSpherical becomes kCartesian, kExtendSpherical
+ * becomes kExtendCartesian and kDualExtendSpherical becomes kDualExtendCartesian. The header is kept.
+ * @param src the spherical packet.
+ * @param data_num number of points in the packet.
+ * @param dst destination packet of dst_capacity bytes.
+ * @return size of the destination packet, 0 if src is not spherical or dst is too small.
+ */
+uint32_t SphericalToCartesianPacket(const LivoxEthPacket *src,
+                                    uint32_t data_num,
+                                    LivoxEthPacket *dst,
+                                    uint32_t dst_capacity);
+
+/**
+ * Convert packed int32 millimetre x/y/z triples, stride bytes apart, into float metres and transform them while
+ * they are in registers. Uses the widest instruction set the cpu supports.
+ */
+void ConvertCartesian(const PointTransform &transform,
+                      const uint8_t *points,
+                      uint32_t stride,
+                      uint32_t count,
+                      float *x,
+                      float *y,
+                      float *z);
+
+}  // namespace livox
+
+#endif  // LIVOX_POINT_CONVERT_H_
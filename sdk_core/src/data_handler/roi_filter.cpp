@@ -0,0 +1,340 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "roi_filter.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "point_convert.h"
+
+namespace livox {
+
+namespace {
+
+const float kPi = 3.14159265358979f;
+
+inline int32_t LoadInt32(const uint8_t *p) {
+  int32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint16_t LoadUint16(const uint8_t *p) {
+  uint16_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+/** Sign of the cross product of b - a and p - a, which side of the line through a and b p lies on. */
+inline float Side(float ax, float ay, float bx, float by, float px, float py) {
+  return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+/** Whether a segment crosses an axis aligned rectangle its bounding box overlaps. */
+bool SegmentCrossesCell(float ax, float ay, float bx, float by, float x0, float y0, float x1, float y1) {
+  float corners[4] = {Side(ax, ay, bx, by, x0, y0),
+                      Side(ax, ay, bx, by, x1, y0),
+                      Side(ax, ay, bx, by, x0, y1),
+                      Side(ax, ay, bx, by, x1, y1)};
+  bool positive = false;
+  bool negative = false;
+  for (int i = 0; i < 4; i++) {
+    positive = positive || corners[i] >= 0;
+    negative = negative || corners[i] <= 0;
+  }
+  return positive && negative;
+}
+
+}  // namespace
+
+RoiFilter::RoiFilter(const LivoxRoiConfig &config)
+    : has_range_(config.min_range > 0 || config.max_range > 0),
+      min_squared_range_(config.min_range * config.min_range),
+      max_squared_range_(config.max_range > 0 ? config.max_range * config.max_range : INFINITY),
+      has_azimuth_(config.azimuth_begin != config.azimuth_end),
+      azimuth_begin_(0),
+      azimuth_span_(0),
+      grid_x_(0),
+      grid_y_(0),
+      inverse_cell_(0),
+      grid_width_(0),
+      grid_height_(0) {
+  if (has_azimuth_) {
+    float begin = fmodf(config.azimuth_begin, 360.0f);
+    begin = begin < 0 ? begin + 360.0f : begin;
+    float span = fmodf(config.azimuth_end - config.azimuth_begin, 360.0f);
+    span = span <= 0 ? span + 360.0f : span;
+    azimuth_begin_ = begin * kPi / 180;
+    azimuth_span_ = span * kPi / 180;
+    float end = azimuth_begin_ + azimuth_span_;
+    begin_direction_[0] = cosf(azimuth_begin_);
+    begin_direction_[1] = sinf(azimuth_begin_);
+    end_direction_[0] = cosf(end);
+    end_direction_[1] = sinf(end);
+  }
+
+  for (uint32_t i = 0; i < config.shape_count; i++) {
+    const LivoxRoiShape &shape = config.shapes[i];
+    Prism prism;
+    if (shape.type == kRoiShapeBox) {
+      float x[4] = {shape.min[0], shape.max[0], shape.max[0], shape.min[0]};
+      float y[4] = {shape.min[1], shape.min[1], shape.max[1], shape.max[1]};
+      prism.x.assign(x, x + 4);
+      prism.y.assign(y, y + 4);
+    } else {
+      for (uint32_t v = 0; v < shape.vertex_count; v++) {
+        prism.x.push_back(shape.vertices[v][0]);
+        prism.y.push_back(shape.vertices[v][1]);
+      }
+    }
+    prism.z_min = shape.min[2];
+    prism.z_max = shape.max[2];
+    prisms_.push_back(prism);
+  }
+  if (!prisms_.empty()) {
+    BuildGrid();
+  }
+}
+
+bool RoiFilter::IsValid(const LivoxRoiConfig &config) {
+  if (config.shape_count > kMaxRoiShapes || (config.shape_count > 0 && config.shapes == NULL)) {
+    return false;
+  }
+  if (!(config.min_range >= 0) || !(config.max_range >= 0) ||
+      (config.max_range > 0 && config.max_range < config.min_range)) {
+    return false;
+  }
+  if (!isfinite(config.azimuth_begin) || !isfinite(config.azimuth_end)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < config.shape_count; i++) {
+    const LivoxRoiShape &shape = config.shapes[i];
+    if (!(shape.min[2] <= shape.max[2])) {
+      return false;
+    }
+    if (shape.type == kRoiShapeBox) {
+      if (!(shape.min[0] <= shape.max[0]) || !(shape.min[1] <= shape.max[1])) {
+        return false;
+      }
+    } else if (shape.type != kRoiShapePrism || shape.vertex_count < 3 || shape.vertex_count > kMaxRoiVertices) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void RoiFilter::BuildGrid() {
+  float x_min = INFINITY, y_min = INFINITY, x_max = -INFINITY, y_max = -INFINITY;
+  for (size_t s = 0; s < prisms_.size(); s++) {
+    x_min = std::min(x_min, *std::min_element(prisms_[s].x.begin(), prisms_[s].x.end()));
+    x_max = std::max(x_max, *std::max_element(prisms_[s].x.begin(), prisms_[s].x.end()));
+    y_min = std::min(y_min, *std::min_element(prisms_[s].y.begin(), prisms_[s].y.end()));
+    y_max = std::max(y_max, *std::max_element(prisms_[s].y.begin(), prisms_[s].y.end()));
+  }
+  float cell = std::max(std::max(x_max - x_min, y_max - y_min) / kGridSize, 1e-3f);
+  grid_x_ = x_min;
+  grid_y_ = y_min;
+  inverse_cell_ = 1.0f / cell;
+  grid_width_ = std::min(static_cast<uint32_t>((x_max - x_min) * inverse_cell_) + 1, kGridSize + 1);
+  grid_height_ = std::min(static_cast<uint32_t>((y_max - y_min) * inverse_cell_) + 1, kGridSize + 1);
+  inside_.assign(grid_width_ * grid_height_, 0);
+  boundary_.assign(grid_width_ * grid_height_, 0);
+
+  for (size_t s = 0; s < prisms_.size(); s++) {
+    const Prism &prism = prisms_[s];
+    uint32_t bit = 1u << s;
+    size_t n = prism.x.size();
+    // Cells crossed by an edge need the exact test.
+    for (size_t v = 0; v < n; v++) {
+      float ax = prism.x[v], ay = prism.y[v];
+      float bx = prism.x[(v + 1) % n], by = prism.y[(v + 1) % n];
+      uint32_t cx0 = static_cast<uint32_t>((std::min(ax, bx) - grid_x_) * inverse_cell_);
+      uint32_t cx1 = std::min(static_cast<uint32_t>((std::max(ax, bx) - grid_x_) * inverse_cell_), grid_width_ - 1);
+      uint32_t cy0 = static_cast<uint32_t>((std::min(ay, by) - grid_y_) * inverse_cell_);
+      uint32_t cy1 = std::min(static_cast<uint32_t>((std::max(ay, by) - grid_y_) * inverse_cell_), grid_height_ - 1);
+      for (uint32_t cy = cy0; cy <= cy1; cy++) {
+        for (uint32_t cx = cx0; cx <= cx1; cx++) {
+          float x0 = grid_x_ + cx * cell, y0 = grid_y_ + cy * cell;
+          if (SegmentCrossesCell(ax, ay, bx, by, x0, y0, x0 + cell, y0 + cell)) {
+            boundary_[cy * grid_width_ + cx] |= bit;
+          }
+        }
+      }
+    }
+    // The other cells are wholly inside or outside, their center tells which.
+    for (uint32_t cy = 0; cy < grid_height_; cy++) {
+      for (uint32_t cx = 0; cx < grid_width_; cx++) {
+        uint32_t index = cy * grid_width_ + cx;
+        if (!(boundary_[index] & bit) &&
+            InPolygon(prism, grid_x_ + (cx + 0.5f) * cell, grid_y_ + (cy + 0.5f) * cell)) {
+          inside_[index] |= bit;
+        }
+      }
+    }
+  }
+}
+
+bool RoiFilter::InPolygon(const Prism &prism, float x, float y) {
+  bool inside = false;
+  size_t n = prism.x.size();
+  for (size_t i = 0, j = n - 1; i < n; j = i++) {
+    if ((prism.y[i] > y) != (prism.y[j] > y) &&
+        x < (prism.x[j] - prism.x[i]) * (y - prism.y[i]) / (prism.y[j] - prism.y[i]) + prism.x[i]) {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+bool RoiFilter::InRange(float squared_range) const {
+  return squared_range >= min_squared_range_ && squared_range <= max_squared_range_;
+}
+
+bool RoiFilter::InAzimuth(float x, float y) const {
+  float after_begin = begin_direction_[0] * y - begin_direction_[1] * x;
+  float before_end = x * end_direction_[1] - y * end_direction_[0];
+  if (azimuth_span_ <= kPi) {
+    return after_begin >= 0 && before_end >= 0;
+  }
+  // A reflex sector is the complement of the sector from its end to its begin.
+  return after_begin >= 0 || before_end >= 0;
+}
+
+bool RoiFilter::InAzimuthAngle(float radians) const {
+  float offset = radians - azimuth_begin_;
+  if (offset < 0) {
+    offset += 2 * kPi;
+  }
+  return offset <= azimuth_span_;
+}
+
+void RoiFilter::FlagLimits(const LivoxEthPacket *packet, uint32_t data_num, uint8_t *keep) const {
+  if (!has_limits()) {
+    return;
+  }
+  const uint8_t *points = packet->data;
+  uint32_t stride = 0;
+  switch (packet->data_type) {
+    case kCartesian:
+      stride = sizeof(LivoxRawPoint);
+      break;
+    case kExtendCartesian:
+      stride = sizeof(LivoxExtendRawPoint);
+      break;
+    case kDualExtendCartesian:
+      // Both returns share the extended point layout.
+      stride = sizeof(LivoxExtendRawPoint);
+      data_num *= 2;
+      break;
+    case kSpherical:
+    case kExtendSpherical: {
+      stride = packet->data_type == kSpherical ? sizeof(LivoxSpherPoint) : sizeof(LivoxExtendSpherPoint);
+      for (uint32_t i = 0; i < data_num; i++) {
+        const uint8_t *point = points + i * stride;
+        float depth = LoadInt32(point) * 0.001f;
+        keep[i] &= (!has_range_ || InRange(depth * depth)) &&
+                   (!has_azimuth_ || InAzimuthAngle(LoadUint16(point + 6) * 0.01f));
+      }
+      return;
+    }
+    case kDualExtendSpherical:
+      for (uint32_t i = 0; i < data_num; i++) {
+        const uint8_t *point = points + i * sizeof(LivoxDualExtendSpherPoint);
+        bool azimuth = !has_azimuth_ || InAzimuthAngle(LoadUint16(point + 2) * 0.01f);
+        float first = static_cast<uint32_t>(LoadInt32(point + 4)) * 0.001f;
+        float second = static_cast<uint32_t>(LoadInt32(point + 10)) * 0.001f;
+        keep[2 * i] &= azimuth && (!has_range_ || InRange(first * first));
+        keep[2 * i + 1] &= azimuth && (!has_range_ || InRange(second * second));
+      }
+      return;
+    default:
+      return;
+  }
+  for (uint32_t i = 0; i < data_num; i++) {
+    const uint8_t *point = points + i * stride;
+    float x = LoadInt32(point) * 0.001f;
+    float y = LoadInt32(point + 4) * 0.001f;
+    float z = LoadInt32(point + 8) * 0.001f;
+    keep[i] &= (!has_range_ || InRange(x * x + y * y + z * z)) && (!has_azimuth_ || InAzimuth(x, y));
+  }
+}
+
+void RoiFilter::FlagShapes(const LivoxPointBuffer &points, uint32_t begin, uint32_t count, uint8_t *keep) const {
+  if (!has_shapes()) {
+    return;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    if (!keep[i]) {
+      continue;
+    }
+    float x = points.x[begin + i];
+    float y = points.y[begin + i];
+    float z = points.z[begin + i];
+    float fx = (x - grid_x_) * inverse_cell_;
+    float fy = (y - grid_y_) * inverse_cell_;
+    if (!(fx >= 0 && fy >= 0 && fx < grid_width_ && fy < grid_height_)) {
+      keep[i] = 0;
+      continue;
+    }
+    uint32_t cell = static_cast<uint32_t>(fy) * grid_width_ + static_cast<uint32_t>(fx);
+    bool inside = false;
+    for (uint32_t shapes = inside_[cell]; shapes != 0 && !inside; shapes &= shapes - 1) {
+      const Prism &prism = prisms_[__builtin_ctz(shapes)];
+      inside = z >= prism.z_min && z <= prism.z_max;
+    }
+    for (uint32_t shapes = boundary_[cell]; shapes != 0 && !inside; shapes &= shapes - 1) {
+      const Prism &prism = prisms_[__builtin_ctz(shapes)];
+      inside = z >= prism.z_min && z <= prism.z_max && InPolygon(prism, x, y);
+    }
+    keep[i] = inside;
+  }
+}
+
+uint32_t CropPoints(LivoxPointBuffer *points,
+                    uint32_t begin,
+                    const uint8_t *keep,
+                    uint32_t keep_stride,
+                    const RoiFilter *roi) {
+  if (points == NULL || begin >= points->size) {
+    return 0;
+  }
+  if (roi == NULL || !roi->has_shapes()) {
+    return keep ? CompactPoints(points, begin, keep, keep_stride) : 0;
+  }
+  uint32_t count = points->size - begin;
+  uint8_t stack_flags[kMaxPacketPoints];
+  std::vector<uint8_t> heap_flags;
+  uint8_t *flags = stack_flags;
+  if (count > kMaxPacketPoints) {
+    heap_flags.resize(count);
+    flags = &heap_flags[0];
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    flags[i] = keep ? keep[i * keep_stride] : 1;
+  }
+  roi->FlagShapes(*points, begin, count, flags);
+  return CompactPoints(points, begin, flags, 1);
+}
+
+}  // namespace livox
@@ -0,0 +1,102 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_ROI_FILTER_H_
+#define LIVOX_ROI_FILTER_H_
+
+#include <vector>
+#include "base/noncopyable.h"
+#include "livox_def.h"
+
+namespace livox {
+
+/**
+ * Region of interest of a device. The range and azimuth limits are tested on
+ * the raw packet, before the points are converted. The shapes are tested on
+ * the converted points: a grid over the shapes records for every cell the
+ * shapes covering it and the shapes whose outline crosses it, so only points
+ * in the cells on an outline need a point in polygon test.
+ */
+class RoiFilter : public noncopyable {
+ public:
+  explicit RoiFilter(const LivoxRoiConfig &config);
+
+  static bool IsValid(const LivoxRoiConfig &config);
+
+  bool has_limits() const { return has_range_ || has_azimuth_; }
+  bool has_shapes() const { return !prisms_.empty(); }
+
+  /** Clear the flags of the points of a packet outside the range and azimuth limits, in ConvertPacket order. */
+  void FlagLimits(const LivoxEthPacket *packet, uint32_t data_num, uint8_t *keep) const;
+  /** Clear the flags of the points [begin, begin + count) of a buffer outside every shape, keep[i] for point i. */
+  void FlagShapes(const LivoxPointBuffer &points, uint32_t begin, uint32_t count, uint8_t *keep) const;
+
+  static const uint32_t kGridSize = 128;
+
+ private:
+  struct Prism {
+    std::vector<float> x;
+    std::vector<float> y;
+    float z_min;
+    float z_max;
+  };
+
+  bool InRange(float squared_range) const;
+  bool InAzimuth(float x, float y) const;
+  bool InAzimuthAngle(float radians) const;
+  static bool InPolygon(const Prism &prism, float x, float y);
+  void BuildGrid();
+
+  std::vector<Prism> prisms_;
+  bool has_range_;
+  float min_squared_range_;
+  float max_squared_range_;
+  bool has_azimuth_;
+  float azimuth_begin_;
+  float azimuth_span_;
+  float begin_direction_[2];
+  float end_direction_[2];
+  float grid_x_;
+  float grid_y_;
+  float inverse_cell_;
+  uint32_t grid_width_;
+  uint32_t grid_height_;
+  std::vector<uint32_t> inside_;
+  std::vector<uint32_t> boundary_;
+};
+
+/**
+ * Remove the points [begin, points->size) of a buffer dropped by the point filter flags, keep_stride flags apart, or
+ * outside the shapes of a region of interest. Either may be NULL.
+ * @return number of removed points.
+ */
+uint32_t CropPoints(LivoxPointBuffer *points,
+                    uint32_t begin,
+                    const uint8_t *keep,
+                    uint32_t keep_stride,
+                    const RoiFilter *roi);
+
+}  // namespace livox
+
+#endif  // LIVOX_ROI_FILTER_H_
@@ -0,0 +1,165 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "voxel_filter.h"
+#include <math.h>
+#include <algorithm>
+
+namespace livox {
+
+const uint32_t VoxelFilter::kMaxLevel;
+
+VoxelFilter::VoxelFilter(const LivoxVoxelConfig &config, uint32_t max_voxels)
+    : config_(config),
+      max_voxels_(max_voxels),
+      level_scale_(config.leaf_size > 0 ? config.size_per_metre / config.leaf_size : 0),
+      mask_(0),
+      generation_(1) {
+  inverse_size_[0] = 0;
+  for (uint32_t level = 1; level <= kMaxLevel; level++) {
+    inverse_size_[level] = 1.0f / (config.leaf_size * level);
+  }
+  // Keep the table at most half full.
+  uint32_t slot_count = 16;
+  while (slot_count < 2 * max_voxels && slot_count < (1u << 31)) {
+    slot_count <<= 1;
+  }
+  Slot empty = {0, 0, 0, 0, 0, 0};
+  slots_.assign(slot_count, empty);
+  mask_ = slot_count - 1;
+  if (config.mode == kVoxelCentroid) {
+    sums_.resize(max_voxels);
+  }
+}
+
+void VoxelFilter::Add(LivoxPointBuffer *points, uint32_t begin) {
+  bool centroid = config_.mode == kVoxelCentroid;
+  uint32_t kept = begin;
+  for (uint32_t i = begin; i < points->size; i++) {
+    float x = points->x[i];
+    float y = points->y[i];
+    float z = points->z[i];
+    uint32_t level = 1;
+    if (level_scale_ > 0) {
+      float range = sqrtf(x * x + y * y + z * z);
+      level = std::min(1 + static_cast<uint32_t>(range * level_scale_), kMaxLevel);
+    }
+    float inverse = inverse_size_[level];
+    int32_t ix = static_cast<int32_t>(floorf(x * inverse));
+    int32_t iy = static_cast<int32_t>(floorf(y * inverse));
+    int32_t iz = static_cast<int32_t>(floorf(z * inverse));
+    uint32_t hash = (static_cast<uint32_t>(ix) * 73856093u) ^ (static_cast<uint32_t>(iy) * 19349663u) ^
+                    (static_cast<uint32_t>(iz) * 83492791u) ^ (level * 2654435761u);
+    uint32_t slot_index = (hash ^ (hash >> 16)) & mask_;
+    while (true) {
+      Slot &slot = slots_[slot_index];
+      if (slot.generation != generation_) {
+        break;
+      }
+      if (slot.x == ix && slot.y == iy && slot.z == iz && slot.level == level) {
+        break;
+      }
+      slot_index = (slot_index + 1) & mask_;
+    }
+
+    Slot &slot = slots_[slot_index];
+    if (slot.generation == generation_) {
+      if (centroid) {
+        Sum &sum = sums_[slot.index];
+        sum.x += x;
+        sum.y += y;
+        sum.z += z;
+        if (points->reflectivity) {
+          sum.reflectivity += points->reflectivity[i];
+        }
+        if (points->timestamp) {
+          sum.time_offset += points->timestamp[i] - points->timestamp[slot.index];
+        }
+        sum.count++;
+      }
+      continue;
+    }
+    if (kept >= max_voxels_) {
+      continue;
+    }
+
+    slot.x = ix;
+    slot.y = iy;
+    slot.z = iz;
+    slot.level = level;
+    slot.generation = generation_;
+    slot.index = kept;
+    if (kept != i) {
+      points->x[kept] = x;
+      points->y[kept] = y;
+      points->z[kept] = z;
+      if (points->reflectivity) {
+        points->reflectivity[kept] = points->reflectivity[i];
+      }
+      if (points->tag) {
+        points->tag[kept] = points->tag[i];
+      }
+      if (points->timestamp) {
+        points->timestamp[kept] = points->timestamp[i];
+      }
+    }
+    if (centroid) {
+      Sum sum = {x, y, z, points->reflectivity ? points->reflectivity[i] : 0u, 0, 1};
+      sums_[kept] = sum;
+    }
+    kept++;
+  }
+  points->size = kept;
+}
+
+void VoxelFilter::Finish(LivoxPointBuffer *points) {
+  if (config_.mode == kVoxelCentroid) {
+    for (uint32_t i = 0; i < points->size && i < sums_.size(); i++) {
+      const Sum &sum = sums_[i];
+      if (sum.count <= 1) {
+        continue;
+      }
+      float inverse_count = 1.0f / sum.count;
+      points->x[i] = sum.x * inverse_count;
+      points->y[i] = sum.y * inverse_count;
+      points->z[i] = sum.z * inverse_count;
+      if (points->reflectivity) {
+        points->reflectivity[i] = static_cast<uint8_t>(sum.reflectivity / sum.count);
+      }
+      if (points->timestamp) {
+        points->timestamp[i] += sum.time_offset / sum.count;
+      }
+    }
+  }
+  generation_++;
+  if (generation_ == 0) {
+    // Every slot may hold a stale generation after the wrap around, clear them once.
+    for (size_t i = 0; i < slots_.size(); i++) {
+      slots_[i].generation = 0;
+    }
+    generation_ = 1;
+  }
+}
+
+}  // namespace livox
@@ -0,0 +1,86 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef LIVOX_VOXEL_FILTER_H_
+#define LIVOX_VOXEL_FILTER_H_
+
+#include <vector>
+#include "base/noncopyable.h"
+#include "livox_def.h"
+
+namespace livox {
+
+/**
+ * Voxel grid downsampling of the points of a frame, done as the points are
+ * appended. The voxels are found in an open addressing table sized for the
+ * frame capacity and reset per frame by bumping a generation, so the cost of
+ * a frame depends on its points and nothing is allocated per frame. One point
+ * per voxel is kept in the buffer, in the order the voxels were first hit.
+ */
+class VoxelFilter : public noncopyable {
+ public:
+  VoxelFilter(const LivoxVoxelConfig &config, uint32_t max_voxels);
+
+  /**
+   * Fold the points [begin, points->size) into the voxels of the frame, points [0, begin) being the voxels found so
+   * far. The points of new voxels are moved down and points->size becomes the number of voxels.
+   */
+  void Add(LivoxPointBuffer *points, uint32_t begin);
+  /** Reduce the voxels of the frame to their centroid if configured, and start the next frame. */
+  void Finish(LivoxPointBuffer *points);
+
+  static const uint32_t kMaxLevel = 255;
+
+ private:
+  struct Slot {
+    int32_t x;
+    int32_t y;
+    int32_t z;
+    uint32_t level;
+    uint32_t generation;
+    uint32_t index;
+  };
+
+  struct Sum {
+    float x;
+    float y;
+    float z;
+    uint32_t reflectivity;
+    uint64_t time_offset;
+    uint32_t count;
+  };
+
+  LivoxVoxelConfig config_;
+  uint32_t max_voxels_;
+  float level_scale_;
+  float inverse_size_[kMaxLevel + 1];
+  std::vector<Slot> slots_;
+  uint32_t mask_;
+  uint32_t generation_;
+  std::vector<Sum> sums_;
+};
+
+}  // namespace livox
+
+#endif  // LIVOX_VOXEL_FILTER_H_
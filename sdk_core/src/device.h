@@ -136,7 +136,7 @@ private:
     /** data port number start offset. */
     static constexpr auto kDataPortOffset = 1000;
     /** sensor port number start offset. */
-    static constexpr auto kSensorPortOffset = 1000;
+    static constexpr auto kSensorPortOffset = 1500;
     static uint16_t _port_count;
     apr_socket_t *_sock;
     IOLoop *_loop;
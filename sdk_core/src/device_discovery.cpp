@@ -24,6 +24,7 @@
 
 #include "device_discovery.h"
 #include <algorithm>
+#include <boost/bind.hpp>
 #include <boost/thread/lock_guard.hpp>
 #include <boost/thread/locks.hpp>
 #include <iostream>
@@ -35,6 +36,7 @@
 #else
 #include "arpa/inet.h"
 #endif
+#include "base/instrumentation.h"
 #include "base/logging.h"
 #include "base/network_util.h"
 #include "command_handler/command_impl.h"
@@ -105,6 +107,17 @@ bool DeviceDiscovery::Start( IOLoop* loop )
 
 //=======================================================================================
 void DeviceDiscovery::OnData( apr_socket_t* sock, void * )
+{
+    ScopedLatency latency( instrumentation().command_delegate() );
+
+    // Read until the socket would block, the loop may be edge-triggered.
+    while ( ReceiveMessage( sock ) )
+        ;
+}
+//=======================================================================================
+
+//=======================================================================================
+bool DeviceDiscovery::ReceiveMessage( apr_socket_t* sock )
 {
     apr_sockaddr_t addr;
     uint32_t buf_size = 0;
@@ -120,10 +133,14 @@ void DeviceDiscovery::OnData( apr_socket_t* sock, void * )
 
     if ( rv != APR_SUCCESS )
     {
-        LOG_WARN( " Receive Failed {}", PrintAPRStatus(rv) );
-        return;
+        if ( !APR_STATUS_IS_EAGAIN( rv ) )
+            LOG_WARN( " Receive Failed {}", PrintAPRStatus(rv) );
+
+        return false;
     }
 
+    bool closed = false;
+
     CommPacket packet;
     memset( &packet, 0, sizeof( packet ) );
 
@@ -141,10 +158,12 @@ void DeviceDiscovery::OnData( apr_socket_t* sock, void * )
 
             DeviceInfo info = boost::get<2>( _connecting_devices[ sock ] );
 
+            _loop->CancelTimer( boost::get<1>( _connecting_devices[ sock ] ) );
             _loop->RemoveDelegate( sock, this );
             apr_socket_close( sock );
             apr_pool_destroy( boost::get<0>( _connecting_devices[ sock ] ) );
             _connecting_devices.erase( sock );
+            closed = true;
 
             if (packet.data == NULL)
                 continue;
@@ -163,29 +182,23 @@ void DeviceDiscovery::OnData( apr_socket_t* sock, void * )
             }
         }
     }
+
+    return !closed;
 }
 //=======================================================================================
 
 //=======================================================================================
-void DeviceDiscovery::OnTimer( const apr_time_t now )
+void DeviceDiscovery::OnHandshakeTimeout( apr_socket_t* sock )
 {
-    ConnectingDeviceMap::iterator ite = _connecting_devices.begin();
+    ConnectingDeviceMap::iterator ite = _connecting_devices.find( sock );
 
-    while ( ite != _connecting_devices.end() )
-    {
-        TupleAprDevice &device_tuple = ite->second;
-
-        if ( now - boost::get<1>( device_tuple ) > apr_time_from_msec( 500 ) )
-        {
-            _loop->RemoveDelegate( ite->first, this );
-            apr_socket_close( ite->first );
-            apr_pool_destroy( boost::get<0>( device_tuple ) );
-            _connecting_devices.erase( ite++ );
-        }
+    if ( ite == _connecting_devices.end() )
+        return;
 
-        else
-            ++ite;
-    }
+    _loop->RemoveDelegate( sock, this );
+    apr_socket_close( sock );
+    apr_pool_destroy( boost::get<0>( ite->second ) );
+    _connecting_devices.erase( ite );
 }
 //=======================================================================================
 
@@ -256,7 +269,10 @@ void DeviceDiscovery::OnBroadcast( const CommPacket& packet, apr_sockaddr_t* add
 
     lidar_info.cmd_port = kListenPort + kCmdPortOffset + _port_count;
     lidar_info.data_port = kListenPort + kDataPortOffset + _port_count;
-    lidar_info.sensor_port = kListenPort + kSensorPortOffset + _port_count;
+    // The hub data handler only listens on the data port, so its IMU data stays there.
+    lidar_info.sensor_port = ( device_info.dev_type == kDeviceTypeHub )
+                             ? lidar_info.data_port
+                             : kListenPort + kSensorPortOffset + _port_count;
     lidar_info.type = device_info.dev_type;
     lidar_info.state = kLidarStateUnknown;
     lidar_info.feature = kLidarFeatureNone;
@@ -284,8 +300,6 @@ void DeviceDiscovery::OnBroadcast( const CommPacket& packet, apr_sockaddr_t* add
 
     _loop->AddDelegate( cmd_sock, this );
 
-    OnTimer( apr_time_now() );
-
     boost::get<0>( _connecting_devices[ cmd_sock ] ) = pool;
     boost::get<2>( _connecting_devices[ cmd_sock ] ) = lidar_info;
 
@@ -307,6 +321,7 @@ void DeviceDiscovery::OnBroadcast( const CommPacket& packet, apr_sockaddr_t* add
         LOG_INFO( "LocalIP: {}", inet_ntoa(*( struct in_addr *)&local_ip ) );
         LOG_INFO( "Command Port: {}", lidar_info.cmd_port );
         LOG_INFO( "Data Port: {}", lidar_info.data_port );
+        LOG_INFO( "Sensor Port: {}", lidar_info.sensor_port );
 
         CommPacket packet;
         memset( &packet, 0, sizeof( packet ) );
@@ -340,7 +355,9 @@ void DeviceDiscovery::OnBroadcast( const CommPacket& packet, apr_sockaddr_t* add
             break;
         }
 
-        boost::get<1>( _connecting_devices[ cmd_sock ]) = apr_time_now();
+        boost::get<1>( _connecting_devices[ cmd_sock ] ) =
+            _loop->AddTimer( apr_time_now() + apr_time_from_msec( kHandshakeTimeout ),
+                             boost::bind( &DeviceDiscovery::OnHandshakeTimeout, this, cmd_sock ) );
         result = true;
 
     } while (0);
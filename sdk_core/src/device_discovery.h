@@ -47,7 +47,7 @@ namespace livox
  */
 class DeviceDiscovery : public noncopyable, IOLoop::IOLoopDelegate
 {
-    using TupleAprDevice = boost::tuple< apr_pool_t *, apr_time_t, DeviceInfo >;
+    using TupleAprDevice = boost::tuple< apr_pool_t *, IOLoop::TimerId, DeviceInfo >;
     using ConnectingDeviceMap = std::map< apr_socket_t *, TupleAprDevice >;
 
     //-----------------------------------------------------------------------------------
@@ -73,7 +73,6 @@ public:
    * @param client_data client data passed in IOLoop::AddDelegate
    */
     void OnData( apr_socket_t *, void* client_data );
-    void OnTimer( const apr_time_t now );
 
     //-----------------------------------------------------------------------------------
 
@@ -86,7 +85,9 @@ private:
     /** data port number start offset. */
     static constexpr auto kDataPortOffset = 1000;
     /** sensor port number start offset. */
-    static constexpr auto kSensorPortOffset = 1000;
+    static constexpr auto kSensorPortOffset = 1500;
+    /** time in ms to wait for the handshake ack. */
+    static constexpr auto kHandshakeTimeout = 500;
 
     static uint16_t _port_count;
 
@@ -103,6 +104,12 @@ private:
     //-----------------------------------------------------------------------------------
 
     void OnBroadcast( const CommPacket& packet, apr_sockaddr_t* addr );
+
+    /** Give up a device which did not answer the handshake in time. */
+    void OnHandshakeTimeout( apr_socket_t* sock );
+
+    /** Receive and handle one datagram, false if none was pending or the socket was closed. */
+    bool ReceiveMessage( apr_socket_t* sock );
 };
 //=======================================================================================
 
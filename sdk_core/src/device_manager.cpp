@@ -415,6 +415,14 @@ DeviceManager& device_manager()
 }
 //=======================================================================================
 
+//=======================================================================================
+static void OnSphericalCoordinateSet( livox_status status, uint8_t handle, uint8_t response, void* client_data )
+{
+    if ( status != kStatusSuccess || response != 0 )
+        LOG_WARN( "Failed to set spherical coordinate of device {}, status {}, response {}", handle, status, response );
+}
+//=======================================================================================
+
 //=======================================================================================
 void DeviceFound( const DeviceInfo& lidar_data )
 {
@@ -422,6 +430,13 @@ void DeviceFound( const DeviceInfo& lidar_data )
     command_handler().AddDevice( lidar_data );
     data_handler().AddDevice( lidar_data );
 
+    if ( device_manager().device_mode() == kDeviceModeLidar && data_handler().host_cartesian( lidar_data.handle ) )
+    {
+        livox_status status = SetSphericalCoordinate( lidar_data.handle, OnSphericalCoordinateSet, NULL );
+        if ( status != kStatusSuccess )
+            LOG_WARN( "Failed to send the spherical coordinate command to device {}, status {}", lidar_data.handle, status );
+    }
+
     if ( device_manager().device_mode() == kDeviceModeHub )
         device_manager().UpdateDevices( lidar_data, kEventHubConnectionChange );
 
@@ -26,6 +26,7 @@
 #include "apr_general.h"
 #include "command_handler/command_handler.h"
 #include "data_handler/data_handler.h"
+#include "base/instrumentation.h"
 #include "base/logging.h"
 #include "device_manager.h"
 
@@ -142,6 +143,38 @@ void Uninit()
 }
 //=======================================================================================
 
+//=======================================================================================
+livox_status SetIoLoopBackend( const IoLoopBackend backend )
+{
+    if ( is_initialized )
+        return kStatusFailure;
+
+    if ( !IOLoop::SetDefaultBackend( backend ) )
+        return ( backend == kIoLoopBackendEpoll ) ? kStatusNotSupported : kStatusFailure;
+
+    return kStatusSuccess;
+}
+//=======================================================================================
+
+//=======================================================================================
+void EnableInstrumentation( const bool enable, const uint32_t dump_interval )
+{
+    instrumentation().Enable( enable, dump_interval );
+}
+//=======================================================================================
+
+//=======================================================================================
+livox_status GetInstrumentationSnapshot( LivoxInstrumentation* snapshot )
+{
+    if ( snapshot == NULL )
+        return kStatusFailure;
+
+    instrumentation().Snapshot( snapshot );
+
+    return kStatusSuccess;
+}
+//=======================================================================================
+
 //=======================================================================================
 bool Start()
 {
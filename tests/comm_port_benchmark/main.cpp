@@ -0,0 +1,147 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+// Measure the command stream parser: a recorded byte stream is fed to
+// CommPort in datagram sized chunks and parsed back into packets. The clean
+// stream holds only packets, the garbage stream buries them in random bytes
+// with many start of frame bytes, like a busy broadcast segment.
+//
+// usage: comm_port_benchmark [packet_count]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "comm/comm_port.h"
+
+using namespace livox;
+using namespace std;
+
+static const uint32_t kChunkSize = 1400;
+static const uint32_t kMaxPayloadSize = 256;
+static const uint32_t kGarbagePerPacket = 512;
+static const uint32_t kRounds = 20;
+
+static uint64_t NowNs()
+{
+    return chrono::duration_cast<chrono::nanoseconds>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static vector<uint8_t> BuildStream( uint32_t packet_count, bool garbage )
+{
+    CommPort port;
+    mt19937 rng( 2019 );
+    vector<uint8_t> stream;
+    uint8_t payload[ kMaxPayloadSize ];
+    uint8_t packed[ kMaxPayloadSize + 64 ];
+
+    for ( uint32_t i = 0; i < packet_count; i++ )
+    {
+        if ( garbage )
+        {
+            // A quarter of the garbage are start of frame bytes, each one costs a preamble check.
+            for ( uint32_t j = 0; j < kGarbagePerPacket; j++ )
+                stream.push_back( ( rng() % 4 == 0 ) ? 0xAA : static_cast<uint8_t>( rng() ) );
+        }
+
+        CommPacket packet;
+        memset( &packet, 0, sizeof( packet ) );
+        packet.packet_type = 1;
+        packet.protocol = kLidarSdk;
+        packet.seq_num = i;
+        packet.cmd_set = 0;
+        packet.cmd_code = 3;
+        packet.data_len = rng() % kMaxPayloadSize;
+        for ( uint32_t j = 0; j < packet.data_len; j++ )
+            payload[ j ] = static_cast<uint8_t>( rng() );
+        packet.data = payload;
+
+        uint32_t size = 0;
+        port.Pack( packed, sizeof( packed ), &size, packet );
+        stream.insert( stream.end(), packed, packed + size );
+    }
+    return stream;
+}
+
+static bool RunStream( const char *name, const vector<uint8_t> &stream, uint32_t packet_count )
+{
+    uint64_t parsed = 0;
+    uint64_t bad_seq = 0;
+    uint64_t start = NowNs();
+
+    for ( uint32_t round = 0; round < kRounds; round++ )
+    {
+        CommPort port;
+        uint32_t expected_seq = 0;
+
+        for ( size_t offset = 0; offset < stream.size(); offset += kChunkSize )
+        {
+            uint32_t chunk = static_cast<uint32_t>( min<size_t>( kChunkSize, stream.size() - offset ) );
+            uint32_t free_size = 0;
+            uint8_t *buf = port.FetchCacheFreeSpace( &free_size );
+            if ( buf == NULL || free_size < chunk )
+            {
+                printf( "%-8s cache full at offset %zu\n", name, offset );
+                return false;
+            }
+            memcpy( buf, &stream[ offset ], chunk );
+            port.UpdateCacheWrIdx( chunk );
+
+            CommPacket packet;
+            while ( port.ParseCommStream( &packet ) == kParseSuccess )
+            {
+                if ( packet.seq_num != expected_seq )
+                    bad_seq++;
+                expected_seq = packet.seq_num + 1;
+                parsed++;
+            }
+        }
+    }
+
+    uint64_t elapsed = NowNs() - start;
+    double seconds = elapsed / 1e9;
+    uint64_t expected = static_cast<uint64_t>( packet_count ) * kRounds;
+    printf( "%-8s parsed %10lu/%-10lu out of order %lu  %8.1f MB/s  %7.1f ns/packet\n",
+            name,
+            static_cast<unsigned long>( parsed ),
+            static_cast<unsigned long>( expected ),
+            static_cast<unsigned long>( bad_seq ),
+            stream.size() * kRounds / seconds / 1e6,
+            static_cast<double>( elapsed ) / expected );
+    return parsed == expected && bad_seq == 0;
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t packet_count = argc > 1 ? atoi( argv[ 1 ] ) : 20000;
+
+    bool ok = RunStream( "clean", BuildStream( packet_count, false ), packet_count );
+    ok = RunStream( "garbage", BuildStream( packet_count, true ), packet_count ) && ok;
+
+    return ok ? 0 : 1;
+}
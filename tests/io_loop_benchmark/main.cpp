@@ -0,0 +1,197 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+// Compare the event loop backends: a sender thread spreads UDP datagrams over
+// several loopback sockets served by one IOThread, the benchmark reports the
+// throughput and the delay from sendto to the delegate reading the datagram.
+//
+// usage: io_loop_benchmark [socket_count] [packet_count]
+
+#include <arpa/inet.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "apr_general.h"
+
+#include "livox_def.h"
+#include "base/io_thread.h"
+#include "base/logging.h"
+#include "base/network_util.h"
+
+using namespace livox;
+using namespace std;
+
+static const uint16_t kBasePort = 58000;
+static const uint32_t kPacketSize = 1362;
+static const uint32_t kBurstSize = 64;
+
+static uint64_t NowNs()
+{
+    return chrono::duration_cast<chrono::nanoseconds>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+class Receiver : public IOLoop::IOLoopDelegate
+{
+public:
+    Receiver() : received( 0 ), latency_sum( 0 ), latency_max( 0 ) {}
+
+    void OnData( apr_socket_t *sock, void * )
+    {
+        // Read until the socket would block, as the edge-triggered backend requires.
+        for ( ;; )
+        {
+            char buf[ kPacketSize ];
+            apr_sockaddr_t addr;
+            apr_size_t size = sizeof( buf );
+
+            if ( apr_socket_recvfrom( &addr, sock, 0, buf, &size ) != APR_SUCCESS || size < sizeof( uint64_t ) )
+                break;
+
+            uint64_t sent = 0;
+            memcpy( &sent, buf, sizeof( sent ) );
+            uint64_t latency = NowNs() - sent;
+            latency_sum += latency;
+            latency_max = max( latency_max, latency );
+            received++;
+        }
+    }
+
+    volatile uint64_t received;
+    uint64_t latency_sum;
+    uint64_t latency_max;
+};
+
+static bool RunBackend( IoLoopBackend backend, uint32_t socket_count, uint32_t packet_count )
+{
+    if ( !IOLoop::SetDefaultBackend( backend ) )
+    {
+        printf( "%-6s not available\n", backend == kIoLoopBackendEpoll ? "epoll" : "apr" );
+        return true;
+    }
+
+    apr_pool_t *pool = NULL;
+    if ( apr_pool_create( &pool, NULL ) != APR_SUCCESS )
+        return false;
+
+    IOThread thread;
+    if ( !thread.Init() )
+        return false;
+
+    Receiver receiver;
+    vector<apr_socket_t *> socks;
+    for ( uint32_t i = 0; i < socket_count; i++ )
+    {
+        apr_socket_t *sock = util::CreateBindSocket( kBasePort + i, pool );
+        if ( sock == NULL )
+        {
+            printf( "failed to bind port %u\n", kBasePort + i );
+            return false;
+        }
+        socks.push_back( sock );
+        thread.loop()->AddDelegate( sock, &receiver );
+    }
+    thread.Start();
+
+    int fd = socket( AF_INET, SOCK_DGRAM, 0 );
+    struct sockaddr_in addr;
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+    // Let the loop register the sockets before sending.
+    this_thread::sleep_for( chrono::milliseconds( 100 ) );
+
+    char buf[ kPacketSize ];
+    memset( buf, 0, sizeof( buf ) );
+    uint64_t start = NowNs();
+    for ( uint32_t sent = 0; sent < packet_count; )
+    {
+        // Bursts like a LiDAR frame, paced so the receive buffers do not overflow.
+        for ( uint32_t i = 0; i < kBurstSize && sent < packet_count; i++, sent++ )
+        {
+            addr.sin_port = htons( kBasePort + sent % socket_count );
+            uint64_t now = NowNs();
+            memcpy( buf, &now, sizeof( now ) );
+            sendto( fd, buf, sizeof( buf ), 0, reinterpret_cast<struct sockaddr *>( &addr ), sizeof( addr ) );
+        }
+        while ( sent - receiver.received > kBurstSize * 4 && NowNs() - start < 10000000000ULL )
+            this_thread::yield();
+    }
+
+    uint64_t deadline = NowNs() + 1000000000ULL;
+    while ( receiver.received < packet_count && NowNs() < deadline )
+        this_thread::sleep_for( chrono::milliseconds( 1 ) );
+    uint64_t elapsed = NowNs() - start;
+
+    thread.Quit();
+    thread.Join();
+    close( fd );
+    for ( size_t i = 0; i < socks.size(); i++ )
+        apr_socket_close( socks[ i ] );
+    IoLoopBackend used = thread.loop()->backend();
+    thread.Uninit();
+    apr_pool_destroy( pool );
+
+    uint64_t received = receiver.received;
+    printf( "%-6s sockets %3u  received %8llu/%-8u  %10.0f packets/s  latency avg %7.1f us  max %8.1f us\n",
+            used == kIoLoopBackendEpoll ? "epoll" : "apr",
+            socket_count,
+            static_cast<unsigned long long>( received ),
+            packet_count,
+            received * 1e9 / elapsed,
+            received ? receiver.latency_sum / 1e3 / received : 0.0,
+            receiver.latency_max / 1e3 );
+    return true;
+}
+
+int main( int argc, const char *argv[] )
+{
+    uint32_t socket_count = argc > 1 ? atoi( argv[ 1 ] ) : 8;
+    uint32_t packet_count = argc > 2 ? atoi( argv[ 2 ] ) : 200000;
+
+    if ( socket_count == 0 || socket_count > 40 || packet_count == 0 )
+    {
+        printf( "usage: %s [socket_count 1-40] [packet_count]\n", argv[ 0 ] );
+        return 1;
+    }
+
+    if ( apr_initialize() != APR_SUCCESS )
+        return 1;
+
+    InitLogger();
+
+    bool result = RunBackend( kIoLoopBackendApr, socket_count, packet_count ) &&
+                  RunBackend( kIoLoopBackendEpoll, socket_count, packet_count );
+
+    UninitLogger();
+    apr_terminate();
+    return result ? 0 : 1;
+}
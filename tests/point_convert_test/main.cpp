@@ -0,0 +1,310 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+// Check the vector point kernels against the scalar ones: random packets of
+// every point data type, with every point count up to a full packet, are
+// converted once with the scalar kernels and once with each instruction set
+// the cpu supports, and the point buffers are compared. Point buffers are
+// then compacted with every 8 point keep mask, over sizes with and without
+// a partial last group.
+//
+// usage: point_convert_test [seed]
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "livox_packet_view.h"
+#include "data_handler/point_convert.h"
+
+using namespace livox;
+using namespace std;
+
+static const uint32_t kMaxPoints = kMaxPacketPoints;
+static const uint32_t kPacketStorageSize = 2048;
+/** Points already in a buffer before a conversion, so the kernels write at an unaligned offset. */
+static const uint32_t kBufferOffset = 3;
+
+static mt19937 rng;
+static uint32_t failures = 0;
+
+/** A point buffer with all the optional arrays, its own storage. */
+struct TestBuffer
+{
+    vector<float> x, y, z;
+    vector<uint8_t> reflectivity, tag;
+    vector<uint64_t> timestamp;
+    LivoxPointBuffer buffer;
+
+    TestBuffer() : x( kMaxPoints + kBufferOffset ), y( x.size() ), z( x.size() ), reflectivity( x.size() ),
+                   tag( x.size() ), timestamp( x.size() )
+    {
+        LivoxPointBuffer b = { &x[ 0 ], &y[ 0 ], &z[ 0 ], &reflectivity[ 0 ], &tag[ 0 ], &timestamp[ 0 ],
+                               static_cast<uint32_t>( x.size() ), kBufferOffset };
+        buffer = b;
+    }
+};
+
+static bool SamePoint( const LivoxPointBuffer &e, const LivoxPointBuffer &a, uint32_t i )
+{
+    // The kernels sum the transform terms in a different order, the rounding scales with the size of the point.
+    float tolerance = 1e-5f * ( 1.0f + max( fabsf( e.x[ i ] ), max( fabsf( e.y[ i ] ), fabsf( e.z[ i ] ) ) ) );
+    return fabsf( e.x[ i ] - a.x[ i ] ) <= tolerance && fabsf( e.y[ i ] - a.y[ i ] ) <= tolerance &&
+           fabsf( e.z[ i ] - a.z[ i ] ) <= tolerance;
+}
+
+static void Compare( const char *what, uint8_t data_type, uint32_t data_num, const TestBuffer &expected,
+                     const TestBuffer &actual )
+{
+    const LivoxPointBuffer &e = expected.buffer;
+    const LivoxPointBuffer &a = actual.buffer;
+    if ( e.size != a.size )
+    {
+        printf( "%s type %u points %u: size %u instead of %u\n", what, data_type, data_num, a.size, e.size );
+        failures++;
+        return;
+    }
+    for ( uint32_t i = 0; i < e.size; i++ )
+    {
+        if ( !SamePoint( e, a, i ) || e.reflectivity[ i ] != a.reflectivity[ i ] || e.tag[ i ] != a.tag[ i ] || e.timestamp[ i ] != a.timestamp[ i ] )
+        {
+            printf( "%s type %u points %u: point %u is (%g %g %g %u %u %llu) instead of (%g %g %g %u %u %llu)\n",
+                    what, data_type, data_num, i,
+                    a.x[ i ], a.y[ i ], a.z[ i ], a.reflectivity[ i ], a.tag[ i ],
+                    static_cast<unsigned long long>( a.timestamp[ i ] ),
+                    e.x[ i ], e.y[ i ], e.z[ i ], e.reflectivity[ i ], e.tag[ i ],
+                    static_cast<unsigned long long>( e.timestamp[ i ] ) );
+            failures++;
+            return;
+        }
+    }
+}
+
+/** Fill a packet with random points. */
+static void FillPacket( LivoxEthPacket *packet, uint8_t data_type, uint32_t data_num )
+{
+    memset( packet, 0, offsetof( LivoxEthPacket, data ) );
+    packet->version = 5;
+    packet->timestamp_type = kTimestampTypePtp;
+    packet->data_type = data_type;
+    uint64_t timestamp = ( static_cast<uint64_t>( rng() ) << 20 ) | rng();
+    memcpy( packet->timestamp, &timestamp, sizeof( timestamp ) );
+
+    uint32_t point_size = PointSizeOf( data_type );
+    for ( uint32_t i = 0; i < point_size * data_num; i++ )
+        packet->data[ i ] = static_cast<uint8_t>( rng() );
+    if ( data_type == kSpherical || data_type == kExtendSpherical || data_type == kDualExtendSpherical )
+    {
+        // Mostly valid angles, with a few out of range ones converted as points without a return.
+        uint32_t angle_offset = data_type == kDualExtendSpherical ? 0 : offsetof( LivoxSpherPoint, theta );
+        for ( uint32_t i = 0; i < data_num; i++ )
+        {
+            uint16_t angles[ 2 ] = { static_cast<uint16_t>( rng() % 19000 ), static_cast<uint16_t>( rng() % 37000 ) };
+            memcpy( packet->data + i * point_size + angle_offset, angles, sizeof( angles ) );
+        }
+        return;
+    }
+    // Keep the Cartesian coordinates within a few hundred metres, like real points.
+    uint32_t coordinates = data_type == kDualExtendCartesian ? 6 : 3;
+    for ( uint32_t i = 0; i < data_num; i++ )
+    {
+        for ( uint32_t c = 0; c < coordinates; c++ )
+        {
+            int32_t value = static_cast<int32_t>( rng() % 1000000 ) - 500000;
+            uint32_t offset = c < 3 ? 4 * c : offsetof( LivoxDualExtendRawPoint, x2 ) + 4 * ( c - 3 );
+            memcpy( packet->data + i * point_size + offset, &value, sizeof( value ) );
+        }
+    }
+}
+
+static void CheckPacket( const char *level_name, SimdLevel level, const LivoxEthPacket *packet, uint32_t data_num,
+                         const PointTransform *transform )
+{
+    uint8_t data_type = packet->data_type;
+    TestBuffer expected, actual;
+
+    SetSimdLevel( kSimdScalar );
+    livox_status expected_status = ConvertPacket( packet, data_num, transform, &expected.buffer );
+    SetSimdLevel( level );
+    livox_status actual_status = ConvertPacket( packet, data_num, transform, &actual.buffer );
+    if ( expected_status != actual_status )
+    {
+        printf( "%s type %u points %u: status %d instead of %d\n", level_name, data_type, data_num, actual_status,
+                expected_status );
+        failures++;
+    }
+    Compare( level_name, data_type, data_num, expected, actual );
+
+    vector<uint64_t> expected_times( kMaxPoints ), actual_times( kMaxPoints );
+    SetSimdLevel( kSimdScalar );
+    ComputePointTimestamps( packet, data_num, &expected_times[ 0 ], kMaxPoints );
+    SetSimdLevel( level );
+    ComputePointTimestamps( packet, data_num, &actual_times[ 0 ], kMaxPoints );
+    if ( expected_times != actual_times )
+    {
+        printf( "%s type %u points %u: timestamps differ\n", level_name, data_type, data_num );
+        failures++;
+    }
+
+    if ( data_type != kDualExtendCartesian && data_type != kDualExtendSpherical )
+        return;
+    TestBuffer expected_first, expected_second, actual_first, actual_second;
+    SetSimdLevel( kSimdScalar );
+    ConvertDualPacket( packet, data_num, transform, &expected_first.buffer, &expected_second.buffer );
+    SetSimdLevel( level );
+    ConvertDualPacket( packet, data_num, transform, &actual_first.buffer, &actual_second.buffer );
+    Compare( level_name, data_type, data_num, expected_first, actual_first );
+    Compare( level_name, data_type, data_num, expected_second, actual_second );
+}
+
+/**
+ * Compact a buffer of size points from begin on, the flags of each group of 8 points form one mask. Group g of the
+ * pass gets mask first_mask + 37 * g, so each of the 256 masks lands on every group position over the passes.
+ */
+static void CheckCompaction( const char *level_name, SimdLevel level, uint32_t size, uint32_t begin,
+                             uint32_t keep_stride, bool with_arrays, uint32_t first_mask )
+{
+    TestBuffer expected, actual;
+    vector<uint8_t> keep( kMaxPoints * keep_stride );
+    for ( uint32_t i = 0; i < size; i++ )
+    {
+        expected.x[ i ] = static_cast<float>( i );
+        expected.y[ i ] = static_cast<float>( rng() );
+        expected.z[ i ] = -static_cast<float>( i );
+        expected.reflectivity[ i ] = static_cast<uint8_t>( i );
+        expected.tag[ i ] = static_cast<uint8_t>( rng() );
+        expected.timestamp[ i ] = ( static_cast<uint64_t>( rng() ) << 32 ) | i;
+    }
+    for ( uint32_t i = begin; i < size; i++ )
+    {
+        uint32_t mask = ( first_mask + 37 * ( ( i - begin ) / 8 ) ) & 0xFF;
+        // Any non zero flag keeps the point.
+        keep[ ( i - begin ) * keep_stride ] = ( mask >> ( ( i - begin ) % 8 ) ) & 1 ? static_cast<uint8_t>( 1 + rng() % 255 ) : 0;
+    }
+    expected.buffer.size = size;
+    if ( !with_arrays )
+    {
+        expected.buffer.reflectivity = NULL;
+        expected.buffer.tag = NULL;
+        expected.buffer.timestamp = NULL;
+    }
+    actual.x = expected.x;
+    actual.y = expected.y;
+    actual.z = expected.z;
+    actual.reflectivity = expected.reflectivity;
+    actual.tag = expected.tag;
+    actual.timestamp = expected.timestamp;
+    actual.buffer.size = size;
+    if ( !with_arrays )
+    {
+        actual.buffer.reflectivity = NULL;
+        actual.buffer.tag = NULL;
+        actual.buffer.timestamp = NULL;
+    }
+
+    SetSimdLevel( kSimdScalar );
+    uint32_t expected_removed = CompactPoints( &expected.buffer, begin, &keep[ 0 ], keep_stride );
+    SetSimdLevel( level );
+    uint32_t actual_removed = CompactPoints( &actual.buffer, begin, &keep[ 0 ], keep_stride );
+    if ( expected_removed != actual_removed )
+    {
+        printf( "%s compact size %u begin %u mask %u: removed %u instead of %u\n", level_name, size, begin,
+                first_mask, actual_removed, expected_removed );
+        failures++;
+        return;
+    }
+    if ( !with_arrays )
+    {
+        // Unused arrays must not be touched, compare them as the scalar pass left them.
+        actual.buffer.reflectivity = expected.buffer.reflectivity = &expected.reflectivity[ 0 ];
+        actual.buffer.tag = expected.buffer.tag = &expected.tag[ 0 ];
+        actual.buffer.timestamp = expected.buffer.timestamp = &expected.timestamp[ 0 ];
+    }
+    char what[ 64 ];
+    snprintf( what, sizeof( what ), "%s compact begin %u mask %u", level_name, begin, first_mask );
+    Compare( what, kExtendCartesian, size, expected, actual );
+}
+
+int main( int argc, char **argv )
+{
+    rng.seed( argc > 1 ? atoi( argv[ 1 ] ) : 2019 );
+
+    static const SimdLevel levels[] = { kSimdSse41, kSimdAvx2 };
+    static const char *level_names[] = { "sse4.1", "avx2" };
+    static const uint8_t data_types[] = { kCartesian, kSpherical, kExtendCartesian, kExtendSpherical,
+                                          kDualExtendCartesian, kDualExtendSpherical };
+
+    vector<uint8_t> storage( kPacketStorageSize );
+    LivoxEthPacket *packet = reinterpret_cast<LivoxEthPacket *>( &storage[ 0 ] );
+    PointTransform transform = MakePointTransform( 1.5f, -2.0f, 30.0f, 120, -45, 980 );
+
+    for ( uint32_t l = 0; l < sizeof( levels ) / sizeof( levels[ 0 ] ); l++ )
+    {
+        if ( levels[ l ] > SupportedSimdLevel() )
+        {
+            printf( "%-8s not supported by the cpu, skipped\n", level_names[ l ] );
+            continue;
+        }
+        uint32_t checked = 0;
+        for ( uint32_t t = 0; t < sizeof( data_types ) / sizeof( data_types[ 0 ] ); t++ )
+        {
+            uint8_t data_type = data_types[ t ];
+            for ( uint32_t data_num = 0; data_num <= PointsPerPacket( data_type ); data_num++ )
+            {
+                FillPacket( packet, data_type, data_num );
+                CheckPacket( level_names[ l ], levels[ l ], packet, data_num, NULL );
+                CheckPacket( level_names[ l ], levels[ l ], packet, data_num, &transform );
+                checked += 2;
+            }
+        }
+        printf( "%-8s %u packets checked\n", level_names[ l ], checked );
+
+        // Sizes that do and do not divide by 8, so the tail handoff runs after every kind of group.
+        static const uint32_t sizes[] = { 1, 7, 8, 9, 16, 21, 64, 67, 176, 179 };
+        uint32_t compacted = 0;
+        for ( uint32_t s = 0; s < sizeof( sizes ) / sizeof( sizes[ 0 ] ); s++ )
+        {
+            for ( uint32_t mask = 0; mask < 256; mask++ )
+            {
+                for ( uint32_t begin = 0; begin < 4 && begin < sizes[ s ]; begin += 3 )
+                {
+                    CheckCompaction( level_names[ l ], levels[ l ], sizes[ s ], begin, 1, true, mask );
+                    CheckCompaction( level_names[ l ], levels[ l ], sizes[ s ], begin, 2, false, mask );
+                    compacted += 2;
+                }
+            }
+        }
+        printf( "%-8s %u compactions checked\n", level_names[ l ], compacted );
+    }
+
+    SetSimdLevel( SupportedSimdLevel() );
+    printf( "%s\n", failures == 0 ? "passed" : "FAILED" );
+    return failures == 0 ? 0 : 1;
+}
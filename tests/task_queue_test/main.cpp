@@ -0,0 +1,214 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Check the IOLoop task queue with several producers and one consumer: every
+// task pushed must run exactly once, the tasks of each producer in the order
+// they were pushed. Producers push both tasks stored in the queue node and
+// tasks too large for it. A queue destroyed with pending tasks must destroy
+// them without running them.
+//
+// usage: task_queue_test [producer_count] [tasks_per_producer]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "base/task_queue.h"
+
+using namespace livox;
+using namespace std;
+
+static uint32_t failures = 0;
+
+struct Progress
+{
+    /** Runs of each task, indexed by producer * tasks_per_producer + sequence. */
+    vector<uint8_t> runs;
+    /** Sequence of the last task run per producer. */
+    vector<int64_t> last;
+    uint64_t out_of_order;
+};
+
+/** Small enough to be stored in the queue node. */
+struct SmallTask
+{
+    Progress *progress;
+    uint32_t producer;
+    uint32_t sequence;
+    uint32_t tasks_per_producer;
+
+    void operator()() const
+    {
+        Progress &p = *progress;
+        p.runs[ static_cast<size_t>( producer ) * tasks_per_producer + sequence ]++;
+        if ( static_cast<int64_t>( sequence ) <= p.last[ producer ] )
+        {
+            p.out_of_order++;
+        }
+        p.last[ producer ] = sequence;
+    }
+};
+
+/** Larger than a queue node, boxed by the queue. */
+struct LargeTask
+{
+    SmallTask task;
+    uint8_t padding[ 128 ];
+
+    void operator()() const
+    {
+        task();
+    }
+};
+
+static void CheckProducers( uint32_t producer_count, uint32_t tasks_per_producer )
+{
+    Progress progress;
+    progress.runs.assign( static_cast<size_t>( producer_count ) * tasks_per_producer, 0 );
+    progress.last.assign( producer_count, -1 );
+    progress.out_of_order = 0;
+
+    TaskQueue queue;
+    atomic<uint32_t> ready( 0 );
+    atomic<uint32_t> finished( 0 );
+    vector<thread> producers;
+    for ( uint32_t producer = 0; producer < producer_count; producer++ )
+    {
+        producers.push_back( thread( [ &, producer ]() {
+            ready++;
+            while ( ready.load() < producer_count )
+            {
+            }
+            for ( uint32_t sequence = 0; sequence < tasks_per_producer; sequence++ )
+            {
+                SmallTask task = { &progress, producer, sequence, tasks_per_producer };
+                if ( sequence % 7 == 0 )
+                {
+                    LargeTask large;
+                    large.task = task;
+                    memset( large.padding, 0, sizeof( large.padding ) );
+                    queue.Push( large );
+                }
+                else
+                {
+                    queue.Push( task );
+                }
+            }
+            finished++;
+        } ) );
+    }
+
+    // The consumer runs concurrently with the producers, a push not linked yet is picked up by a later call.
+    // Once every producer is done, all the pushes are linked and a lost task shows as a short count.
+    uint64_t total = static_cast<uint64_t>( producer_count ) * tasks_per_producer;
+    uint64_t run = 0;
+    while ( run < total )
+    {
+        bool producing = finished.load() < producer_count;
+        uint32_t count = queue.RunAll();
+        run += count;
+        if ( count == 0 && !producing )
+        {
+            break;
+        }
+    }
+    for ( size_t i = 0; i < producers.size(); i++ )
+    {
+        producers[ i ].join();
+    }
+    uint32_t extra = queue.RunAll();
+
+    if ( run != total || extra != 0 )
+    {
+        printf( "producers: %llu tasks run, then %u more, instead of %llu\n", static_cast<unsigned long long>( run ),
+                extra, static_cast<unsigned long long>( total ) );
+        failures++;
+    }
+    for ( size_t i = 0; i < progress.runs.size(); i++ )
+    {
+        if ( progress.runs[ i ] != 1 )
+        {
+            printf( "producers: task %u of producer %u ran %u times\n", static_cast<uint32_t>( i % tasks_per_producer ),
+                    static_cast<uint32_t>( i / tasks_per_producer ), progress.runs[ i ] );
+            failures++;
+            break;
+        }
+    }
+    if ( progress.out_of_order != 0 )
+    {
+        printf( "producers: %llu tasks ran before an earlier task of their producer\n",
+                static_cast<unsigned long long>( progress.out_of_order ) );
+        failures++;
+    }
+}
+
+struct TokenTask
+{
+    shared_ptr<int> token;
+    uint32_t *runs;
+
+    void operator()() const
+    {
+        ( *runs )++;
+    }
+};
+
+static void CheckDestroyPending()
+{
+    shared_ptr<int> token = make_shared<int>( 0 );
+    uint32_t runs = 0;
+    {
+        TaskQueue queue;
+        TokenTask task = { token, &runs };
+        queue.Push( task );
+        queue.Push( [ task ]() { task(); } );
+        struct
+        {
+            TokenTask task;
+            uint8_t padding[ 128 ];
+        } large = { task, { 0 } };
+        queue.Push( [ large ]() { large.task(); } );
+    }
+    if ( runs != 0 || token.use_count() != 1 )
+    {
+        printf( "destroy: %u pending tasks ran, %ld copies left\n", runs, token.use_count() - 1 );
+        failures++;
+    }
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t producer_count = argc > 1 ? atoi( argv[ 1 ] ) : 4;
+    uint32_t tasks_per_producer = argc > 2 ? atoi( argv[ 2 ] ) : 200000;
+
+    CheckProducers( producer_count, tasks_per_producer );
+    CheckDestroyPending();
+
+    printf( "%s\n", failures == 0 ? "passed" : "FAILED" );
+    return failures == 0 ? 0 : 1;
+}
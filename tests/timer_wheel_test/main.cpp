@@ -0,0 +1,252 @@
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Livox. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Check the timer wheel: random timers spread over every level, and past the
+// span of the wheel, must each run once, at the first advance reaching the
+// millisecond of their deadline, whether the wheel is driven by NextDeadline
+// like the IOLoop or by random steps. Tasks cancel timers due in the same
+// tick and later ones, and NextDeadline reports an idle wheel.
+//
+// usage: timer_wheel_test [seed]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include <vector>
+#include <boost/bind.hpp>
+
+#include "base/timer_wheel.h"
+
+using namespace livox;
+using namespace std;
+
+static const apr_time_t kTick = 1000;
+static const apr_time_t kStart = 1000000007;
+/** Deadlines up to this far ahead, beyond the 2^24 ticks the four levels cover. */
+static const apr_time_t kMaxDelay = ( 1LL << 26 ) * kTick;
+
+static mt19937_64 rng;
+static uint32_t failures = 0;
+
+struct TimerState
+{
+    apr_time_t deadline;
+    uint32_t runs;
+    apr_time_t ran_at;
+};
+
+static vector<TimerState> timers;
+/** Time of the advance before the current one. */
+static apr_time_t previous_now = 0;
+
+static void OnTimer( size_t index, apr_time_t now )
+{
+    TimerState &timer = timers[ index ];
+    timer.runs++;
+    timer.ran_at = now;
+    apr_time_t tick = ( timer.deadline + kTick - 1 ) / kTick * kTick;
+    if ( now < timer.deadline || now < tick || previous_now >= tick )
+    {
+        printf( "timer %u with deadline %lld ran at %lld, previous advance %lld\n", static_cast<uint32_t>( index ),
+                static_cast<long long>( timer.deadline ), static_cast<long long>( now ),
+                static_cast<long long>( previous_now ) );
+        failures++;
+    }
+}
+
+static apr_time_t RandomDelay()
+{
+    // As many timers for each level, and some parked past the top one.
+    static const apr_time_t kLevelSpans[] = { 64, 64 << 6, 64 << 12, 64 << 18, 1LL << 26 };
+    apr_time_t span = kLevelSpans[ rng() % 5 ] * kTick;
+    return static_cast<apr_time_t>( rng() % static_cast<uint64_t>( span ) );
+}
+
+static void ScheduleRandom( TimerWheel &wheel, apr_time_t now, size_t count )
+{
+    timers.clear();
+    for ( size_t i = 0; i < count; i++ )
+    {
+        TimerState state = { now + RandomDelay(), 0, 0 };
+        timers.push_back( state );
+        wheel.Schedule( i + 1, state.deadline, boost::bind( &OnTimer, i, _1 ) );
+    }
+}
+
+static void CheckAllRan( const char *what, const TimerWheel &wheel )
+{
+    for ( size_t i = 0; i < timers.size(); i++ )
+    {
+        if ( timers[ i ].runs != 1 )
+        {
+            printf( "%s: timer %u ran %u times\n", what, static_cast<uint32_t>( i ), timers[ i ].runs );
+            failures++;
+            return;
+        }
+    }
+    if ( wheel.size() != 0 || wheel.NextDeadline() != TimerWheel::kNever )
+    {
+        printf( "%s: %u timers left, next deadline %lld\n", what, static_cast<uint32_t>( wheel.size() ),
+                static_cast<long long>( wheel.NextDeadline() ) );
+        failures++;
+    }
+}
+
+/** Advance to each NextDeadline in turn, the way the IOLoop sleeps. */
+static void CheckDrivenByNextDeadline( size_t count )
+{
+    TimerWheel wheel( kStart );
+    ScheduleRandom( wheel, kStart, count );
+    previous_now = kStart;
+    apr_time_t now = kStart;
+    while ( wheel.size() != 0 )
+    {
+        apr_time_t next = wheel.NextDeadline();
+        if ( next < now || next > kStart + kMaxDelay + kTick )
+        {
+            printf( "next deadline %lld at %lld\n", static_cast<long long>( next ), static_cast<long long>( now ) );
+            failures++;
+            return;
+        }
+        now = next;
+        wheel.Advance( now );
+        previous_now = now;
+    }
+    CheckAllRan( "next deadline", wheel );
+}
+
+/** Advance by random steps, from sub-millisecond ones to steps skipping whole levels. */
+static void CheckRandomSteps( size_t count )
+{
+    TimerWheel wheel( kStart );
+    ScheduleRandom( wheel, kStart, count );
+    previous_now = kStart;
+    apr_time_t now = kStart;
+    while ( wheel.size() != 0 )
+    {
+        static const apr_time_t kStepSpans[] = { kTick, 64 * kTick, 4096 * kTick, 262144 * kTick };
+        now += 1 + static_cast<apr_time_t>( rng() % static_cast<uint64_t>( kStepSpans[ rng() % 4 ] ) );
+        wheel.Advance( now );
+        previous_now = now;
+    }
+    CheckAllRan( "random steps", wheel );
+}
+
+struct CancelTest
+{
+    TimerWheel *wheel;
+    vector<uint32_t> runs;
+    bool cancelled_same_tick;
+    bool cancelled_later;
+    bool cancelled_self;
+};
+
+static void CancelOthers( CancelTest *test, apr_time_t )
+{
+    test->runs[ 1 ]++;
+    // Timer 2 is due in this tick too, timer 3 a level up.
+    test->cancelled_same_tick = test->wheel->Cancel( 2 );
+    test->cancelled_later = test->wheel->Cancel( 3 );
+    test->cancelled_self = test->wheel->Cancel( 1 );
+}
+
+static void CountRun( CancelTest *test, uint32_t id, apr_time_t )
+{
+    test->runs[ id ]++;
+}
+
+static void CheckCancelFromTask()
+{
+    TimerWheel wheel( kStart );
+    CancelTest test = { &wheel, vector<uint32_t>( 5 ), false, false, false };
+    apr_time_t deadline = kStart + 10 * kTick;
+    wheel.Schedule( 1, deadline, boost::bind( &CancelOthers, &test, _1 ) );
+    wheel.Schedule( 2, deadline, boost::bind( &CountRun, &test, 2, _1 ) );
+    wheel.Schedule( 3, deadline + 100 * kTick, boost::bind( &CountRun, &test, 3, _1 ) );
+    wheel.Schedule( 4, deadline + 100 * kTick, boost::bind( &CountRun, &test, 4, _1 ) );
+
+    wheel.Advance( deadline + 1000 * kTick );
+    if ( test.runs[ 1 ] != 1 || test.runs[ 2 ] != 0 || test.runs[ 3 ] != 0 || test.runs[ 4 ] != 1 )
+    {
+        printf( "cancel from task: runs %u %u %u %u instead of 1 0 0 1\n", test.runs[ 1 ], test.runs[ 2 ],
+                test.runs[ 3 ], test.runs[ 4 ] );
+        failures++;
+    }
+    if ( !test.cancelled_same_tick || !test.cancelled_later || test.cancelled_self )
+    {
+        printf( "cancel from task: cancel returned %d %d %d instead of 1 1 0\n", test.cancelled_same_tick,
+                test.cancelled_later, test.cancelled_self );
+        failures++;
+    }
+    if ( wheel.size() != 0 || wheel.Cancel( 4 ) )
+    {
+        printf( "cancel from task: %u timers left\n", static_cast<uint32_t>( wheel.size() ) );
+        failures++;
+    }
+}
+
+static void CheckIdle()
+{
+    TimerWheel wheel( kStart );
+    CancelTest test = { &wheel, vector<uint32_t>( 2 ), false, false, false };
+    if ( wheel.NextDeadline() != TimerWheel::kNever )
+    {
+        printf( "idle: next deadline %lld on a new wheel\n", static_cast<long long>( wheel.NextDeadline() ) );
+        failures++;
+    }
+    // An idle wheel jumps to the time it is advanced to, a timer added then is not late or early.
+    wheel.Advance( kStart + kMaxDelay );
+    apr_time_t deadline = kStart + kMaxDelay + 5 * kTick;
+    wheel.Schedule( 1, deadline, boost::bind( &CountRun, &test, 1, _1 ) );
+    if ( wheel.NextDeadline() != ( deadline + kTick - 1 ) / kTick * kTick )
+    {
+        printf( "idle: next deadline %lld after a jump\n", static_cast<long long>( wheel.NextDeadline() ) );
+        failures++;
+    }
+    wheel.Cancel( 1 );
+    if ( wheel.NextDeadline() != TimerWheel::kNever )
+    {
+        printf( "idle: next deadline %lld after the last cancel\n", static_cast<long long>( wheel.NextDeadline() ) );
+        failures++;
+    }
+    wheel.Advance( deadline + kTick );
+    if ( test.runs[ 1 ] != 0 )
+    {
+        printf( "idle: a cancelled timer ran\n" );
+        failures++;
+    }
+}
+
+int main( int argc, char **argv )
+{
+    rng.seed( argc > 1 ? atoi( argv[ 1 ] ) : 2019 );
+
+    CheckDrivenByNextDeadline( 5000 );
+    CheckRandomSteps( 5000 );
+    CheckCancelFromTask();
+    CheckIdle();
+
+    printf( "%s\n", failures == 0 ? "passed" : "FAILED" );
+    return failures == 0 ? 0 : 1;
+}